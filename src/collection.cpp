@@ -1,30 +1,454 @@
 #include "collection.h"
 
+#include "file.h"
 #include "psarc.h"
+#include "serialize.h"
 #include "song.h"
 #include "global.h"
+#include "threadPool.h"
 
+#include <atomic>
 #include <filesystem>
+#include <mutex>
+#include <string.h>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#ifdef COLLECTION_WATCHER
+#include <errno.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif // COLLECTION_WATCHER
+
+// The collection index caches the Song::Info of every psarc file. Unchanged files are listed from it without opening them.
+static const char collectionIndexPath[] = "collection.bin";
+static const u32 collectionIndexMagic = 0x58444943; // "CIDX"
+static const u32 collectionIndexVersion = 2;
+
+namespace {
+  struct IndexEntry
+  {
+    std::string filepath;
+    u64 fileSize = 0;
+    i64 lastWriteTime = 0;
+    Song::Info songInfo;
+  };
+}
+
+template<typename Stream, typename T>
+static void serializeManifestInfo(Stream& stream, T& manifestInfo)
+{
+  stream(manifestInfo.instrumentFlags);
+  stream(manifestInfo.albumArt);
+  stream(manifestInfo.albumName);
+  stream(manifestInfo.albumNameSort);
+  stream(manifestInfo.arrangementName);
+  stream(manifestInfo.artistName);
+  stream(manifestInfo.artistNameSort);
+  stream(manifestInfo.bassPick);
+  stream(manifestInfo.capoFret);
+  stream(manifestInfo.centOffset);
+  stream(manifestInfo.dLC);
+  stream(manifestInfo.dLCKey);
+  stream(manifestInfo.dNA_Chords);
+  stream(manifestInfo.dNA_Riffs);
+  stream(manifestInfo.dNA_Solo);
+  stream(manifestInfo.easyMastery);
+  stream(manifestInfo.leaderboardChallengeRating);
+  stream(manifestInfo.manifestUrn);
+  stream(manifestInfo.masterID_RDV);
+  stream(manifestInfo.metronome);
+  stream(manifestInfo.mediumMastery);
+  stream(manifestInfo.notesEasy);
+  stream(manifestInfo.notesHard);
+  stream(manifestInfo.notesMedium);
+  stream(manifestInfo.representative);
+  stream(manifestInfo.routeMask);
+  stream(manifestInfo.shipping);
+  stream(manifestInfo.sKU);
+  stream(manifestInfo.songDiffEasy);
+  stream(manifestInfo.songDiffHard);
+  stream(manifestInfo.songDiffMed);
+  stream(manifestInfo.songDifficulty);
+  stream(manifestInfo.songKey);
+  stream(manifestInfo.songLength);
+  stream(manifestInfo.songName);
+  stream(manifestInfo.songNameSort);
+  stream(manifestInfo.songYear);
+  stream(manifestInfo.japaneseSongName);
+  stream(manifestInfo.japaneseArtist);
+  stream(manifestInfo.japaneseArtistName);
+  stream(manifestInfo.japaneseVocal);
+  stream(manifestInfo.tuning);
+  stream(manifestInfo.persistentID);
+  stream(manifestInfo.fileName);
+  // score and lastPlayed belong to the profile
+}
+
+template<typename Stream, typename T>
+static void serializeXBlockEntry(Stream& stream, T& entry)
+{
+  stream(entry.instrumentFlags);
+  stream(entry.id);
+#ifdef XBLOCK_FULL
+  stream(entry.properties.header);
+  stream(entry.properties.manifest);
+  stream(entry.properties.sngAsset);
+  stream(entry.properties.albumArtSmall);
+  stream(entry.properties.albumArtMedium);
+  stream(entry.properties.albumArtLarge);
+  stream(entry.properties.lyricArt);
+  stream(entry.properties.showLightsXMLAsset);
+  stream(entry.properties.soundBank);
+  stream(entry.properties.previewSoundBank);
+#endif // XBLOCK_FULL
+}
+
+template<typename Stream, typename T>
+static void serializeIndexEntry(Stream& stream, T& indexEntry)
+{
+  stream(indexEntry.filepath);
+  stream(indexEntry.fileSize);
+  stream(indexEntry.lastWriteTime);
+  stream(indexEntry.songInfo.loadState);
+  stream(indexEntry.songInfo.integrity);
+  Serialize::vector(stream, indexEntry.songInfo.xblock.entries, [](Stream& stream_, auto& entry) { serializeXBlockEntry(stream_, entry); });
+  Serialize::vector(stream, indexEntry.songInfo.manifestInfos, [](Stream& stream_, auto& manifestInfo) { serializeManifestInfo(stream_, manifestInfo); });
+  stream(indexEntry.songInfo.albumCover64_tocIndex);
+  stream(indexEntry.songInfo.albumCover128_tocIndex);
+  stream(indexEntry.songInfo.albumCover256_tocIndex);
+}
+
+// Guards collectionIndex. The collection, the integrity verification and the watcher update it from their own threads.
+static std::mutex collectionIndexMutex;
+static std::unordered_map<std::string, IndexEntry> collectionIndex;
+// While the directory is listed the watcher already updates collectionIndex. Its entries win over the listed ones.
+static std::atomic<bool> listing = false; // written with collectionIndexMutex locked
+static std::unordered_set<std::string> watchedWhileListing; // guarded by collectionIndexMutex
+
+static std::unordered_map<std::string, IndexEntry> loadIndex()
+{
+  std::unordered_map<std::string, IndexEntry> index;
+
+  if (!File::exists(collectionIndexPath))
+    return index;
+
+  const std::shared_ptr<const File::MappedFile> mappedFile = File::map(collectionIndexPath);
+  if (mappedFile == nullptr)
+    return index;
+
+  Serialize::Reader reader{ mappedFile->data, mappedFile->data + mappedFile->size };
+
+  u32 magic = 0;
+  u32 version = 0;
+  reader(magic);
+  reader(version);
+  if (magic != collectionIndexMagic || version != collectionIndexVersion)
+    return index;
+
+  std::vector<IndexEntry> indexEntries;
+  Serialize::vector(reader, indexEntries, [](Serialize::Reader& reader_, IndexEntry& indexEntry) { serializeIndexEntry(reader_, indexEntry); });
+  if (!reader.valid)
+    return index; // a damaged index is rebuilt from the psarc files
+
+  for (IndexEntry& indexEntry : indexEntries)
+  {
+    std::string filepath = indexEntry.filepath;
+    index.emplace(std::move(filepath), std::move(indexEntry));
+  }
+
+  return index;
+}
+
+// collectionIndexMutex must be locked
+static void saveIndex()
+{
+  std::vector<const IndexEntry*> indexEntries;
+  indexEntries.reserve(collectionIndex.size());
+  for (const auto& [filepath, indexEntry] : collectionIndex)
+    indexEntries.push_back(&indexEntry);
+
+  Serialize::Writer writer;
+  writer(collectionIndexMagic);
+  writer(collectionIndexVersion);
+  Serialize::vector(writer, indexEntries, [](Serialize::Writer& writer_, const IndexEntry* indexEntry) { serializeIndexEntry(writer_, *indexEntry); });
+
+  File::save(collectionIndexPath, reinterpret_cast<const char*>(writer.data.data()), writer.data.size());
+}
+
+// When the index entry of the file is up to date, psarcInfo only gets the filepath and the archive stays closed.
+// Returns false if the file is gone.
+static bool loadSongInfo(const std::filesystem::path& path, Psarc::Info& psarcInfo, IndexEntry& indexEntry, bool& indexChanged)
+{
+  std::error_code error;
+  indexEntry.filepath = path.string();
+  indexEntry.fileSize = std::filesystem::file_size(path, error);
+  if (error)
+    return false;
+  indexEntry.lastWriteTime = std::filesystem::last_write_time(path, error).time_since_epoch().count();
+  if (error)
+    return false;
+
+  bool modified = false;
+  {
+    const std::unique_lock lock(collectionIndexMutex);
+    const auto it = collectionIndex.find(indexEntry.filepath);
+    if (it != collectionIndex.end() && it->second.fileSize == indexEntry.fileSize && it->second.lastWriteTime == indexEntry.lastWriteTime)
+    {
+      psarcInfo.filepath = indexEntry.filepath;
+      indexEntry.songInfo = it->second.songInfo;
+      return true;
+    }
+    modified = it != collectionIndex.end();
+  }
+
+  indexChanged = true;
+  if (modified)
+    Song::removeTrackCaches(indexEntry.filepath);
+
+  if (!Psarc::tryParseToc(indexEntry.filepath.c_str(), psarcInfo))
+  { // listed as damaged and never opened again
+    psarcInfo = Psarc::Info();
+    psarcInfo.filepath = indexEntry.filepath;
+    indexEntry.songInfo.integrity = Song::Integrity::damaged;
+    return true;
+  }
+
+  indexEntry.songInfo = Song::loadSongInfoManifestOnly(psarcInfo);
+
+  return true;
+}
+
+// Reads every byte of the unverified files on low priority threads. The results end up in the songInfos and in the index.
+static void verifyIntegrity(std::vector<std::string> filepaths)
+{
+  if (filepaths.empty())
+    return;
+
+  const std::shared_ptr<i32> remaining = std::make_shared<i32>(i32(filepaths.size())); // guarded by collectionIndexMutex
+
+  for (std::string& filepath : filepaths)
+  {
+    ThreadPool::runLowPriority([filepath = std::move(filepath), remaining]()
+      {
+        const Song::Integrity integrity = Psarc::verify(filepath.c_str()) ? Song::Integrity::ok : Song::Integrity::damaged;
+
+        {
+          const std::unique_lock lock(Global::psarcInfosMutex);
+          for (i32 i = 0; i < i32(Global::psarcInfos.size()); ++i)
+            if (Global::psarcInfos[i].filepath == filepath)
+              Global::songInfos[i].integrity = integrity;
+        }
+
+        const std::unique_lock lock(collectionIndexMutex);
+        if (const auto it = collectionIndex.find(filepath); it != collectionIndex.end())
+          it->second.songInfo.integrity = integrity;
+        if (--*remaining == 0)
+          saveIndex();
+      });
+  }
+}
+
+#ifdef COLLECTION_WATCHER
+namespace {
+  // parsed on the watcher thread, applied to the songInfos on the main thread
+  struct Change
+  {
+    std::string filepath;
+    bool removed = false;
+    bool modified = false;
+    Psarc::Info psarcInfo;
+    Song::Info songInfo;
+  };
+}
+
+static std::mutex changesMutex;
+static std::vector<Change> changes;
+
+static void queueChange(const std::filesystem::path& path, bool removed)
+{
+  Change change;
+  change.filepath = path.string();
+  change.removed = removed;
+
+  if (removed)
+  {
+    const std::unique_lock lock(collectionIndexMutex);
+    if (listing)
+      watchedWhileListing.insert(change.filepath);
+    if (collectionIndex.erase(change.filepath) != 0)
+      saveIndex();
+    Song::removeTrackCaches(change.filepath);
+  }
+  else
+  {
+    IndexEntry indexEntry;
+    if (!loadSongInfo(path, change.psarcInfo, indexEntry, change.modified))
+      return; // already gone again
+    change.songInfo = indexEntry.songInfo;
+
+    if (change.modified)
+    {
+      const std::unique_lock lock(collectionIndexMutex);
+      if (listing)
+        watchedWhileListing.insert(change.filepath);
+      collectionIndex.insert_or_assign(change.filepath, std::move(indexEntry));
+      saveIndex();
+    }
+  }
+
+  const std::unique_lock lock(changesMutex);
+  changes.push_back(std::move(change));
+}
+
+static void watcherThread(int fd)
+{
+  alignas(inotify_event) char buffer[4096];
+
+  for (;;)
+  {
+    const ssize_t length = read(fd, buffer, sizeof(buffer));
+    if (length <= 0)
+    {
+      if (length == -1 && errno == EINTR)
+        continue;
+      return;
+    }
+
+    for (const char* cur = buffer; cur < buffer + length;)
+    {
+      const inotify_event* event = reinterpret_cast<const inotify_event*>(cur);
+      cur += sizeof(inotify_event) + event->len;
+
+      if (event->len == 0)
+        continue;
+
+      const std::filesystem::path path = std::filesystem::path(Global::settings.psarcPath) / event->name;
+      if (path.extension() != std::filesystem::path(".psarc"))
+        continue;
+
+      queueChange(path, (event->mask & (IN_DELETE | IN_MOVED_FROM)) != 0);
+    }
+  }
+}
+
+// Started before the directory is listed, so no file is missed. Collection::tick holds its changes back until the listing
+// is done. A file added in between shows up in both and is only replaced if it changed.
+static void startWatcher()
+{
+  const int fd = inotify_init1(IN_CLOEXEC);
+  if (fd == -1)
+    return;
+
+  if (inotify_add_watch(fd, Global::settings.psarcPath.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) == -1)
+  {
+    close(fd);
+    return;
+  }
+
+  std::thread(watcherThread, fd).detach();
+}
+#endif // COLLECTION_WATCHER
+
+// Files per task of the parallel listing. The songs of a task are published to the songInfos together.
+static const i32 collectionBatchSize = 16;
 
-#ifdef COLLECTION_WORKER_THREAD
 static void fillCollection()
 {
+#ifdef COLLECTION_WATCHER
+  startWatcher();
+#endif // COLLECTION_WATCHER
+
+  {
+    std::unordered_map<std::string, IndexEntry> index = loadIndex();
+    const std::unique_lock lock(collectionIndexMutex);
+    collectionIndex = std::move(index);
+    watchedWhileListing.clear();
+    listing = true;
+  }
+
+  std::vector<std::filesystem::path> paths;
   for (const auto& file : std::filesystem::directory_iterator(std::filesystem::path(Global::settings.psarcPath))) {
     if (file.path().extension() != std::filesystem::path(".psarc"))
       continue;
 
-    const Psarc::Info psarcInfo = Psarc::parse(Psarc::readPsarcData(file.path().string().c_str()));
-    const Song::Info songInfo = Song::loadSongInfoManifestOnly(psarcInfo);
+    paths.push_back(file.path());
+  }
+
+  std::mutex listedIndexMutex;
+  std::unordered_map<std::string, IndexEntry> listedIndex;
+  std::vector<std::string> unverified;
+  bool indexChanged = false;
 
+  // Archives are parsed on all workers. Each task collects its songs locally and takes the locks once.
+  const i32 batchCount = (i32(paths.size()) + collectionBatchSize - 1) / collectionBatchSize;
+  ThreadPool::parallelFor(batchCount, [&](i32 batch)
     {
-      const std::unique_lock lock(Global::psarcInfosMutex);
-      Global::psarcInfos.emplace_back(std::move(psarcInfo));
-      Global::songInfos.emplace_back(std::move(songInfo));
+      const i32 begin = batch * collectionBatchSize;
+      const i32 end = min_(begin + collectionBatchSize, i32(paths.size()));
+
+      std::vector<Psarc::Info> psarcInfos;
+      std::vector<Song::Info> songInfos;
+      std::vector<IndexEntry> indexEntries;
+      bool batchIndexChanged = false;
+      for (i32 i = begin; i < end; ++i)
+      {
+        Psarc::Info psarcInfo;
+        IndexEntry indexEntry;
+        if (!loadSongInfo(paths[i], psarcInfo, indexEntry, batchIndexChanged))
+          continue; // removed since it was listed
+        indexEntries.push_back(std::move(indexEntry));
+        psarcInfos.push_back(std::move(psarcInfo));
+        songInfos.push_back(indexEntries.back().songInfo);
+      }
+
+      {
+        const std::unique_lock lock(Global::psarcInfosMutex);
+        Global::psarcInfos.insert(Global::psarcInfos.end(), std::make_move_iterator(psarcInfos.begin()), std::make_move_iterator(psarcInfos.end()));
+        Global::songInfos.insert(Global::songInfos.end(), std::make_move_iterator(songInfos.begin()), std::make_move_iterator(songInfos.end()));
+      }
+
+      const std::unique_lock lock(listedIndexMutex);
+      indexChanged = indexChanged || batchIndexChanged;
+      for (IndexEntry& indexEntry : indexEntries)
+      {
+        if (indexEntry.songInfo.integrity == Song::Integrity::unknown)
+          unverified.push_back(indexEntry.filepath);
+        std::string filepath = indexEntry.filepath;
+        listedIndex.insert_or_assign(std::move(filepath), std::move(indexEntry));
+      }
+    });
+
+  {
+    const std::unique_lock lock(collectionIndexMutex);
+
+    // merged by path. Entries of files that are gone are dropped, entries the watcher wrote meanwhile are kept.
+    for (auto it = collectionIndex.begin(); it != collectionIndex.end();)
+    {
+      if (listedIndex.contains(it->first) || watchedWhileListing.contains(it->first))
+      {
+        ++it;
+        continue;
+      }
+      Song::removeTrackCaches(it->first);
+      it = collectionIndex.erase(it);
+      indexChanged = true;
     }
+    for (auto& [filepath, indexEntry] : listedIndex)
+      if (!watchedWhileListing.contains(filepath))
+        collectionIndex.insert_or_assign(filepath, std::move(indexEntry));
+
+    watchedWhileListing.clear();
+    listing = false;
+
+    if (indexChanged)
+      saveIndex();
   }
+
+  if (Global::settings.libraryVerifyIntegrity)
+    verifyIntegrity(std::move(unverified));
 }
-#endif // COLLECTION_WORKER_THREAD
 
 void Collection::init()
 {
@@ -34,17 +458,83 @@ void Collection::init()
 #ifdef COLLECTION_WORKER_THREAD
   static std::thread wokerThread(fillCollection);
 #else // COLLECTION_WORKER_THREAD
-  for (const auto& file : std::filesystem::directory_iterator(std::filesystem::path(Global::settings.psarcPath)))
+  fillCollection();
+#endif // COLLECTION_WORKER_THREAD
+}
+
+void Collection::tick()
+{
+#ifdef COLLECTION_WATCHER
+  if (listing)
+    return; // a file the watcher saw could still be published by the listing afterwards
+
+  std::vector<Change> pendingChanges;
   {
-    if (file.path().extension() != std::filesystem::path(".psarc"))
-      continue;
-    Global::psarcInfos.push_back(Psarc::parse(Psarc::readPsarcData(file.path().string().c_str())));
+    const std::unique_lock lock(changesMutex);
+    if (changes.empty())
+      return;
+    pendingChanges.swap(changes);
+  }
+
+  std::vector<Change> deferredChanges;
+  std::vector<std::string> unverified;
+  {
+    const std::unique_lock lock(Global::psarcInfosMutex);
+
+    for (Change& change : pendingChanges)
+    {
+      i32 i = -1;
+      for (i32 j = 0; j < i32(Global::psarcInfos.size()); ++j)
+      {
+        if (Global::psarcInfos[j].filepath == change.filepath)
+        {
+          i = j;
+          break;
+        }
+      }
+
+      if (i != -1 && i == Global::songSelected)
+      { // the selected song stays as it is until another one is selected
+        deferredChanges.push_back(std::move(change));
+        continue;
+      }
+
+      if (change.removed)
+      {
+        if (i == -1)
+          continue;
+        Global::psarcInfos.erase(Global::psarcInfos.begin() + i);
+        Global::songInfos.erase(Global::songInfos.begin() + i);
+        if (i < Global::songSelected)
+          --Global::songSelected;
+      }
+      else if (i == -1 || change.modified)
+      {
+        if (change.songInfo.integrity == Song::Integrity::unknown)
+          unverified.push_back(change.filepath);
+
+        if (i == -1)
+        {
+          Global::psarcInfos.push_back(std::move(change.psarcInfo));
+          Global::songInfos.push_back(std::move(change.songInfo));
+        }
+        else
+        {
+          Global::psarcInfos[i] = std::move(change.psarcInfo);
+          Global::songInfos[i] = std::move(change.songInfo);
+        }
+      }
+    }
   }
 
-  Global::songInfos.resize(Global::psarcInfos.size());
-  for (i32 i = 0; i < Global::psarcInfos.size(); ++i)
+  // after they are published, so the results find their songInfos
+  if (Global::settings.libraryVerifyIntegrity)
+    verifyIntegrity(std::move(unverified));
+
+  if (!deferredChanges.empty())
   {
-    Global::songInfos[i] = Song::loadSongInfoManifestOnly(Global::psarcInfos[i]);
+    const std::unique_lock lock(changesMutex);
+    changes.insert(changes.begin(), std::make_move_iterator(deferredChanges.begin()), std::make_move_iterator(deferredChanges.end()));
   }
-#endif // COLLECTION_WORKER_THREAD
-}
\ No newline at end of file
+#endif // COLLECTION_WATCHER
+}
@@ -6,6 +6,7 @@
 namespace Collection
 {
   void init();
+  void tick(); // applies the changes found by the watcher
 }
 
 #endif // COLLECTION_H
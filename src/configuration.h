@@ -15,6 +15,10 @@
 
 #define COLLECTION_WORKER_THREAD
 
+#ifdef __linux__
+#define COLLECTION_WATCHER // picks up added, modified and removed psarc files while running
+#endif // __linux__
+
 #ifdef _WIN32
 #define SUPPORT_BNK
 #define SUPPORT_PLUGIN
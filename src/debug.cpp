@@ -4,6 +4,7 @@
 #include "opengl.h"
 #include "helper.h"
 #include "global.h"
+#include "psarc.h"
 #include "shader.h"
 #include "font.h"
 #include "type.h"
@@ -14,7 +15,7 @@ void Debug::render()
 {
   if (Global::inputDebug.toggle)
   {
-    char text[50];
+    char text[80];
 
     GLuint shader = Shader::useShader(Shader::Stem::fontScreen);
     glUniform4f(glGetUniformLocation(shader, "color"), 1.0f, 1.0f, 1.0f, 1.0f);
@@ -132,5 +133,35 @@ void Debug::render()
       const f32 offsetY = 14.0f * f32(Const::fontCharHeight) / f32(Global::resolutionHeight);
       Font::draw(text, scaleX - 1.00f, 1.00f - scaleY - offsetY, 0.0f, scaleX, scaleY);
     }
+
+    const Psarc::ContentCacheStats contentCacheStats = Psarc::contentCacheStats();
+
+    {
+#ifdef _WIN32
+#pragma warning( disable: 4996 ) // ignore msvc unsafe warning
+#endif // _WIN32
+      sprintf(text, "ContentCache %llu MB", (unsigned long long)(contentCacheStats.size / (1024 * 1024)));
+#ifdef _WIN32
+#pragma warning( default: 4996 )
+#endif // _WIN32
+      const i32 letters = i32(strlen(text));
+      const f32 scaleX = f32(Const::fontCharWidth * letters) / f32(Global::resolutionWidth);
+      const f32 offsetY = 16.0f * f32(Const::fontCharHeight) / f32(Global::resolutionHeight);
+      Font::draw(text, scaleX - 1.00f, 1.00f - scaleY - offsetY, 0.0f, scaleX, scaleY);
+    }
+
+    {
+#ifdef _WIN32
+#pragma warning( disable: 4996 ) // ignore msvc unsafe warning
+#endif // _WIN32
+      sprintf(text, "Hit %llu Miss %llu Evict %llu", (unsigned long long)contentCacheStats.hits, (unsigned long long)contentCacheStats.misses, (unsigned long long)contentCacheStats.evictions);
+#ifdef _WIN32
+#pragma warning( default: 4996 )
+#endif // _WIN32
+      const i32 letters = i32(strlen(text));
+      const f32 scaleX = f32(Const::fontCharWidth * letters) / f32(Global::resolutionWidth);
+      const f32 offsetY = 18.0f * f32(Const::fontCharHeight) / f32(Global::resolutionHeight);
+      Font::draw(text, scaleX - 1.00f, 1.00f - scaleY - offsetY, 0.0f, scaleX, scaleY);
+    }
   }
 }
@@ -1,5 +1,6 @@
 #include "file.h"
 
+#include "helper.h"
 #include "opengl.h"
 
 #include <stdio.h>
@@ -8,6 +9,15 @@
 #include <sstream>
 #include <filesystem>
 
+#if defined(_WIN32)
+#include <Windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 bool File::exists(const char *filepath) {
     return std::filesystem::exists(std::filesystem::path(filepath));
 }
@@ -53,7 +63,7 @@ void File::load(const char *filepath, std::string &buffer) {
     buffer = ss.str();
 }
 
-void File::save(const char *filepath, const char *content, size_t len) {
+bool File::save(const char *filepath, const char *content, size_t len) {
 #ifdef _WIN32
 #pragma warning( disable: 4996 ) // ignore msvc unsafe warning
 #endif // _WIN32
@@ -62,9 +72,112 @@ void File::save(const char *filepath, const char *content, size_t len) {
 #pragma warning( default: 4996 )
 #endif // _WIN32
 
-    fwrite(content, len, 1, file);
+    if (file == nullptr)
+        return false;
 
-    fclose(file);
+    const bool written = len == 0 || fwrite(content, len, 1, file) == 1;
+
+    return fclose(file) == 0 && written;
+}
+
+File::MappedFile::~MappedFile() {
+#if defined(_WIN32)
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (mappingHandle != nullptr)
+        CloseHandle(mappingHandle);
+    if (fileHandle != nullptr)
+        CloseHandle(fileHandle);
+#elif !defined(__EMSCRIPTEN__)
+    if (data != nullptr)
+        munmap(const_cast<u8 *>(data), size);
+#endif
+}
+
+std::shared_ptr<const File::MappedFile> File::map(const char *filepath) {
+    std::shared_ptr<MappedFile> mappedFile = std::make_shared<MappedFile>();
+
+#if defined(__EMSCRIPTEN__)
+    std::ifstream in(filepath, std::ios::binary);
+    if (!in)
+        return nullptr;
+    in.seekg(0, std::ios::end);
+    mappedFile->buffer.resize(in.tellg());
+    in.seekg(0, std::ios::beg);
+    in.read(reinterpret_cast<char *>(mappedFile->buffer.data()), mappedFile->buffer.size());
+    mappedFile->data = mappedFile->buffer.data();
+    mappedFile->size = mappedFile->buffer.size();
+#elif defined(_WIN32)
+    HANDLE fileHandle = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return nullptr;
+    mappedFile->fileHandle = fileHandle;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0)
+        return nullptr;
+    mappedFile->size = u64(fileSize.QuadPart);
+
+    mappedFile->mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappedFile->mappingHandle == nullptr)
+        return nullptr;
+
+    mappedFile->data = reinterpret_cast<const u8 *>(MapViewOfFile(mappedFile->mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (mappedFile->data == nullptr)
+        return nullptr;
+#else
+    const int fd = open(filepath, O_RDONLY);
+    if (fd == -1)
+        return nullptr;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference to the file
+    if (data == MAP_FAILED)
+        return nullptr;
+
+    mappedFile->data = reinterpret_cast<const u8 *>(data);
+    mappedFile->size = u64(st.st_size);
+#endif
+
+    return mappedFile;
+}
+
+void File::advise(const MappedFile &mappedFile, u64 offset, u64 size, Access access) {
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    static const u64 pageSize = u64(sysconf(_SC_PAGESIZE));
+
+    // madvise wants a page aligned address
+    const u64 begin = offset & ~(pageSize - 1);
+    const u64 end = min_(offset + size, mappedFile.size);
+    if (end <= begin)
+        return;
+
+    i32 advice = MADV_NORMAL;
+    switch (access) {
+        case Access::sequential:
+            advice = MADV_SEQUENTIAL;
+            break;
+        case Access::random:
+            advice = MADV_RANDOM;
+            break;
+        case Access::willNeed:
+            advice = MADV_WILLNEED;
+            break;
+    }
+
+    madvise(const_cast<u8 *>(mappedFile.data + begin), end - begin, advice);
+#else
+    UNUSED(mappedFile);
+    UNUSED(offset);
+    UNUSED(size);
+    UNUSED(access);
+#endif
 }
 
 GLuint File::loadDds(const char *filepath) {
@@ -6,15 +6,41 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 
 namespace File {
     bool exists(const char *filepath);
 
     std::vector<u8> load(const char *filepath, const char *mode);
 
+    struct MappedFile {
+        const u8 *data = nullptr;
+        u64 size = 0;
+
+        ~MappedFile();
+
+#if defined(__EMSCRIPTEN__)
+        std::vector<u8> buffer;
+#elif defined(_WIN32)
+        void *fileHandle = nullptr;
+        void *mappingHandle = nullptr;
+#endif
+    };
+
+    enum struct Access {
+        sequential,
+        random,
+        willNeed
+    };
+
+    // read-only view of the whole file. Returns nullptr when the file can not be mapped.
+    std::shared_ptr<const MappedFile> map(const char *filepath);
+    void advise(const MappedFile &mappedFile, u64 offset, u64 size, Access access);
+
     void load(const char *filepath, std::string &buffer);
 
-    void save(const char *filepath, const char *content, size_t len);
+    // Returns false when the file could not be written, e.g. in a read-only directory.
+    bool save(const char *filepath, const char *content, size_t len);
 
     GLuint loadDds(const char *filepath);
 
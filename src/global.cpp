@@ -46,9 +46,7 @@ bool Global::isInstalled = false;
 InstrumentFlags Global::currentInstrument = InstrumentFlags::LeadGuitar;
 i32 Global::bassTuning[5] = { 0, 0, 0, 0, 0 };
 i32 Global::guitarTuning[7] = { 0, 0, 0, 0, 0, 0, 0 };
-#ifdef COLLECTION_WORKER_THREAD
 std::mutex Global::psarcInfosMutex;
-#endif // COLLECTION_WORKER_THREAD
 std::vector<Psarc::Info> Global::psarcInfos;
 i32 Global::songSelected = -1;
 i32 Global::manifestSelected = 0;
@@ -57,6 +55,8 @@ Song::Track Global::songTrack;
 std::vector<Song::Vocal> Global::songVocals;
 u8* Global::musicBuffer = nullptr;
 u64 Global::musicBufferLength = 0;
+std::atomic<u64> Global::musicBufferDecodedLength = 0;
+std::atomic<u64> Global::musicBufferStalledLength = 0;
 u8* Global::musicBufferPosition = nullptr;
 f32 Global::musicTimeElapsed = 0.0f;
 f32 Global::musicSpeedMultiplier = 1.0f;
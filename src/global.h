@@ -206,9 +206,7 @@ namespace Global {
   extern InstrumentFlags currentInstrument;
   extern i32 bassTuning[5];
   extern i32 guitarTuning[7];
-#ifdef COLLECTION_WORKER_THREAD
   extern std::mutex psarcInfosMutex;
-#endif // COLLECTION_WORKER_THREAD
   extern std::vector<Psarc::Info> psarcInfos;
   extern std::vector<Song::Info> songInfos;
   extern i32 songSelected;
@@ -217,6 +215,8 @@ namespace Global {
   extern std::vector<Song::Vocal> songVocals;
   extern u8* musicBuffer;
   extern u64 musicBufferLength;
+  extern std::atomic<u64> musicBufferDecodedLength; // the music plays while it is decoded
+  extern std::atomic<u64> musicBufferStalledLength; // bytes the playback waited for the decoder. Player::tick holds the song time back by them
   extern u8* musicBufferPosition;
   extern f32 musicTimeElapsed;
   extern f32 musicSpeedMultiplier;
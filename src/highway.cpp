@@ -136,7 +136,7 @@ static void drawStrings()
   }
 }
 
-static void drawNote(const Song::TranscriptionTrack::Note& note, f32 noteTime, f32 fretboardNoteDistance[7][24], i32 chordBoxLeft, i32 chordBoxWidth)
+static void drawNote(const Song::TranscriptionTrack::Note& note, f32 noteTime, f32 sustain, f32 fretboardNoteDistance[7][24], i32 chordBoxLeft, i32 chordBoxWidth)
 {
   const GLuint shader = Shader::useShader(Shader::Stem::defaultWorld);
 
@@ -210,54 +210,54 @@ static void drawNote(const Song::TranscriptionTrack::Note& note, f32 noteTime, f
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::note) / (sizeof(float) * 5));
     }
 
-    if (note.hammerOn)
+    if (note.has(Song::TranscriptionTrack::Technique::hammerOn))
     {
       glBufferData(GL_ARRAY_BUFFER, sizeof(Data::Geometry::hammerOn), Data::Geometry::hammerOn, GL_STATIC_DRAW);
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::hammerOn) / (sizeof(float) * 5));
     }
-    if (note.harmonic)
+    if (note.has(Song::TranscriptionTrack::Technique::harmonic))
     {
       glBufferData(GL_ARRAY_BUFFER, sizeof(Data::Geometry::harmonic), Data::Geometry::harmonic, GL_STATIC_DRAW);
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::harmonic) / (sizeof(float) * 5));
     }
-    if (note.mute)
+    if (note.has(Song::TranscriptionTrack::Technique::mute))
     {
       glBufferData(GL_ARRAY_BUFFER, sizeof(Data::Geometry::fretMute), Data::Geometry::fretMute, GL_STATIC_DRAW);
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::fretMute) / (sizeof(float) * 5));
     }
-    if (note.palmMute)
+    if (note.has(Song::TranscriptionTrack::Technique::palmMute))
     {
       glBufferData(GL_ARRAY_BUFFER, sizeof(Data::Geometry::palmMute), Data::Geometry::palmMute, GL_STATIC_DRAW);
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::palmMute) / (sizeof(float) * 5));
     }
-    if (note.pullOff)
+    if (note.has(Song::TranscriptionTrack::Technique::pullOff))
     {
       glBufferData(GL_ARRAY_BUFFER, sizeof(Data::Geometry::pullOff), Data::Geometry::pullOff, GL_STATIC_DRAW);
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::pullOff) / (sizeof(float) * 5));
     }
-    if (note.slap)
+    if (note.has(Song::TranscriptionTrack::Technique::slap))
     {
       glBufferData(GL_ARRAY_BUFFER, sizeof(Data::Geometry::slap), Data::Geometry::slap, GL_STATIC_DRAW);
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::slap) / (sizeof(float) * 5));
     }
-    if (note.harmonicPinch)
+    if (note.has(Song::TranscriptionTrack::Technique::harmonicPinch))
     {
       glBufferData(GL_ARRAY_BUFFER, sizeof(Data::Geometry::harmonicPinch), Data::Geometry::harmonicPinch, GL_STATIC_DRAW);
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::harmonicPinch) / (sizeof(float) * 5));
     }
-    if (note.tap)
+    if (note.has(Song::TranscriptionTrack::Technique::tap))
     {
       glBufferData(GL_ARRAY_BUFFER, sizeof(Data::Geometry::tap), Data::Geometry::tap, GL_STATIC_DRAW);
       glDrawArrays(GL_TRIANGLES, 0, sizeof(Data::Geometry::tap) / (sizeof(float) * 5));
     }
   }
-  if (note.sustain != 0.0f)
+  if (sustain != 0.0f)
   {
     const GLuint shader = Shader::useShader(Shader::Stem::sustain);
 
     setStringColor(shader, 5 - note.string + instrumentStringOffset, 0.65f);
 
-    if (note.tremolo)
+    if (note.has(Song::TranscriptionTrack::Technique::tremolo))
     {
       const f32 x = Const::highwayFretPosition[note.fret - 1] + 0.5f * (Const::highwayFretPosition[note.fret] - Const::highwayFretPosition[note.fret - 1]);
 
@@ -272,7 +272,7 @@ static void drawNote(const Song::TranscriptionTrack::Note& note, f32 noteTime, f
       vv.insert(vv.end(), { -0.2_f32, 0.0f, 0.0f, 0.0f, 1.0f });
       vv.insert(vv.end(), { 0.2_f32, 0.0f, 0.0f, 1.0f, 1.0f, });
       i32 j = 0;
-      for (f32 f = 0.5f * Const::highwayTremoloFrequency; f < note.sustain - (0.5f * Const::highwayTremoloFrequency); f += Const::highwayTremoloFrequency)
+      for (f32 f = 0.5f * Const::highwayTremoloFrequency; f < sustain - (0.5f * Const::highwayTremoloFrequency); f += Const::highwayTremoloFrequency)
       {
         const f32 sustainTime = -f * Global::settings.highwaySpeedMultiplier;
 
@@ -290,7 +290,7 @@ static void drawNote(const Song::TranscriptionTrack::Note& note, f32 noteTime, f
         ++j;
       }
 
-      const f32 sustainTime = -note.sustain * Global::settings.highwaySpeedMultiplier;
+      const f32 sustainTime = -sustain * Global::settings.highwaySpeedMultiplier;
       vv.insert(vv.end(), { -0.2_f32, 0.0f, sustainTime, 0.0f, 0.0f });
       vv.insert(vv.end(), { 0.2_f32, 0.0f, sustainTime, 1.0f, 0.0f });
 
@@ -317,18 +317,18 @@ static void drawNote(const Song::TranscriptionTrack::Note& note, f32 noteTime, f
           const f32 x[] = { 0.0f, 0.0f, slideWidth, slideWidth };
           const f32 y[] = { 0.0f, 0.3, 0.7f, 1.0f };
 
-          for (f32 f = 0; f < note.sustain; f += Const::highwaySlideFrequency)
+          for (f32 f = 0; f < sustain; f += Const::highwaySlideFrequency)
           {
-            const f32 u = f / note.sustain;
+            const f32 u = f / sustain;
             const f32 xu = pow(1.0f - u, 3.0f) * x[0] + 3.0f * u * pow(1.0f - u, 2.0f) * x[1] + 3.0f * pow(u, 2.0f) * (1.0f - u) * x[2] + pow(u, 3.0f) * x[3];
             const f32 yu = pow(1.0f - u, 3.0f) * y[0] + 3.0f * u * pow(1.0f - u, 2.0f) * y[1] + 3.0f * pow(u, 2.0f) * (1.0f - u) * y[2] + pow(u, 3.0f) * y[3];
 
-            vv.insert(vv.end(), { -0.2_f32 + xu , 0.0f, -yu * note.sustain * Global::settings.highwaySpeedMultiplier, 0.0f, 0.5f });
-            vv.insert(vv.end(), { 0.2_f32 + xu, 0.0f, -yu * note.sustain * Global::settings.highwaySpeedMultiplier, 1.0f, 0.5f, });
+            vv.insert(vv.end(), { -0.2_f32 + xu , 0.0f, -yu * sustain * Global::settings.highwaySpeedMultiplier, 0.0f, 0.5f });
+            vv.insert(vv.end(), { 0.2_f32 + xu, 0.0f, -yu * sustain * Global::settings.highwaySpeedMultiplier, 1.0f, 0.5f, });
           }
         }
 
-        const f32 sustainTime = -note.sustain * Global::settings.highwaySpeedMultiplier;
+        const f32 sustainTime = -sustain * Global::settings.highwaySpeedMultiplier;
         vv.insert(vv.end(), { -0.2_f32 + slideWidth, 0.0f, sustainTime, 0.0f, 0.0f });
         vv.insert(vv.end(), { 0.2_f32 + slideWidth, 0.0f, sustainTime, 1.0f, 0.0f });
 
@@ -351,7 +351,7 @@ static void drawNote(const Song::TranscriptionTrack::Note& note, f32 noteTime, f
         glUniformMatrix4fv(glGetUniformLocation(shader, "model"), 1, GL_FALSE, &modelMat.m00);
 
         const f32 front = min_(noteTime * Global::settings.highwaySpeedMultiplier, 0.0f);
-        const f32 back = (noteTime - note.sustain) * Global::settings.highwaySpeedMultiplier;
+        const f32 back = (noteTime - sustain) * Global::settings.highwaySpeedMultiplier;
 
         const GLfloat v[] = {
           -0.2_f32, 0.0f, front, 0.0f, 1.0f,
@@ -410,24 +410,27 @@ static void drawNoteStandZero(const Song::TranscriptionTrack::Note& note, f32 no
 
 static void drawNotes(f32 fretboardNoteDistance[7][24])
 {
-  for (i32 i = i32(Global::songTrack.transcriptionTrack.notes.size()) - 1; i >= 0; --i)
-  {
-    const Song::TranscriptionTrack::Note& note = Global::songTrack.transcriptionTrack.notes[i];
+  const Song::TranscriptionTrack& transcriptionTrack = Global::songTrack.transcriptionTrack;
 
-    const f32 noteTime = -note.time + Global::musicTimeElapsed;
+  for (i32 i = i32(transcriptionTrack.notes.size()) - 1; i >= 0; --i)
+  {
+    const f32 noteTime = -transcriptionTrack.noteTime[i] + Global::musicTimeElapsed;
+    const f32 sustain = transcriptionTrack.noteSustain[i];
 
-    if (noteTime - note.sustain > 0.0f)
+    if (noteTime - sustain > 0.0f)
       continue;
     if (noteTime < Const::highwayMaxFutureTime)
       continue;
 
+    const Song::TranscriptionTrack::Note& note = transcriptionTrack.notes[i];
+
     i32 currentAnchor = -1;
     for (i32 j = 0; j < i32(Global::songTrack.transcriptionTrack.anchors.size()) - 2; ++j)
     {
       const Song::TranscriptionTrack::Anchor& anchor0 = Global::songTrack.transcriptionTrack.anchors[j];
       const Song::TranscriptionTrack::Anchor& anchor1 = Global::songTrack.transcriptionTrack.anchors[j + 1];
 
-      if (note.time >= anchor0.time && note.time < anchor1.time)
+      if (transcriptionTrack.noteTime[i] >= anchor0.time && transcriptionTrack.noteTime[i] < anchor1.time)
       {
         currentAnchor = j;
         break;
@@ -437,7 +440,7 @@ static void drawNotes(f32 fretboardNoteDistance[7][24])
     if (currentAnchor < 0)
       currentAnchor = 0;
 
-    drawNote(note, noteTime, fretboardNoteDistance, Global::songTrack.transcriptionTrack.anchors[currentAnchor].fret, Global::songTrack.transcriptionTrack.anchors[currentAnchor].width);
+    drawNote(note, noteTime, sustain, fretboardNoteDistance, Global::songTrack.transcriptionTrack.anchors[currentAnchor].fret, Global::songTrack.transcriptionTrack.anchors[currentAnchor].width);
 
     if (noteTime < 0.0f)
     {
@@ -532,7 +535,7 @@ static void drawChordName(i32 chordId, f32 noteTime, i32 chordBoxLeft, bool cons
 
   const GLuint shader = Shader::useShader(Shader::Stem::fontWorld);
   glUniform4f(glGetUniformLocation(shader, "color"), Global::settings.highwayChordNameColor.v0, Global::settings.highwayChordNameColor.v1, Global::settings.highwayChordNameColor.v2, alpha);
-  Font::draw(Chords::translatedName(chordTemplate.chordName).c_str(), Const::highwayFretPosition[chordBoxLeft] - 1.5f, f32(instrumentStringCount + instrumentStringOffset) * Const::highwayStringSpacing - 0.30f * Const::highwayStringSpacing, noteTime * Global::settings.highwaySpeedMultiplier, 0.5f, 0.5f);
+  Font::draw(Chords::translatedName(chordTemplate.chordName.c_str()).c_str(), Const::highwayFretPosition[chordBoxLeft] - 1.5f, f32(instrumentStringCount + instrumentStringOffset) * Const::highwayStringSpacing - 0.30f * Const::highwayStringSpacing, noteTime * Global::settings.highwaySpeedMultiplier, 0.5f, 0.5f);
 }
 
 static void drawChord(const Song::TranscriptionTrack::Chord& chord, f32 noteTime, bool consecutiveChord, f32 fretboardNoteDistance[7][24])
@@ -545,8 +548,12 @@ static void drawChord(const Song::TranscriptionTrack::Chord& chord, f32 noteTime
   bool allNotesFretMuted = true;
   bool allNotesPalmMuted = true;
 
-  for (const Song::TranscriptionTrack::Note& note : chord.chordNotes)
+  const Song::TranscriptionTrack& transcriptionTrack = Global::songTrack.transcriptionTrack;
+
+  for (i32 i = chord.chordNoteBegin; i < chord.chordNoteBegin + chord.chordNoteCount; ++i)
   {
+    const Song::TranscriptionTrack::Note& note = transcriptionTrack.chordNotes[i];
+
     if (note.fret > 0 && note.fret < chordBoxLeft)
       chordBoxLeft = note.fret;
 
@@ -555,9 +562,9 @@ static void drawChord(const Song::TranscriptionTrack::Chord& chord, f32 noteTime
 
     fretsInChord |= 1 << note.fret;
 
-    if (!note.mute)
+    if (!note.has(Song::TranscriptionTrack::Technique::mute))
       allNotesFretMuted = false;
-    if (!note.palmMute)
+    if (!note.has(Song::TranscriptionTrack::Technique::palmMute))
       allNotesPalmMuted = false;
   }
 
@@ -587,11 +594,9 @@ static void drawChord(const Song::TranscriptionTrack::Chord& chord, f32 noteTime
 
   if (!consecutiveChord)
   {
-    for (i32 i = i32(chord.chordNotes.size()) - 1; i >= 0; --i)
+    for (i32 i = chord.chordNoteBegin + chord.chordNoteCount - 1; i >= chord.chordNoteBegin; --i)
     {
-      const Song::TranscriptionTrack::Note& note = chord.chordNotes[i];
-
-      drawNote(note, noteTime, fretboardNoteDistance, chordBoxLeft, chordBoxRight - chordBoxLeft);
+      drawNote(transcriptionTrack.chordNotes[i], noteTime, transcriptionTrack.chordNoteSustain[i], fretboardNoteDistance, chordBoxLeft, chordBoxRight - chordBoxLeft);
     }
 
     if (noteTime < 0.0f)
@@ -673,8 +678,10 @@ static void drawChord(const Song::TranscriptionTrack::Chord& chord, f32 noteTime
 
 static void drawChordLeftHand(const Song::TranscriptionTrack::Chord& chord)
 {
-  for (const Song::TranscriptionTrack::Note& note : chord.chordNotes)
+  for (i32 i = chord.chordNoteBegin; i < chord.chordNoteBegin + chord.chordNoteCount; ++i)
   { // Draw Left Hand (Finger Position)
+    const Song::TranscriptionTrack::Note& note = Global::songTrack.transcriptionTrack.chordNotes[i];
+
     if (note.fret == 0)
       continue;
     if (note.leftHand < 0)
@@ -702,9 +709,9 @@ static void drawChords(f32 fretboardNoteDistance[7][24])
     const f32 noteTime = -chord.time + Global::musicTimeElapsed;
 
     f32 chordSustain = 0.0f;
-    for (const Song::TranscriptionTrack::Note& note : chord.chordNotes)
+    for (i32 j = chord.chordNoteBegin; j < chord.chordNoteBegin + chord.chordNoteCount; ++j)
     {
-      chordSustain = max_(chordSustain, note.sustain);
+      chordSustain = max_(chordSustain, Global::songTrack.transcriptionTrack.chordNoteSustain[j]);
     }
 
     if (noteTime - chordSustain > Const::highwayDrawChordNameEndTime)
@@ -716,12 +723,14 @@ static void drawChords(f32 fretboardNoteDistance[7][24])
     if (i >= 1)
     {
       const Song::TranscriptionTrack::Chord& prevChord = Global::songTrack.transcriptionTrack.chords[i - 1];
-      if (chord.chordNotes.size() == prevChord.chordNotes.size())
+      if (chord.chordNoteCount == prevChord.chordNoteCount)
       {
         consecutiveChrod = true;
-        for (i32 j = 0; j < i32(chord.chordNotes.size()); ++j)
+        for (i32 j = 0; j < chord.chordNoteCount; ++j)
         {
-          if (chord.chordNotes[j].string != prevChord.chordNotes[j].string || chord.chordNotes[j].fret != prevChord.chordNotes[j].fret)
+          const Song::TranscriptionTrack::Note& note = Global::songTrack.transcriptionTrack.chordNotes[chord.chordNoteBegin + j];
+          const Song::TranscriptionTrack::Note& prevNote = Global::songTrack.transcriptionTrack.chordNotes[prevChord.chordNoteBegin + j];
+          if (note.string != prevNote.string || note.fret != prevNote.fret)
           {
             consecutiveChrod = false;
             break;
@@ -827,10 +836,13 @@ static void drawHandShape(const Song::TranscriptionTrack::HandShape& handShape,
   i32 chordBoxRight = 0;
 
   bool hasArpeggio = false;
-  for (const Song::TranscriptionTrack::Note& note : Global::songTrack.transcriptionTrack.notes)
+  const Song::TranscriptionTrack& transcriptionTrack = Global::songTrack.transcriptionTrack;
+  for (i32 i = 0; i < i32(transcriptionTrack.notes.size()); ++i)
   {
-    if (note.time >= handShape.startTime && note.time <= handShape.endTime)
+    if (transcriptionTrack.noteTime[i] >= handShape.startTime && transcriptionTrack.noteTime[i] <= handShape.endTime)
     {
+      const Song::TranscriptionTrack::Note& note = transcriptionTrack.notes[i];
+
       if (note.fret > 0 && note.fret < chordBoxLeft)
         chordBoxLeft = note.fret;
 
@@ -1156,17 +1168,19 @@ static void drawFretNoteNames()
 
 static void drawDetector()
 {
-  for (i32 i = i32(Global::songTrack.transcriptionTrack.notes.size()) - 1; i >= 0; --i)
-  {
-    const Song::TranscriptionTrack::Note& note = Global::songTrack.transcriptionTrack.notes[i];
+  const Song::TranscriptionTrack& transcriptionTrack = Global::songTrack.transcriptionTrack;
 
-    const f32 noteTime = -note.time + Global::musicTimeElapsed;
+  for (i32 i = i32(transcriptionTrack.notes.size()) - 1; i >= 0; --i)
+  {
+    const f32 noteTime = -transcriptionTrack.noteTime[i] + Global::musicTimeElapsed;
 
-    if (noteTime - note.sustain - Const::highwayNoteDetectionTimeOffset > 0.0f)
+    if (noteTime - transcriptionTrack.noteSustain[i] - Const::highwayNoteDetectionTimeOffset > 0.0f)
       continue;
     if (noteTime + Const::highwayNoteDetectionTimeOffset < 0.0f)
       continue;
 
+    const Song::TranscriptionTrack::Note& note = transcriptionTrack.notes[i];
+
     if (note.fret == 0)
     {
 
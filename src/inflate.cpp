@@ -1,5 +1,19 @@
 #include "inflate.h"
 
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && !defined(__EMSCRIPTEN__)
+#define INFLATE_PCLMUL // selected at runtime, slice-by-8 is the fallback
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define PCLMUL_TARGET
+#else // _MSC_VER
+#define PCLMUL_TARGET __attribute__((target("pclmul,sse2")))
+#endif // _MSC_VER
+#endif
+
 enum State {
     INITIAL,
     PARTIAL_ZLIB_HEADER,
@@ -29,7 +43,10 @@ struct DecompressionState {
     u8 *out_base;
     u32 out_ofs;
     u32 out_size;
+    u32 window_mask; // 0xFFFFFFFF when out_base holds the whole output, else out_base is a ring buffer
+    u32 read_ofs; // ring buffer only, everything before was handed out
     u32 crc;
+    u8 compute_crc;
     u32 bit_accum;
     u8 num_bits;
     u8 final;
@@ -107,6 +124,129 @@ static const u32 crc32_table[] = {
         0x2D02EF8DUL
 };
 
+// slice-by-8: crc32_slice_table[k][i] is the crc of byte i followed by k zero bytes
+static const u32 (&crc32_slice_table())[8][256] {
+    static const auto *table = [] {
+        auto *t = new u32[8][256];
+        for (u32 i = 0; i < 256; i++) {
+            t[0][i] = crc32_table[i];
+        }
+        for (u32 k = 1; k < 8; k++) {
+            for (u32 i = 0; i < 256; i++) {
+                t[k][i] = (t[k - 1][i] >> 8) ^ crc32_table[t[k - 1][i] & 0xFF];
+            }
+        }
+        return t;
+    }();
+    return *reinterpret_cast<const u32 (*)[8][256]>(table);
+}
+
+// icrc is the inverted crc like in inflate_block
+static u32 crc32_slice_by_8(u32 icrc, const u8 *data, u32 size) {
+    const u32 (&t)[8][256] = crc32_slice_table();
+
+    for (; size >= 8; size -= 8, data += 8) {
+        const u32 lo = icrc ^ (data[0] | data[1] << 8 | data[2] << 16 | u32(data[3]) << 24);
+        const u32 hi = data[4] | data[5] << 8 | data[6] << 16 | u32(data[7]) << 24;
+        icrc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24]
+               ^ t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+    }
+    for (; size > 0; size--, data++) {
+        icrc = crc32_table[(icrc & 0xFF) ^ *data] ^ (icrc >> 8);
+    }
+    return icrc;
+}
+
+#ifdef INFLATE_PCLMUL
+static bool cpuHasPclmul() {
+#ifdef _MSC_VER
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+    return (cpuInfo[2] & (1 << 1)) != 0;
+#else // _MSC_VER
+    return __builtin_cpu_supports("pclmul");
+#endif // _MSC_VER
+}
+
+PCLMUL_TARGET static inline __m128i crc32_fold_128(__m128i x, __m128i next, __m128i k) {
+    const __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+    const __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+    return _mm_xor_si128(_mm_xor_si128(hi, next), lo);
+}
+
+// Folds 64 bytes per iteration with carry-less multiplication (Intel, "Fast CRC Computation for Generic
+// Polynomials Using PCLMULQDQ Instruction") and reduces to 32 bits with Barrett reduction.
+// size must be a multiple of 16 and at least 64.
+PCLMUL_TARGET static u32 crc32_pclmul(u32 icrc, const u8 *data, u32 size) {
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+    __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16));
+    __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 32));
+    __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 48));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(i32(icrc)));
+    data += 64;
+    size -= 64;
+
+    for (; size >= 64; size -= 64, data += 64) {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 16)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 32)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + 48)));
+    }
+
+    // fold the four lanes and the remaining 16 byte blocks into 128 bits
+    x1 = crc32_fold_128(x1, x2, k3k4);
+    x1 = crc32_fold_128(x1, x3, k3k4);
+    x1 = crc32_fold_128(x1, x4, k3k4);
+    for (; size >= 16; size -= 16, data += 16) {
+        x1 = crc32_fold_128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i *>(data)), k3k4);
+    }
+
+    // 128 to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // Barrett reduction to 32 bits
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+    x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask32), poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return u32(_mm_cvtsi128_si32(_mm_srli_si128(x1, 4)));
+}
+#endif // INFLATE_PCLMUL
+
+static u32 crc32(const u8 *data, u32 size) {
+    u32 icrc = 0xFFFFFFFFUL;
+
+#ifdef INFLATE_PCLMUL
+    static const bool pclmul = cpuHasPclmul();
+    if (pclmul && size >= 64) {
+        const u32 folded = size & ~15U;
+        icrc = crc32_pclmul(icrc, data, folded);
+        data += folded;
+        size -= folded;
+    }
+#endif // INFLATE_PCLMUL
+
+    return ~crc32_slice_by_8(icrc, data, size);
+}
+
 static i32 gen_huffman_table(u32 symbols,
                              const u8 *lengths,
                              i32 allow_no_symbols,
@@ -184,6 +324,8 @@ static i32 inflate_block(DecompressionState *state) {
     u32 num_bits = state->num_bits;
 
     u32 icrc = ~(state->crc);
+    const u8 compute_crc = state->compute_crc;
+    const u32 window_mask = state->window_mask;
 
 #define GETBITS(n, var)                                          \
     do {                                                        \
@@ -230,7 +372,7 @@ static i32 inflate_block(DecompressionState *state) {
     do {                                        \
         const u8 __byte = (byte);    \
         if (out_ofs < out_size) {       \
-            out_base[out_ofs] = __byte;         \
+            out_base[out_ofs & window_mask] = __byte; \
         }                                       \
         out_ofs++;                              \
         UPDATECRC(__byte);                      \
@@ -239,7 +381,7 @@ static i32 inflate_block(DecompressionState *state) {
 #define PUTBYTE_SAFE(byte)                      \
     do {                                        \
         const u8 __byte = (byte);    \
-        out_base[out_ofs] = __byte;             \
+        out_base[out_ofs & window_mask] = __byte; \
         out_ofs++;                              \
         UPDATECRC(__byte);                      \
     } while (0)
@@ -247,9 +389,15 @@ static i32 inflate_block(DecompressionState *state) {
 #define UPDATECRC(byte)                         \
     do {                                        \
         const u8 __val = (byte);     \
-        icrc = crc32_table[(icrc & 0xFF) ^ __val] ^ ((icrc >> 8) & 0xFFFFFFUL);\
+        if (compute_crc) {                      \
+            icrc = crc32_table[(icrc & 0xFF) ^ __val] ^ ((icrc >> 8) & 0xFFFFFFUL);\
+        }                                       \
     } while (0)
 
+// a ring buffer can not take n more bytes without overwriting output that was not handed out yet
+#define WINDOW_FULL(n)                                                  \
+    (window_mask != 0xFFFFFFFFUL && out_ofs - state->read_ofs > window_mask + 1 - (n))
+
 #define CHECK_STATE(s)  case s: goto state_##s
     switch (state->state) {
         CHECK_STATE(HEADER);
@@ -284,6 +432,7 @@ static i32 inflate_block(DecompressionState *state) {
     }
 
     if (state->block_type == 0) {
+        bit_accum = 0; // the rest of the current byte is padding
         num_bits = 0;
         state->state = UNCOMPRESSED_LEN;
         state_UNCOMPRESSED_LEN:
@@ -302,6 +451,9 @@ static i32 inflate_block(DecompressionState *state) {
             if (in_ptr >= in_top) {
                 goto out_of_data;
             }
+            if (WINDOW_FULL(1)) {
+                goto output_full;
+            }
             PUTBYTE(*in_ptr++);
             state->nread++;
         }
@@ -451,6 +603,10 @@ static i32 inflate_block(DecompressionState *state) {
         state->state = READ_SYMBOL;
         state_READ_SYMBOL:
 
+        if (WINDOW_FULL(258)) { // the longest match
+            goto output_full;
+        }
+
         GETHUFF(state->symbol, state->literal_table);
 
         if (state->symbol < 256) {
@@ -512,7 +668,7 @@ static i32 inflate_block(DecompressionState *state) {
                 repeat_length -= overflow;
             }
             for (; repeat_length > 0; repeat_length--) {
-                PUTBYTE_SAFE(out_base[out_ofs - distance]);
+                PUTBYTE_SAFE(out_base[(out_ofs - distance) & window_mask]);
             }
             out_ofs += overflow;
         }
@@ -535,6 +691,14 @@ static i32 inflate_block(DecompressionState *state) {
     state->num_bits = num_bits;
     return 1;
 
+    output_full:
+    state->in_ptr = in_ptr;
+    state->out_ofs = out_ofs;
+    state->crc = ~icrc & 0xFFFFFFFFUL;
+    state->bit_accum = bit_accum;
+    state->num_bits = num_bits;
+    return 2;
+
     error_return:
     state->in_ptr = in_ptr;
     state->out_ofs = out_ofs;
@@ -581,7 +745,6 @@ static i32 inflate_partial(const void *compressed_data, i32 compressed_size,
         }
         if ((zlib_header & 0x8F00) == 0x0800 && zlib_header % 31 == 0) {
             if (zlib_header & 0x0020) {
-                assert(false);
                 return -1;
             }
             state->in_ptr += (state->state == PARTIAL_ZLIB_HEADER ? 1 : 2);
@@ -598,10 +761,7 @@ static i32 inflate_partial(const void *compressed_data, i32 compressed_size,
             return res;
 
         if ((i32) state->out_ofs < 0)
-        {
-            assert(false);
             return -1;
-        }
     } while (!state->final);
 
     if (size_ret) {
@@ -613,6 +773,474 @@ static i32 inflate_partial(const void *compressed_data, i32 compressed_size,
     return 0;
 }
 
+// Fast path for streams that are completely in memory. It decodes with a 64 bit bit buffer and
+// direct lookup tables and bails out with -1 whenever it can not finish, the state machine above
+// then decodes the stream again and reports the error like before.
+
+#define FAST_LITLEN_TABLE_BITS 11
+#define FAST_DISTANCE_TABLE_BITS 10
+#define FAST_CODELEN_TABLE_BITS 7
+
+enum FastEntryKind {
+    FAST_INVALID,
+    FAST_LITERAL,
+    FAST_LITERAL_PAIR,
+    FAST_BASE_EXTRA, // length or distance: base value plus extra bits
+    FAST_END_OF_BLOCK,
+    FAST_SUBTABLE
+};
+
+// table entry: bits 0-4 bits to consume, 5-7 kind, 8-12 extra bits or subtable bits, 16-31 value
+static inline u32 fast_entry(u32 kind, u32 extra, u32 value) {
+    return kind << 5 | extra << 8 | value << 16;
+}
+
+static inline u32 fast_entry_length(u32 entry) {
+    return entry & 0x1F;
+}
+
+static inline u32 fast_entry_kind(u32 entry) {
+    return (entry >> 5) & 0x7;
+}
+
+static inline u32 fast_entry_extra(u32 entry) {
+    return (entry >> 8) & 0x1F;
+}
+
+static inline u32 fast_entry_value(u32 entry) {
+    return entry >> 16;
+}
+
+struct FastTables {
+    u32 litlen[(1 << FAST_LITLEN_TABLE_BITS) + 288 * (1 << (15 - FAST_LITLEN_TABLE_BITS))];
+    u32 distance[(1 << FAST_DISTANCE_TABLE_BITS) + 32 * (1 << (15 - FAST_DISTANCE_TABLE_BITS))];
+};
+
+static const u16 length_base[29] = {
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+static const u8 length_extra[29] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+static const u16 distance_base[30] = {
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+static const u8 distance_extra[30] = {
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static u32 fast_litlen_template(u32 symbol) {
+    if (symbol < 256)
+        return fast_entry(FAST_LITERAL, 0, symbol);
+    if (symbol == 256)
+        return fast_entry(FAST_END_OF_BLOCK, 0, 0);
+    if (symbol <= 285)
+        return fast_entry(FAST_BASE_EXTRA, length_extra[symbol - 257], length_base[symbol - 257]);
+    return fast_entry(FAST_INVALID, 0, 0);
+}
+
+static u32 fast_distance_template(u32 symbol) {
+    if (symbol < 30)
+        return fast_entry(FAST_BASE_EXTRA, distance_extra[symbol], distance_base[symbol]);
+    return fast_entry(FAST_INVALID, 0, 0);
+}
+
+static u32 fast_codelen_template(u32 symbol) {
+    return fast_entry(FAST_LITERAL, 0, symbol);
+}
+
+// Accepts the same codes as gen_huffman_table: complete ones, a single code that is read as one bit
+// and no codes at all when allow_no_symbols is set.
+static i32 gen_fast_table(u32 symbols, const u8 *lengths, i32 allow_no_symbols,
+                          u32 (*symbol_template)(u32), u32 table_bits,
+                          u32 *table, u32 table_capacity) {
+    u32 length_count[16] = {};
+    for (u32 i = 0; i < symbols; i++) {
+        length_count[lengths[i]]++;
+    }
+    length_count[0] = 0;
+
+    u32 total_count = 0;
+    u32 max_length = 0;
+    i32 left = 1;
+    for (u32 i = 1; i < 16; i++) {
+        total_count += length_count[i];
+        if (length_count[i] > 0) {
+            max_length = i;
+        }
+        left = (left << 1) - i32(length_count[i]);
+        if (left < 0) {
+            return 0;
+        }
+    }
+
+    const u32 main_size = 1U << table_bits;
+    for (u32 i = 0; i < main_size; i++) {
+        table[i] = fast_entry(FAST_INVALID, 0, 0);
+    }
+
+    if (total_count == 0) {
+        return allow_no_symbols;
+    }
+    if (total_count == 1) {
+        for (u32 i = 0; i < symbols; i++) {
+            if (lengths[i] != 0) {
+                for (u32 j = 0; j < main_size; j++) {
+                    table[j] = symbol_template(i) | 1;
+                }
+            }
+        }
+        return 1;
+    }
+    if (left != 0) {
+        return 0;
+    }
+
+    u32 next_code[16];
+    next_code[1] = 0;
+    for (u32 i = 2; i < 16; i++) {
+        next_code[i] = (next_code[i - 1] + length_count[i - 1]) << 1;
+    }
+
+    const u32 subtable_bits = max_length > table_bits ? max_length - table_bits : 0;
+    u32 next_subtable = main_size;
+
+    for (u32 i = 0; i < symbols; i++) {
+        const u32 length = lengths[i];
+        if (length == 0) {
+            continue;
+        }
+
+        // huffman codes are stored most significant bit first
+        const u32 code = next_code[length]++;
+        u32 reversed = 0;
+        for (u32 j = 0; j < length; j++) {
+            reversed |= ((code >> j) & 1) << (length - 1 - j);
+        }
+
+        if (length <= table_bits) {
+            for (u32 j = reversed; j < main_size; j += 1U << length) {
+                table[j] = symbol_template(i) | length;
+            }
+            continue;
+        }
+
+        u32 *main_entry = &table[reversed & (main_size - 1)];
+        if (fast_entry_kind(*main_entry) != FAST_SUBTABLE) {
+            if (next_subtable + (1U << subtable_bits) > table_capacity) {
+                return 0;
+            }
+            *main_entry = fast_entry(FAST_SUBTABLE, subtable_bits, next_subtable) | table_bits;
+            for (u32 j = 0; j < 1U << subtable_bits; j++) {
+                table[next_subtable + j] = fast_entry(FAST_INVALID, 0, 0);
+            }
+            next_subtable += 1U << subtable_bits;
+        }
+        u32 *subtable = &table[fast_entry_value(*main_entry)];
+        for (u32 j = reversed >> table_bits; j < 1U << subtable_bits; j += 1U << (length - table_bits)) {
+            subtable[j] = symbol_template(i) | (length - table_bits);
+        }
+    }
+
+    return 1;
+}
+
+// Merges two short literal codes into one entry when both fit into the main table index.
+static void pair_fast_literals(u32 *table) {
+    static const u32 main_size = 1U << FAST_LITLEN_TABLE_BITS;
+
+    u32 singles[main_size];
+    memcpy(singles, table, sizeof(singles));
+
+    for (u32 i = 0; i < main_size; i++) {
+        const u32 first = singles[i];
+        if (fast_entry_kind(first) != FAST_LITERAL || fast_entry_length(first) >= FAST_LITLEN_TABLE_BITS) {
+            continue;
+        }
+        const u32 second = singles[i >> fast_entry_length(first)];
+        if (fast_entry_kind(second) != FAST_LITERAL
+            || fast_entry_length(first) + fast_entry_length(second) > FAST_LITLEN_TABLE_BITS) {
+            continue;
+        }
+        table[i] = fast_entry(FAST_LITERAL_PAIR, 0, fast_entry_value(first) | fast_entry_value(second) << 8)
+                   | (fast_entry_length(first) + fast_entry_length(second));
+    }
+}
+
+static const FastTables &fixed_fast_tables() {
+    static const FastTables *tables = [] {
+        FastTables *t = new FastTables;
+
+        u8 literal_len[288];
+        memset(&literal_len[0], 8, 144);
+        memset(&literal_len[144], 9, 112);
+        memset(&literal_len[256], 7, 24);
+        memset(&literal_len[280], 8, 8);
+        u8 distance_len[32];
+        memset(distance_len, 5, sizeof(distance_len));
+
+        gen_fast_table(288, literal_len, 0, fast_litlen_template, FAST_LITLEN_TABLE_BITS,
+                       t->litlen, sizeof(t->litlen) / sizeof(t->litlen[0]));
+        pair_fast_literals(t->litlen);
+        gen_fast_table(32, distance_len, 0, fast_distance_template, FAST_DISTANCE_TABLE_BITS,
+                       t->distance, sizeof(t->distance) / sizeof(t->distance[0]));
+        return t;
+    }();
+    return *tables;
+}
+
+static i32 inflate_fast(const u8 *in_ptr, i32 in_size, u8 *out_base, i32 out_size) {
+    const u8 *in_top = in_ptr + in_size;
+    u8 *out_ptr = out_base;
+    u8 *out_top = out_base + out_size;
+
+    u64 bit_buf = 0;
+    u32 bit_count = 0;
+    u32 overrun = 0; // zero bytes appended behind the end of the input
+
+    // at least 56 bits are in the buffer afterwards, enough for a whole length and distance pair
+#define FAST_REFILL()                                                              \
+    do {                                                                           \
+        if (in_top - in_ptr >= 8) {                                                \
+            u64 word; /* little endian like u32_le */                              \
+            memcpy(&word, in_ptr, 8);                                              \
+            bit_buf |= word << bit_count;                                          \
+            in_ptr += (63 - bit_count) >> 3;                                       \
+            bit_count |= 56;                                                       \
+        } else {                                                                   \
+            for (; bit_count <= 56; bit_count += 8) {                              \
+                if (in_ptr < in_top) {                                             \
+                    bit_buf |= u64(*in_ptr++) << bit_count;                        \
+                } else {                                                           \
+                    overrun++;                                                     \
+                }                                                                  \
+            }                                                                      \
+            if (overrun > 8) {                                                     \
+                return -1;                                                         \
+            }                                                                      \
+        }                                                                          \
+    } while (0)
+
+#define FAST_BITS(n) u32(bit_buf & ((u64(1) << (n)) - 1))
+
+#define FAST_CONSUME(n)                                                            \
+    do {                                                                           \
+        const u32 __n = (n);                                                       \
+        bit_buf >>= __n;                                                           \
+        bit_count -= __n;                                                          \
+    } while (0)
+
+    if (in_size >= 2) {
+        const u32 zlib_header = in_ptr[0] << 8 | in_ptr[1];
+        if ((zlib_header & 0x8F00) == 0x0800 && zlib_header % 31 == 0) {
+            if (zlib_header & 0x0020) {
+                return -1;
+            }
+            in_ptr += 2;
+        }
+    }
+
+    FastTables dynamic_tables;
+
+    u32 final;
+    do {
+        FAST_REFILL();
+        final = FAST_BITS(1);
+        const u32 block_type = FAST_BITS(3) >> 1;
+        FAST_CONSUME(3);
+
+        const FastTables *tables;
+        if (block_type == 0) {
+            FAST_CONSUME(bit_count & 7);
+            if (bit_count / 8 < overrun) {
+                return -1;
+            }
+            in_ptr -= bit_count / 8 - overrun; // hand the buffered bytes back
+            bit_buf = 0;
+            bit_count = 0;
+            overrun = 0;
+
+            if (in_top - in_ptr < 4) {
+                return -1;
+            }
+            const u32 len = in_ptr[0] | in_ptr[1] << 8;
+            const u32 ilen = in_ptr[2] | in_ptr[3] << 8;
+            in_ptr += 4;
+            if (ilen != (~len & 0xFFFF) || u32(in_top - in_ptr) < len || u32(out_top - out_ptr) < len) {
+                return -1;
+            }
+            memcpy(out_ptr, in_ptr, len);
+            in_ptr += len;
+            out_ptr += len;
+            continue;
+        } else if (block_type == 1) {
+            tables = &fixed_fast_tables();
+        } else if (block_type == 2) {
+            static const u8 codelen_order[19] = {
+                    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+            };
+
+            const u32 literal_count = FAST_BITS(5) + 257;
+            FAST_CONSUME(5);
+            const u32 distance_count = FAST_BITS(5) + 1;
+            FAST_CONSUME(5);
+            const u32 codelen_count = FAST_BITS(4) + 4;
+            FAST_CONSUME(4);
+
+            u8 codelen_len[19] = {};
+            for (u32 i = 0; i < codelen_count; i++) {
+                FAST_REFILL();
+                codelen_len[codelen_order[i]] = u8(FAST_BITS(3));
+                FAST_CONSUME(3);
+            }
+
+            u32 codelen_table[1 << FAST_CODELEN_TABLE_BITS];
+            if (!gen_fast_table(19, codelen_len, 0, fast_codelen_template, FAST_CODELEN_TABLE_BITS,
+                                codelen_table, 1 << FAST_CODELEN_TABLE_BITS)) {
+                return -1;
+            }
+
+            u8 lengths[288 + 32];
+            const u32 length_total = literal_count + distance_count;
+            for (u32 i = 0; i < length_total;) {
+                FAST_REFILL();
+                const u32 entry = codelen_table[FAST_BITS(FAST_CODELEN_TABLE_BITS)];
+                if (fast_entry_kind(entry) != FAST_LITERAL) {
+                    return -1;
+                }
+                FAST_CONSUME(fast_entry_length(entry));
+
+                const u32 symbol = fast_entry_value(entry);
+                if (symbol < 16) {
+                    lengths[i++] = u8(symbol);
+                    continue;
+                }
+
+                u8 value = 0;
+                u32 repeat_count;
+                if (symbol == 16) {
+                    if (i == 0) {
+                        return -1;
+                    }
+                    value = lengths[i - 1];
+                    repeat_count = FAST_BITS(2) + 3;
+                    FAST_CONSUME(2);
+                } else if (symbol == 17) {
+                    repeat_count = FAST_BITS(3) + 3;
+                    FAST_CONSUME(3);
+                } else {
+                    repeat_count = FAST_BITS(7) + 11;
+                    FAST_CONSUME(7);
+                }
+                if (i + repeat_count > length_total) {
+                    return -1;
+                }
+                memset(&lengths[i], value, repeat_count);
+                i += repeat_count;
+            }
+
+            if (!gen_fast_table(literal_count, lengths, 0, fast_litlen_template, FAST_LITLEN_TABLE_BITS,
+                                dynamic_tables.litlen, sizeof(dynamic_tables.litlen) / sizeof(dynamic_tables.litlen[0]))
+                || !gen_fast_table(distance_count, &lengths[literal_count], 1, fast_distance_template,
+                                   FAST_DISTANCE_TABLE_BITS, dynamic_tables.distance,
+                                   sizeof(dynamic_tables.distance) / sizeof(dynamic_tables.distance[0]))) {
+                return -1;
+            }
+            pair_fast_literals(dynamic_tables.litlen);
+            tables = &dynamic_tables;
+        } else {
+            return -1;
+        }
+
+        for (;;) {
+            FAST_REFILL();
+
+            u32 entry = tables->litlen[FAST_BITS(FAST_LITLEN_TABLE_BITS)];
+            if (fast_entry_kind(entry) == FAST_SUBTABLE) {
+                FAST_CONSUME(FAST_LITLEN_TABLE_BITS);
+                entry = tables->litlen[fast_entry_value(entry) + FAST_BITS(fast_entry_extra(entry))];
+            }
+            FAST_CONSUME(fast_entry_length(entry));
+
+            const u32 kind = fast_entry_kind(entry);
+            if (kind == FAST_LITERAL) {
+                if (out_ptr == out_top) {
+                    return -1;
+                }
+                *out_ptr++ = u8(fast_entry_value(entry));
+                continue;
+            }
+            if (kind == FAST_LITERAL_PAIR) {
+                if (out_top - out_ptr < 2) {
+                    return -1;
+                }
+                out_ptr[0] = u8(fast_entry_value(entry));
+                out_ptr[1] = u8(fast_entry_value(entry) >> 8);
+                out_ptr += 2;
+                continue;
+            }
+            if (kind == FAST_END_OF_BLOCK) {
+                break;
+            }
+            if (kind != FAST_BASE_EXTRA) {
+                return -1;
+            }
+
+            const u32 length = fast_entry_value(entry) + FAST_BITS(fast_entry_extra(entry));
+            FAST_CONSUME(fast_entry_extra(entry));
+
+            entry = tables->distance[FAST_BITS(FAST_DISTANCE_TABLE_BITS)];
+            if (fast_entry_kind(entry) == FAST_SUBTABLE) {
+                FAST_CONSUME(FAST_DISTANCE_TABLE_BITS);
+                entry = tables->distance[fast_entry_value(entry) + FAST_BITS(fast_entry_extra(entry))];
+            }
+            if (fast_entry_kind(entry) != FAST_BASE_EXTRA) {
+                return -1;
+            }
+            FAST_CONSUME(fast_entry_length(entry));
+            const u32 distance = fast_entry_value(entry) + FAST_BITS(fast_entry_extra(entry));
+            FAST_CONSUME(fast_entry_extra(entry));
+
+            if (distance > u32(out_ptr - out_base) || length > u32(out_top - out_ptr)) {
+                return -1;
+            }
+
+            const u8 *src = out_ptr - distance;
+            if (distance >= 8 && u32(out_top - out_ptr) >= length + 8) {
+                // whole words, the last one may write up to 7 bytes past the match
+                u8 *match_end = out_ptr + length;
+                do {
+                    memcpy(out_ptr, src, 8);
+                    out_ptr += 8;
+                    src += 8;
+                } while (out_ptr < match_end);
+                out_ptr = match_end;
+            } else if (distance == 1) {
+                memset(out_ptr, *src, length);
+                out_ptr += length;
+            } else {
+                for (u32 i = 0; i < length; i++) {
+                    *out_ptr++ = *src++;
+                }
+            }
+        }
+    } while (!final);
+
+    if (overrun * 8 > bit_count) {
+        return -1;
+    }
+
+#undef FAST_REFILL
+#undef FAST_BITS
+#undef FAST_CONSUME
+
+    return i32(out_ptr - out_base);
+}
+
 i32 Inflate::inflate(const void *compressed_data, i32 compressed_size,
                      void *output_buffer, i32 output_size,
                      u32 *crc_ret) {
@@ -623,10 +1251,21 @@ i32 Inflate::inflate(const void *compressed_data, i32 compressed_size,
         return -1;
     }
 
+    const i32 fast_size = inflate_fast((const u8 *) compressed_data, compressed_size,
+                                       (u8 *) output_buffer, output_size);
+    if (fast_size >= 0) {
+        if (crc_ret) {
+            *crc_ret = crc32((const u8 *) output_buffer, u32(fast_size));
+        }
+        return fast_size;
+    }
+
     DecompressionState state;
     state.state = INITIAL;
     state.out_ofs = 0;
     state.crc = 0;
+    state.compute_crc = crc_ret != nullptr;
+    state.window_mask = 0xFFFFFFFFUL;
     state.bit_accum = 0;
     state.num_bits = 0;
     state.final = 0;
@@ -642,4 +1281,145 @@ i32 Inflate::inflate(const void *compressed_data, i32 compressed_size,
     }
 
     return (i32) size;
-}
\ No newline at end of file
+}
+
+static u32 adler32(const u8 *data, i32 size) {
+    u32 a = 1;
+    u32 b = 0;
+    while (size > 0) {
+        const i32 chunk = size < 5552 ? size : 5552; // largest n for which b can not overflow before the modulo
+        for (i32 i = 0; i < chunk; ++i) {
+            a += data[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+        data += chunk;
+        size -= chunk;
+    }
+    return b << 16 | a;
+}
+
+bool Inflate::verify(const void *compressed_data, i32 compressed_size,
+                     void *output_buffer, i32 output_size) {
+    if (compressed_data == nullptr || compressed_size < 6 || output_size < 0
+        || (output_size > 0 && output_buffer == nullptr)) {
+        return false;
+    }
+
+    i32 size = inflate_fast((const u8 *) compressed_data, compressed_size, (u8 *) output_buffer, output_size);
+    if (size < 0) {
+        DecompressionState state;
+        state.state = INITIAL;
+        state.out_ofs = 0;
+        state.crc = 0;
+        state.compute_crc = 0;
+        state.window_mask = 0xFFFFFFFFUL;
+        state.bit_accum = 0;
+        state.num_bits = 0;
+        state.final = 0;
+
+        u32 partial_size;
+        if (inflate_partial(compressed_data, compressed_size,
+                            output_buffer, output_size,
+                            &partial_size, nullptr,
+                            &state, sizeof(state)) != 0)
+            return false;
+        size = i32(partial_size);
+    }
+    if (size != output_size)
+        return false;
+
+    const u8 *trailer = reinterpret_cast<const u8 *>(compressed_data) + compressed_size - 4;
+    const u32 expectedAdler32 = u32(trailer[0]) << 24 | u32(trailer[1]) << 16 | u32(trailer[2]) << 8 | u32(trailer[3]);
+
+    return adler32(reinterpret_cast<const u8 *>(output_buffer), output_size) == expectedAdler32;
+}
+
+static const u32 stream_window_size = 64 * 1024; // twice the largest distance
+
+struct Inflate::Stream::State {
+    DecompressionState decompression;
+    u8 window[stream_window_size];
+    StreamStatus status = StreamStatus::needInput;
+};
+
+Inflate::Stream::Stream()
+        : state(std::make_unique<State>()) {
+    DecompressionState &decompression = state->decompression;
+    decompression.state = INITIAL;
+    decompression.out_ofs = 0;
+    decompression.crc = 0;
+    decompression.compute_crc = 0;
+    decompression.window_mask = stream_window_size - 1;
+    decompression.read_ofs = 0;
+    decompression.bit_accum = 0;
+    decompression.num_bits = 0;
+    decompression.final = 0;
+}
+
+Inflate::Stream::~Stream() = default;
+
+Inflate::StreamStatus Inflate::Stream::decode(const void *compressed_data, i32 compressed_size, i32 &compressed_used,
+                                              void *output_buffer, i32 output_size, i32 &output_written) {
+    DecompressionState &decompression = state->decompression;
+    const u8 *in = (const u8 *) compressed_data;
+    u8 *out = (u8 *) output_buffer;
+
+    compressed_used = 0;
+    output_written = 0;
+
+    if (compressed_size < 0 || output_size < 0 || (compressed_size > 0 && in == nullptr)
+        || (output_size > 0 && out == nullptr)) {
+        state->status = StreamStatus::error;
+    }
+
+    bool input_used_up = false;
+    for (;;) {
+        { // hand out what is decoded already
+            const u32 pending = decompression.out_ofs - decompression.read_ofs;
+            u32 count = u32(output_size - output_written) < pending ? u32(output_size - output_written) : pending;
+            while (count > 0) {
+                const u32 begin = decompression.read_ofs & (stream_window_size - 1);
+                const u32 chunk = stream_window_size - begin < count ? stream_window_size - begin : count;
+                memcpy(&out[output_written], &state->window[begin], chunk);
+                decompression.read_ofs += chunk;
+                output_written += i32(chunk);
+                count -= chunk;
+            }
+        }
+
+        if (state->status == StreamStatus::error) {
+            return StreamStatus::error;
+        }
+        if (decompression.read_ofs != decompression.out_ofs) {
+            return StreamStatus::outputFull;
+        }
+        if (state->status == StreamStatus::end || input_used_up) {
+            return state->status;
+        }
+
+        static const u8 no_input = 0; // inflate_partial wants a valid pointer even for no input
+        const u8 *chunk = compressed_used < compressed_size ? &in[compressed_used] : &no_input;
+        const i32 result = inflate_partial(chunk, compressed_size - compressed_used,
+                                           state->window, 0x7FFFFFFF,
+                                           nullptr, nullptr,
+                                           &decompression, sizeof(decompression));
+        switch (result) {
+            case 0:
+                compressed_used += i32(decompression.in_ptr - chunk);
+                state->status = StreamStatus::end;
+                break;
+            case 1: // out of data, a lone zlib header byte is kept in the state
+                compressed_used = compressed_size;
+                input_used_up = true;
+                break;
+            case 2: // window full
+                compressed_used += i32(decompression.in_ptr - chunk);
+                break;
+            default:
+                state->status = StreamStatus::error;
+                break;
+        }
+    }
+}
@@ -3,11 +3,41 @@
 
 #include "typedefs.h"
 
+#include <memory>
+
 namespace Inflate
 {
     i32 inflate(const void *compressed_data, i32 compressed_size,
                  void *output_buffer, i32 output_size,
                  u32 *crc_ret = nullptr);
+
+    // Inflates a complete zlib stream like inflate but returns false instead of asserting when it is damaged.
+    // The stream must inflate to exactly output_size bytes and match its Adler-32 trailer.
+    bool verify(const void *compressed_data, i32 compressed_size,
+                void *output_buffer, i32 output_size);
+
+    enum struct StreamStatus : u8 {
+        needInput, // all input was consumed, decode more with the next chunk
+        outputFull, // output_buffer is full, call again for the rest
+        end, // the stream is complete and all of its output was handed out
+        error
+    };
+
+    // Resumable decoder for a zlib or raw deflate stream that arrives in chunks.
+    // It keeps the last 64 KiB of output itself, so the output can be taken in windows of any size.
+    struct Stream {
+        Stream();
+        ~Stream();
+        Stream(const Stream &) = delete;
+        Stream &operator=(const Stream &) = delete;
+
+        StreamStatus decode(const void *compressed_data, i32 compressed_size, i32 &compressed_used,
+                            void *output_buffer, i32 output_size, i32 &output_written);
+
+    private:
+        struct State;
+        std::unique_ptr<State> state;
+    };
 }
 
 
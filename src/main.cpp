@@ -16,6 +16,7 @@
 #include "player.h"
 #include "plugin.h"
 #include "profile.h"
+#include "psarc.h"
 #include "settings.h"
 #include "shader.h"
 #include "sound.h"
@@ -65,6 +66,7 @@ static void mainloop() {
 #ifdef SUPPORT_BNK
     Bnk::tick();
 #endif // SUPPORT_BNK
+    Collection::tick();
     Profile::tick();
     Player::tick();
     Phrases::tick();
@@ -74,6 +76,7 @@ static void mainloop() {
     if (!Global::inputEsc.toggle)
       Ui::tick();
 #endif // __EMSCRIPTEN__
+    Psarc::trimContentCache();
 
     glClearColor(Global::settings.highwayBackgroundColor.v0, Global::settings.highwayBackgroundColor.v1, Global::settings.highwayBackgroundColor.v2, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
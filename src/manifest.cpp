@@ -11,42 +11,42 @@ static void readAttribute(Json::object_element* it, Manifest::Info& manifestInfo
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.albumArt = string->string;
+    manifestInfo.albumArt = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "AlbumName"))
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.albumName = string->string;
+    manifestInfo.albumName = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "AlbumNameSort"))
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.albumNameSort = string->string;
+    manifestInfo.albumNameSort = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "ArrangementName"))
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.arrangementName = string->string;
+    manifestInfo.arrangementName = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "ArtistName"))
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.artistName = string->string;
+    manifestInfo.artistName = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "ArtistNameSort"))
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.artistNameSort = string->string;
+    manifestInfo.artistNameSort = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "BassPick"))
@@ -80,7 +80,7 @@ static void readAttribute(Json::object_element* it, Manifest::Info& manifestInfo
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.dLCKey = string->string;
+    manifestInfo.dLCKey = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "DNA_Chords"))
@@ -122,7 +122,7 @@ static void readAttribute(Json::object_element* it, Manifest::Info& manifestInfo
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.manifestUrn = string->string;
+    manifestInfo.manifestUrn = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "MasterID_RDV"))
@@ -191,7 +191,7 @@ static void readAttribute(Json::object_element* it, Manifest::Info& manifestInfo
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.sKU = string->string;
+    manifestInfo.sKU = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "SongDiffEasy"))
@@ -226,7 +226,7 @@ static void readAttribute(Json::object_element* it, Manifest::Info& manifestInfo
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.sKU = string->string;
+    manifestInfo.sKU = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "SongLength"))
@@ -240,14 +240,14 @@ static void readAttribute(Json::object_element* it, Manifest::Info& manifestInfo
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.songName = string->string;
+    manifestInfo.songName = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "SongNameSort"))
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.songNameSort = string->string;
+    manifestInfo.songNameSort = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "SongYear"))
@@ -261,21 +261,21 @@ static void readAttribute(Json::object_element* it, Manifest::Info& manifestInfo
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.japaneseSongName = string->string;
+    manifestInfo.japaneseSongName = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "JapaneseArtist"))
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.japaneseArtist = string->string;
+    manifestInfo.japaneseArtist = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "JapaneseArtistName"))
   {
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
-    manifestInfo.japaneseArtistName = string->string;
+    manifestInfo.japaneseArtistName = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "Tuning"))
@@ -334,7 +334,7 @@ static void readAttribute(Json::object_element* it, Manifest::Info& manifestInfo
     assert(it->value->type == Json::type_string);
     Json::string* string = (Json::string*)it->value->payload;
     assert(string->string_size == 32);
-    manifestInfo.persistentID = string->string;
+    manifestInfo.persistentID = StringPool::intern(std::string_view(string->string, string->string_size));
     return;
   }
   if (0 == strcmp(it->name->string, "JapaneseVocal"))
@@ -356,7 +356,7 @@ static bool isSameId(const char* id0, const char* id1)
   return true;
 }
 
-std::vector<Manifest::Info> Manifest::readHsan(const std::vector<u8>& hsanData, const XBlock::Info& xblock)
+std::vector<Manifest::Info> Manifest::readHsan(std::span<const u8> hsanData, const XBlock::Info& xblock)
 {
   std::vector<Manifest::Info> manifestInfos;
 
@@ -591,7 +591,7 @@ static void readTone(Json::object_element* it, Manifest::Tone& tone)
   }
 }
 
-std::vector<Manifest::Tone> Manifest::readJson(const std::vector<u8>& jsonData)
+std::vector<Manifest::Tone> Manifest::readJson(std::span<const u8> jsonData)
 {
   Json::value* root = Json::parse(jsonData.data(), jsonData.size());
   assert(root->type == Json::type_object);
@@ -1,7 +1,9 @@
 #ifndef MANIFEST_H
 #define MANIFEST_H
 
+#include "stringPool.h"
 #include "type.h"
+#include <span>
 #include <vector>
 #include <string>
 
@@ -13,23 +15,23 @@ namespace Manifest {
   {
     InstrumentFlags instrumentFlags = InstrumentFlags::none;
 
-    std::string albumArt;
-    std::string albumName;
-    std::string albumNameSort;
-    std::string arrangementName;
-    std::string artistName;
-    std::string artistNameSort;
+    StringPool::String albumArt;
+    StringPool::String albumName;
+    StringPool::String albumNameSort;
+    StringPool::String arrangementName;
+    StringPool::String artistName;
+    StringPool::String artistNameSort;
     i32 bassPick{};
     f32 capoFret{};
     f32 centOffset{};
     bool dLC{};
-    std::string dLCKey;
+    StringPool::String dLCKey;
     f32 dNA_Chords{};
     f32 dNA_Riffs{};
     f32 dNA_Solo{};
     f32 easyMastery{};
     i32 leaderboardChallengeRating{};
-    std::string manifestUrn;
+    StringPool::String manifestUrn;
     i32 masterID_RDV{};
     i32 metronome{};
     f32 mediumMastery{};
@@ -39,29 +41,29 @@ namespace Manifest {
     i32 representative{};
     i32 routeMask{};
     bool shipping{};
-    std::string sKU;
+    StringPool::String sKU;
     f32 songDiffEasy{};
     f32 songDiffHard{};
     f32 songDiffMed{};
     f32 songDifficulty{};
-    std::string songKey;
+    StringPool::String songKey;
     f32 songLength{};
-    std::string songName;
-    std::string songNameSort;
+    StringPool::String songName;
+    StringPool::String songNameSort;
     i32 songYear{};
-    std::string japaneseSongName; // TODO is this in use?
-    std::string japaneseArtist; // TODO is this in use?
-    std::string japaneseArtistName; // TODO is this in use?
+    StringPool::String japaneseSongName; // TODO is this in use?
+    StringPool::String japaneseArtist; // TODO is this in use?
+    StringPool::String japaneseArtistName; // TODO is this in use?
     bool japaneseVocal; // TODO is this in use?
     Tuning tuning;
-    std::string persistentID;
+    StringPool::String persistentID;
 
-    std::string fileName;
+    StringPool::String fileName;
     f32 score{};
     u64 lastPlayed{};
   };
 
-  std::vector<Manifest::Info> readHsan(const std::vector<u8>& hsanData, const XBlock::Info& xblock);
+  std::vector<Manifest::Info> readHsan(std::span<const u8> hsanData, const XBlock::Info& xblock);
 
   struct Tone
   {
@@ -97,7 +99,7 @@ namespace Manifest {
     f32 sortOrder{};
   };
 
-  std::vector<Manifest::Tone> readJson(const std::vector<u8>& jsonData);
+  std::vector<Manifest::Tone> readJson(std::span<const u8> jsonData);
 }
 
 #endif // MANIFEST_H
@@ -0,0 +1,110 @@
+#include "md5.h"
+
+#include <string.h>
+
+// RFC 1321
+
+static const u32 sineTable[64] = {
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const u8 shiftTable[64] = {
+  7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+  5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+  4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+  6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+static u32 rotateLeft(u32 x, u32 c)
+{
+  return (x << c) | (x >> (32 - c));
+}
+
+static void processBlock(u32 state[4], const u8* block)
+{
+  u32 m[16];
+  for (i32 i = 0; i < 16; ++i)
+    m[i] = u32(block[i * 4]) | u32(block[i * 4 + 1]) << 8 | u32(block[i * 4 + 2]) << 16 | u32(block[i * 4 + 3]) << 24;
+
+  u32 a = state[0];
+  u32 b = state[1];
+  u32 c = state[2];
+  u32 d = state[3];
+
+  for (u32 i = 0; i < 64; ++i)
+  {
+    u32 f;
+    u32 g;
+    if (i < 16)
+    {
+      f = (b & c) | (~b & d);
+      g = i;
+    }
+    else if (i < 32)
+    {
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) % 16;
+    }
+    else if (i < 48)
+    {
+      f = b ^ c ^ d;
+      g = (3 * i + 5) % 16;
+    }
+    else
+    {
+      f = c ^ (b | ~d);
+      g = (7 * i) % 16;
+    }
+
+    const u32 temp = d;
+    d = c;
+    c = b;
+    b = b + rotateLeft(a + f + sineTable[i] + m[g], shiftTable[i]);
+    a = temp;
+  }
+
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+}
+
+void Md5::hash(const u8* in, u64 size, u8 digest[16])
+{
+  u32 state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+  const u64 fullBlocks = size / 64;
+  for (u64 i = 0; i < fullBlocks; ++i)
+    processBlock(state, &in[i * 64]);
+
+  { // padding: 0x80, zeros and the message length in bits
+    u8 tail[128] = {};
+    const u64 rest = size - fullBlocks * 64;
+    if (rest > 0)
+      memcpy(tail, &in[fullBlocks * 64], rest);
+    tail[rest] = 0x80;
+
+    const u64 tailSize = rest < 56 ? 64 : 128;
+    const u64 bitCount = size * 8;
+    for (i32 i = 0; i < 8; ++i)
+      tail[tailSize - 8 + i] = u8(bitCount >> (i * 8));
+
+    for (u64 i = 0; i < tailSize; i += 64)
+      processBlock(state, &tail[i]);
+  }
+
+  for (i32 i = 0; i < 4; ++i)
+  {
+    digest[i * 4] = u8(state[i]);
+    digest[i * 4 + 1] = u8(state[i] >> 8);
+    digest[i * 4 + 2] = u8(state[i] >> 16);
+    digest[i * 4 + 3] = u8(state[i] >> 24);
+  }
+}
@@ -0,0 +1,11 @@
+#ifndef MD5_H
+#define MD5_H
+
+#include "typedefs.h"
+
+namespace Md5
+{
+  void hash(const u8* in, u64 size, u8 digest[16]);
+}
+
+#endif // MD5_H
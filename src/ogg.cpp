@@ -3898,6 +3898,12 @@ i32 Ogg::getSamplesInterleaved(Ogg::vorbis* f, i32 channels, f32* buffer, i32 nu
   return n;
 }
 
+u32 Ogg::streamLengthInSamples(Ogg::vorbis* f)
+{
+  const u32 length = stb_vorbis_stream_length_in_samples(f);
+  return length == SAMPLE_unknown ? 0 : length;
+}
+
 i32 stb_vorbis_get_samples_float(Ogg::vorbis* f, i32 channels, f32** buffer, i32 num_samples)
 {
   f32** outputs;
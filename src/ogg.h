@@ -22,6 +22,7 @@ namespace Ogg
   Info getInfo(vorbis* f);
 
   int getSamplesInterleaved(vorbis* f, i32 channels, f32* buffer, i32 num_floats);
+  u32 streamLengthInSamples(vorbis* f); // samples per channel. 0 if the stream does not tell
 }
 
 #endif // OGG_H
\ No newline at end of file
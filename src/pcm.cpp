@@ -1,5 +1,6 @@
 #include "pcm.h"
 
+#include "helper.h"
 #include "ogg.h"
 
 #include <SDL2/SDL.h>
@@ -48,3 +49,81 @@ void Pcm::resample(u8** pcmData, u64& pcmDataSize, i32 inSampleRate, i32 outSamp
     pcmDataSize = u64(cvt.len * cvt.len_ratio);
   }
 }
+
+static const i32 oggStreamChunkSamples = 16384; // per channel. About a third of a second
+
+bool Pcm::openOggStream(OggStream& stream, const u8* oggData, u64 oggDataSize, i32 outSampleRate)
+{
+  stream.vorbis = Ogg::open(oggData, i32(oggDataSize));
+  if (stream.vorbis == nullptr)
+    return false;
+
+  const Ogg::Info oggInfo = Ogg::getInfo(stream.vorbis);
+  assert(oggInfo.channels == 2);
+
+  stream.sampleRate = i32(oggInfo.sample_rate);
+  stream.totalSamples = Ogg::streamLengthInSamples(stream.vorbis);
+  if (stream.totalSamples == 0)
+  {
+    closeOggStream(stream);
+    return false;
+  }
+
+  u64 outSamples = stream.totalSamples;
+  if (stream.sampleRate != outSampleRate)
+  {
+    stream.audioStream = SDL_NewAudioStream(AUDIO_F32, 2, stream.sampleRate, AUDIO_F32, 2, outSampleRate);
+    if (stream.audioStream == nullptr)
+    {
+      closeOggStream(stream);
+      return false;
+    }
+    outSamples = stream.totalSamples * u64(outSampleRate) / u64(stream.sampleRate) + oggStreamChunkSamples; // room for the rounding of the resampler
+  }
+
+  stream.pcmDataCapacity = outSamples * 2 * sizeof(f32);
+  stream.pcmData = (u8*)malloc(stream.pcmDataCapacity);
+  assert(stream.pcmData != nullptr);
+  stream.pcmDataSize = 0;
+
+  return true;
+}
+
+bool Pcm::decodeOggStream(OggStream& stream)
+{
+  u64 pcmDataSize = stream.pcmDataSize;
+
+  if (stream.audioStream == nullptr)
+  {
+    const u64 floats = min_(u64(oggStreamChunkSamples) * 2, (stream.pcmDataCapacity - pcmDataSize) / sizeof(f32));
+    const i32 samples = Ogg::getSamplesInterleaved(stream.vorbis, 2, (f32*)&stream.pcmData[pcmDataSize], i32(floats));
+    stream.pcmDataSize = pcmDataSize + u64(samples) * 2 * sizeof(f32);
+    return samples != 0 && stream.pcmDataSize < stream.pcmDataCapacity;
+  }
+
+  static thread_local f32 chunk[oggStreamChunkSamples * 2];
+  const i32 samples = Ogg::getSamplesInterleaved(stream.vorbis, 2, chunk, i32(NUM(chunk)));
+  if (samples != 0)
+    SDL_AudioStreamPut(stream.audioStream, chunk, samples * 2 * sizeof(f32));
+  else
+    SDL_AudioStreamFlush(stream.audioStream);
+
+  const u64 available = min_(u64(SDL_AudioStreamAvailable(stream.audioStream)), stream.pcmDataCapacity - pcmDataSize);
+  const i32 received = SDL_AudioStreamGet(stream.audioStream, &stream.pcmData[pcmDataSize], i32(available - available % (2 * sizeof(f32))));
+  if (received > 0)
+    pcmDataSize += u64(received);
+  stream.pcmDataSize = pcmDataSize;
+
+  return samples != 0 && pcmDataSize < stream.pcmDataCapacity;
+}
+
+void Pcm::closeOggStream(OggStream& stream)
+{
+  if (stream.audioStream != nullptr)
+  {
+    SDL_FreeAudioStream(stream.audioStream);
+    stream.audioStream = nullptr;
+  }
+  Ogg::close(stream.vorbis);
+  stream.vorbis = nullptr;
+}
@@ -3,9 +3,33 @@
 
 #include "typedefs.h"
 
+#include <atomic>
+
+namespace Ogg { struct vorbis; }
+struct _SDL_AudioStream;
+
 namespace Pcm {
   i32 decodeOgg(const u8* oggData, u64 oggDataSize, u8** pcmData, u64& pcmDataSize);
   void resample(u8** pcmData, u64& pcmDataSize, i32 inSampleRate, i32 outSampleRate);
+
+  // Decodes and resamples an ogg piece by piece, so the beginning can be played while the rest is still decoded.
+  // pcmData is allocated for the whole stream when it is opened and never moves.
+  struct OggStream
+  {
+    u8* pcmData = nullptr;
+    u64 pcmDataCapacity = 0;
+    std::atomic<u64> pcmDataSize = 0; // decoded bytes. Grows with each decodeOggStream call
+
+    Ogg::vorbis* vorbis = nullptr;
+    _SDL_AudioStream* audioStream = nullptr; // nullptr if the sample rates match
+    i32 sampleRate = 0; // of the ogg
+    u64 totalSamples = 0;
+  };
+  // Fails if the ogg does not tell its length.
+  bool openOggStream(OggStream& stream, const u8* oggData, u64 oggDataSize, i32 outSampleRate);
+  // Returns false when the whole stream is decoded. Does not free pcmData.
+  bool decodeOggStream(OggStream& stream);
+  void closeOggStream(OggStream& stream);
 }
 
 #endif // PCM_H
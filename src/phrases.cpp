@@ -3,6 +3,7 @@
 
 #include "global.h"
 #include "opengl.h"
+#include "player.h"
 #include "shader.h"
 #include "song.h"
 
@@ -27,11 +28,7 @@ void Phrases::tick()
       {
         const f32 progress = f32(Global::inputCursorPosX - left) / f32(right - left);
 
-        const i64 prog = (u64(progress * Global::musicBufferLength) / sizeof(f32)) * sizeof(f32); // make sure we don't end somewhere between two f32.
-
-        Global::musicBufferPosition = &Global::musicBuffer[prog];
-
-        Global::musicTimeElapsed = (progress * f32(Global::musicBufferLength)) / f32(2 * Global::settings.audioSampleRate * sizeof(f32));
+        Player::seek(progress);
       }
 
       return;
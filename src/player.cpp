@@ -5,12 +5,61 @@
 #include "psarc.h"
 #include "song.h"
 #include "player.h"
+#include "threadPool.h"
 #include "wem.h"
 #include "pcm.h"
 #include "sound.h"
 
-static bool playNextTick = false;
+#include <memory>
+#include <mutex>
+
+#include <SDL2/SDL.h>
+
+namespace {
+  // A song or preview that is started. Its stages run in parallel on the worker threads and
+  // Player::tick publishes their results on the main thread as soon as they are finished.
+  // A cancelled load is not waited for. It is destroyed when its last stage returns.
+  struct SongLoad
+  {
+    ~SongLoad()
+    {
+      free(audio.pcmData); // also Global::musicBuffer while this load is published
+    }
+
+    Psarc::Info psarcInfo; // own copy. Global::psarcInfos can grow while the stages run
+    InstrumentFlags instrumentFlags = InstrumentFlags::none;
+    bool preview = false;
+    i32 sampleRate = 0;
+
+    Song::Info songInfo;
+    Song::Track track;
+    std::vector<Song::Vocal> vocals;
+    std::vector<u8> ogg; // converted from wem
+    Psarc::Content repackedOgg; // held while it is decoded
+    Pcm::OggStream audio;
+
+    std::atomic<bool> cancel = false;
+    std::atomic<bool> songInfoLoaded = false;
+    std::atomic<bool> arrangementLoaded = false;
+    std::atomic<bool> audioStarted = false; // the first piece of audio.pcmData is decoded
+    std::atomic<bool> audioLoaded = false;
+
+    // published by tick
+    bool songInfoPublished = false;
+    bool arrangementPublished = false;
+    bool audioPublished = false;
+    bool playing = false;
+  };
+}
+
+static std::shared_ptr<SongLoad> songLoad;
 static bool previewPlaying = false;
+static f32 musicStallTime = 0.0f; // the song time still waits this long for the stalled audio
+
+static f32 musicBufferTime(u64 length)
+{
+  return f32(length) / f32(2 * Global::settings.audioSampleRate * sizeof(f32));
+}
 
 static u32 readWemFileIdFromBnkFile(const u8* data, u64 size)
 {
@@ -30,55 +79,190 @@ static u32 readWemFileIdFromBnkFile(const u8* data, u64 size)
   return fileId;
 }
 
-static void loadAudio(const Psarc::Info& psarcInfo, bool preview)
+// Audio stage. Playback can start with the first decoded piece, the rest is decoded while it plays.
+static void loadAudio(SongLoad& load)
 {
-  for (const Psarc::Info::TOCEntry& tocEntry : psarcInfo.tocEntries)
+  const Psarc::Info& psarcInfo = load.psarcInfo;
+
+  const i32 bnkTocIndex = load.preview ? psarcInfo.lookup.previewBnk : psarcInfo.lookup.songBnk;
+  ASSERT(bnkTocIndex != -1);
+
+  const Psarc::Content bnkData = Psarc::content(psarcInfo, psarcInfo.tocEntries[bnkTocIndex]);
+  const u32 wemFileId = readWemFileIdFromBnkFile(bnkData.data(), bnkData.size());
+  if (load.cancel)
+    return;
+
+  const i32 wemTocIndex = Psarc::findWemTocIndex(psarcInfo, wemFileId);
+  ASSERT(wemTocIndex != -1);
+
+  const Psarc::Info::TOCEntry& wemTocEntry = psarcInfo.tocEntries[wemTocIndex];
+  const u8* oggData;
+  u64 oggDataSize;
+  if (wemTocEntry.format == Psarc::ContentFormat::ogg)
+  { // repacked archives store the converted ogg
+    load.repackedOgg = Psarc::content(psarcInfo, wemTocEntry);
+    oggData = load.repackedOgg.data();
+    oggDataSize = load.repackedOgg.size();
+  }
+  else
   {
-    if ((preview && !tocEntry.name.ends_with("_preview.bnk")) || !tocEntry.name.ends_with(".bnk"))
-      continue;
+    load.ogg = Wem::to_ogg(Psarc::content(psarcInfo, wemTocEntry).data(), wemTocEntry.length);
+    oggData = load.ogg.data();
+    oggDataSize = load.ogg.size();
+  }
+  if (load.cancel)
+    return;
 
-    const u32 wemFileId = readWemFileIdFromBnkFile(tocEntry.content.data(), tocEntry.content.size());
+  if (Pcm::openOggStream(load.audio, oggData, oggDataSize, load.sampleRate))
+  {
+    if (Pcm::decodeOggStream(load.audio))
+    {
+      load.audioStarted = true;
+      while (!load.cancel && Pcm::decodeOggStream(load.audio))
+      {
+      }
+    }
+    Pcm::closeOggStream(load.audio);
+  }
+  else
+  { // the ogg does not tell its length. Decode it as a whole
+    u64 pcmDataSize;
+    const i32 sampleRate = Pcm::decodeOgg(oggData, oggDataSize, &load.audio.pcmData, pcmDataSize);
+    Pcm::resample(&load.audio.pcmData, pcmDataSize, sampleRate, load.sampleRate);
+    load.audio.pcmDataCapacity = pcmDataSize;
+    load.audio.pcmDataSize = pcmDataSize;
+  }
 
-    char wemFileName[40];
+  load.audioLoaded = true;
+  load.audioStarted = true;
+}
 
-#ifdef _WIN32
-#pragma warning( disable: 4996 ) // ignore msvc unsafe warning
-#endif // _WIN32
-    sprintf(wemFileName, "%u.wem", wemFileId);
-#ifdef _WIN32
-#pragma warning( default: 4996 )
-#endif // _WIN32
+// Runs stage on a worker. The SongLoad stays alive until every stage is finished.
+// A stage that starts after its load was cancelled does nothing.
+template<typename Stage>
+static void runStage(const std::shared_ptr<SongLoad>& load, Stage stage)
+{
+  ThreadPool::run([load, stage]
+    {
+      if (!load->cancel)
+        stage(*load);
+    });
+}
 
-    for (const Psarc::Info::TOCEntry& tocEntry2 : psarcInfo.tocEntries)
+// Does not wait for the stages of the cancelled song. Content they still read is held by them, not by the pin.
+static void cancelSongLoad()
+{
+  if (songLoad == nullptr)
+    return;
+
+  songLoad->cancel = true;
+
+  if (songLoad->audioPublished)
+  { // the buffer is freed with the load. The playback callback must be done with it
+    Sound::lockPlayback();
+    Global::musicBufferPosition = nullptr;
+    Global::musicBuffer = nullptr;
+    Global::musicBufferLength = 0;
+    Global::musicBufferDecodedLength = 0;
+    Sound::unlockPlayback();
+  }
+
+  Psarc::pinContent(nullptr);
+  songLoad.reset();
+}
+
+static std::shared_ptr<SongLoad> startSongLoad(const Psarc::Info& psarcInfo, bool preview)
+{
+  cancelSongLoad();
+
+  const std::shared_ptr<SongLoad> load = std::make_shared<SongLoad>();
+  load->psarcInfo = psarcInfo; // the copy does not share the cached content, it is inflated again on demand
+  load->preview = preview;
+  load->sampleRate = Global::settings.audioSampleRate;
+
+  Psarc::pinContent(&load->psarcInfo); // audio, arrangement and tones stay inflated while the song is played
+  songLoad = load;
+  previewPlaying = preview;
+
+  return load;
+}
+
+// Publishes the finished stages. The song starts when its info, its arrangement and the first piece of audio are there.
+static void publishSongLoad()
+{
+  if (songLoad == nullptr)
+    return;
+
+  SongLoad& load = *songLoad;
+
+  if (load.songInfoLoaded && !load.songInfoPublished)
+  { // the collection can change while the song loads. Look the song up again
+    const std::unique_lock lock(Global::psarcInfosMutex);
+    for (u64 i = 0; i < Global::psarcInfos.size() && i < Global::songInfos.size(); ++i)
     {
-      if (!tocEntry2.name.ends_with(wemFileName))
+      if (Global::psarcInfos[i].filepath != load.psarcInfo.filepath)
         continue;
-     
-      const std::vector<u8> ogg = Wem::to_ogg(tocEntry2.content.data(), tocEntry2.length);
-      i32 sampleRate = Pcm::decodeOgg(ogg.data(), ogg.size(), &Global::musicBuffer, Global::musicBufferLength);
-      Pcm::resample(&Global::musicBuffer, Global::musicBufferLength, sampleRate, Global::settings.audioSampleRate);
 
-      playNextTick = true;
-      return;
+      Song::Info& songInfo = Global::songInfos[i];
+      songInfo.tones = std::move(load.songInfo.tones);
+      songInfo.loadState = load.songInfo.loadState;
+      break;
+    }
+    load.songInfoPublished = true;
+  }
+
+  if (load.arrangementLoaded && !load.arrangementPublished)
+  {
+    Global::songTrack = std::move(load.track);
+    Global::songVocals = std::move(load.vocals);
+    load.arrangementPublished = true;
+  }
+
+  if (load.audioStarted && !load.audioPublished)
+  { // the load keeps owning the buffer. It is freed when the load is cancelled and destroyed
+    Sound::lockPlayback();
+    Global::musicBufferPosition = nullptr;
+    Global::musicBuffer = load.audio.pcmData;
+    Global::musicBufferDecodedLength = 0;
+    Global::musicBufferLength = load.audioLoaded ? load.audio.pcmDataSize.load() : load.audio.totalSamples * u64(load.sampleRate) / u64(load.audio.sampleRate) * 2 * sizeof(f32);
+    Sound::unlockPlayback();
+    load.audioPublished = true;
+  }
+
+  if (load.audioPublished)
+  {
+    Global::musicBufferDecodedLength = load.audio.pcmDataSize.load();
+    if (load.audioLoaded && Global::musicBufferLength != load.audio.pcmDataSize)
+    {
+      Sound::lockPlayback();
+      Global::musicBufferLength = load.audio.pcmDataSize;
+      Sound::unlockPlayback();
     }
   }
 
-  ASSERT(false);
+  if (!load.playing && load.audioPublished && (load.preview || (load.songInfoPublished && load.arrangementPublished)))
+  {
+    Global::musicBufferPosition = Global::musicBuffer;
+    Global::musicBufferStalledLength = 0;
+    musicStallTime = 0.0f;
+    if (!load.preview)
+    {
+      Global::musicTimeElapsed = 0.0f;
+      Global::inputEsc.toggle = !Global::inputEsc.toggle;
+    }
+    load.playing = true;
+  }
 }
 
 static void playSongEmscripten()
 {
   const std::vector<u8> psarcData = Psarc::readPsarcData(EMSC_PATH(psarc/test.psarc));
 
-  const Psarc::Info psarcInfo = Psarc::parse(psarcData);
-  Global::songInfos.push_back(Song::loadSongInfoManifestOnly(psarcInfo));
+  Global::psarcInfos.push_back(Psarc::parse(psarcData));
+  Global::songInfos.push_back(Song::loadSongInfoManifestOnly(Global::psarcInfos[0]));
   Global::songSelected = 0;
-  Song::loadSongInfoComplete(psarcInfo, Global::songInfos[Global::songSelected]);
-
-  Global::songTrack = Song::loadTrack(psarcInfo, InstrumentFlags::LeadGuitar);
-  Global::songVocals = Song::loadVocals(psarcInfo);
 
-  loadAudio(psarcInfo, false);
+  Player::playSong(Global::psarcInfos[0], InstrumentFlags::LeadGuitar);
 }
 
 static f32 quickRepeaterBeginTime = 0.0f;
@@ -111,23 +295,27 @@ static void quickRepeater()
     Global::musicTimeElapsed = quickRepeaterBeginTime;
 
     Global::musicBufferPosition = quickRepeaterMusicBufferPosition;
+    musicStallTime = 0.0f;
   }
 }
 
+// The song time follows the frames, except while the playback waits for the decoder.
+// It never goes backwards, a stall that is reported late holds it back in the next frames.
+static void advanceMusicTime()
+{
+  musicStallTime += musicBufferTime(Global::musicBufferStalledLength.exchange(0)) * Global::musicSpeedMultiplier;
+
+  const f32 frameTime = (Global::frameDelta / 1000.0f) * Global::musicSpeedMultiplier;
+  const f32 wait = min_(frameTime, musicStallTime);
+  musicStallTime -= wait;
+  Global::musicTimeElapsed += frameTime - wait;
+}
+
 void Player::tick()
 {
-  Global::musicTimeElapsed += (Global::frameDelta / 1000.0f) * Global::musicSpeedMultiplier;
+  advanceMusicTime();
 
-  if (playNextTick)
-  {
-    Global::musicBufferPosition = Global::musicBuffer;
-    if (!previewPlaying)
-    {
-      Global::musicTimeElapsed = 0.0f;
-      Global::inputEsc.toggle = !Global::inputEsc.toggle;
-    }
-    playNextTick = false;
-  }
+  publishSongLoad();
 
   if (!previewPlaying)
   {
@@ -145,21 +333,91 @@ void Player::tick()
 
 void Player::playSong(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags)
 {
-  previewPlaying = false;
-  Song::loadSongInfoComplete(psarcInfo, Global::songInfos[Global::songSelected]);
+  const std::shared_ptr<SongLoad> load = startSongLoad(psarcInfo, false);
+  load->instrumentFlags = instrumentFlags;
+  load->songInfo = Global::songInfos[Global::songSelected];
 
-  Global::songTrack = Song::loadTrack(psarcInfo, instrumentFlags);
-  Global::songVocals = Song::loadVocals(psarcInfo);
-  loadAudio(psarcInfo, false);
+  runStage(load, [](SongLoad& load_)
+    {
+      Song::loadSongInfoComplete(load_.psarcInfo, load_.songInfo, &load_.cancel);
+      load_.songInfoLoaded = true;
+    });
+  runStage(load, [](SongLoad& load_)
+    {
+      Song::loadArrangement(load_.psarcInfo, load_.instrumentFlags, load_.track, load_.vocals, &load_.cancel);
+      load_.arrangementLoaded = true;
+    });
+  runStage(load, [](SongLoad& load_) { loadAudio(load_); });
+
+  publishSongLoad(); // without worker threads everything is loaded already
 }
 
 void Player::playPreview(const Psarc::Info& psarcInfo)
 {
-  previewPlaying = true;
-  loadAudio(psarcInfo, true);
+  const std::shared_ptr<SongLoad> load = startSongLoad(psarcInfo, true);
+
+  runStage(load, [](SongLoad& load_) { loadAudio(load_); });
+
+  publishSongLoad();
 }
 
 void Player::stop()
 {
+  cancelSongLoad();
+}
+
+void Player::mixMusic(u8* stream, i32 len)
+{
+  if (Global::musicBufferPosition == nullptr)
+    return;
+
+  const i64 remainingLength = &Global::musicBuffer[Global::musicBufferLength] - Global::musicBufferPosition;
+  if (remainingLength <= 0)
+  {
+    Global::musicBufferPosition = nullptr;
+    return;
+  }
 
+  const i64 decodedLength = &Global::musicBuffer[Global::musicBufferDecodedLength] - Global::musicBufferPosition;
+  const i32 mixLength = i32(clamp(decodedLength, i64(0), i64(min_(i64(len), remainingLength))));
+  if (mixLength > 0)
+  {
+    SDL_MixAudioFormat(stream, Global::musicBufferPosition, AUDIO_F32LSB, mixLength, Global::settings.mixerMusicVolume);
+    Global::musicBufferPosition += mixLength;
+  }
+  if (mixLength < len && mixLength < remainingLength) // the decoder fell behind. The song waits for it
+    Global::musicBufferStalledLength += u64(min_(i64(len), remainingLength) - mixLength);
+}
+
+void Player::seek(f32 progress)
+{
+  if (Global::musicBuffer == nullptr)
+    return;
+
+  const u64 frameSize = 2 * sizeof(f32);
+  u64 position = (u64(clamp(progress, 0.0f, 1.0f) * f32(Global::musicBufferLength)) / frameSize) * frameSize; // make sure we don't end somewhere between two samples
+  position = min_(position, (Global::musicBufferDecodedLength.load() / frameSize) * frameSize);
+
+  Global::musicBufferPosition = &Global::musicBuffer[position];
+  Global::musicBufferStalledLength = 0;
+  musicStallTime = 0.0f;
+  Global::musicTimeElapsed = musicBufferTime(position);
+}
+
+Player::LoadProgress Player::loadProgress()
+{
+  LoadProgress progress{};
+  if (songLoad == nullptr)
+    return progress;
+
+  const SongLoad& load = *songLoad;
+  progress.loading = !load.playing;
+  progress.songInfoLoaded = load.preview || load.songInfoPublished;
+  progress.arrangementLoaded = load.preview || load.arrangementPublished;
+  if (load.audioLoaded)
+    progress.audioDecoded = 1.0f;
+  else if (load.audioStarted)
+    progress.audioDecoded = f32(load.audio.pcmDataSize) / f32(load.audio.pcmDataCapacity);
+
+  return progress;
 }
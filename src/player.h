@@ -9,9 +9,27 @@ enum struct InstrumentFlags : u16;
 namespace Player {
   void tick();
 
+  // Both return at once. Song info, arrangement and audio are loaded on the worker threads.
+  // The song starts with the first decoded piece of audio, the rest is decoded while it plays.
+  // psarcInfo is copied, it does not need to outlive the call.
   void playSong(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags);
   void playPreview(const Psarc::Info& psarcInfo);
   void stop();
+
+  // Called by the playback callback. Mixes the next len bytes of the music into stream.
+  // While the decoder is behind, the missing bytes are not played but counted as a stall and the song time waits for them.
+  void mixMusic(u8* stream, i32 len);
+  // Jumps to progress (0.0 to 1.0) of the song, but not past the decoded audio.
+  void seek(f32 progress);
+
+  struct LoadProgress
+  {
+    bool loading; // the last started song does not play yet
+    bool songInfoLoaded;
+    bool arrangementLoaded;
+    f32 audioDecoded; // 0.0 to 1.0
+  };
+  LoadProgress loadProgress();
 }
 
 #endif // PLAYER_H
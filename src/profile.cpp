@@ -21,7 +21,7 @@ static std::map<std::string, std::map<std::string, std::string>> serialize(const
         { std::string("Score_") + Global::profileName, std::to_string(manifestInfo.score) },
       };
 
-      serializedSaves.insert({ manifestInfo.persistentID, serializedSave });
+      serializedSaves.insert({ manifestInfo.persistentID.c_str(), serializedSave });
     }
     break;
   case SaveMode::wholeManifest:
@@ -29,22 +29,22 @@ static std::map<std::string, std::map<std::string, std::string>> serialize(const
     {
       std::map<std::string, std::string> serializedSave =
       {
-        { "AlbumArt", manifestInfo.albumArt },
-        { "AlbumName", manifestInfo.albumName },
-        { "ArrangementName", manifestInfo.arrangementName },
-        { "ArtistName", manifestInfo.artistName },
+        { "AlbumArt", manifestInfo.albumArt.c_str() },
+        { "AlbumName", manifestInfo.albumName.c_str() },
+        { "ArrangementName", manifestInfo.arrangementName.c_str() },
+        { "ArtistName", manifestInfo.artistName.c_str() },
         { "BassPick", std::to_string(manifestInfo.bassPick) },
         { "CapoFret", std::to_string(manifestInfo.capoFret) },
         { "CentOffset", std::to_string(manifestInfo.centOffset) },
         { "LastPlayed", std::to_string(manifestInfo.lastPlayed) },
         { std::string("Score_") + Global::profileName, std::to_string(manifestInfo.score) },
         { "SongLength", std::to_string(manifestInfo.songLength) },
-        { "SongName", manifestInfo.songName },
+        { "SongName", manifestInfo.songName.c_str() },
         { "SongYear", std::to_string(manifestInfo.songYear) },
         { "Tuning", std::to_string(manifestInfo.tuning.string[0]) + ',' + std::to_string(manifestInfo.tuning.string[1]) + ',' + std::to_string(manifestInfo.tuning.string[2]) + ',' + std::to_string(manifestInfo.tuning.string[3]) + ',' + std::to_string(manifestInfo.tuning.string[4]) + ',' + std::to_string(manifestInfo.tuning.string[5])}
       };
 
-      serializedSaves.insert({ manifestInfo.persistentID, serializedSave });
+      serializedSaves.insert({ manifestInfo.persistentID.c_str(), serializedSave });
     }
     break;
   }
@@ -155,7 +155,7 @@ static void loadStatsOnly()
   {
     for (Manifest::Info& manifestInfo : songInfo.manifestInfos)
     {
-      const auto persistentIdIt = serializedSaves.find(manifestInfo.persistentID);
+      const auto persistentIdIt = serializedSaves.find(manifestInfo.persistentID.c_str());
       if (persistentIdIt != serializedSaves.end())
       {
         manifestInfo.lastPlayed = strtoul(persistentIdIt->second.at("LastPlayed").c_str(), nullptr, 0);
@@ -3,9 +3,17 @@
 #include "file.h"
 #include "global.h"
 #include "inflate.h"
+#include "md5.h"
 #include "rijndael.h"
+#include "sng.h"
+#include "threadPool.h"
 #include "wem.h"
 
+#include <filesystem>
+#include <functional>
+#include <condition_variable>
+#include <list>
+#include <mutex>
 #include <string.h>
 
 static const u8 psarcKey[32] = {
@@ -29,21 +37,21 @@ std::vector<u8> Psarc::readPsarcData(const char *filepath) {
     return psarcData;
 }
 
-static std::vector<u8> decryptPsarc(const std::vector<u8> &psarcData, u32 startPos, const u32 len) {
+static const i32 parallelInflateMinBlockCount = 4; // entries smaller than this are not worth the hand-off
 
-    // This is a bit strange not sure if the padding stuff is really required.
+static std::vector<u8> decryptPsarc(const u8 *psarcData, const u64 psarcSize, const u32 totalTocSize) {
+    const u32 tocSize = totalTocSize - 32;
 
-    std::vector<u8> encText;
-    std::copy(psarcData.begin() + startPos, psarcData.begin() + startPos + len, std::back_inserter(encText));
+    // CFB only decrypts whole blocks. The bytes following the TOC complete the last block and are cut off again.
+    const u32 blockAlignedSize = (tocSize + 15) & ~15_u32;
+    ASSERT(32 + blockAlignedSize <= psarcSize && "Invalid Psarc content");
 
-    const u32 pad = 512 - (len % 512);
-    encText.resize(encText.size() + pad);
+    std::vector<u8> plainText(blockAlignedSize);
 
-    std::vector<u8> plainText(encText.size());
+    static const Rijndael::Context psarcContext = Rijndael::makeContext(psarcKey);
+    Rijndael::decrypt(psarcContext, &psarcData[32], plainText.data(), plainText.size());
 
-    Rijndael::decrypt(psarcKey, encText.data(), plainText.data(), plainText.size());
-
-    plainText.resize(len - startPos);
+    plainText.resize(tocSize);
 
     return plainText;
 }
@@ -59,48 +67,108 @@ static i32 tocBNum(const u32 blockSizeAlloc) {
     return {};
 }
 
-static void inflateTocEntry(Psarc::Info::TOCEntry &tocEntry, const u32 blockSizeAlloc, const u8 *psarcData,
-                            const std::vector<u32> &zBlockSizeList) {
+static u64 tocEntryCompressedSize(const Psarc::Info::TOCEntry &tocEntry, const u32 blockSizeAlloc,
+                                  const std::vector<u32> &zBlockSizeList) {
+    const u64 blockCount = (tocEntry.length + blockSizeAlloc - 1) / blockSizeAlloc;
+
+    u64 compressedSize = 0;
+    for (u64 i = 0; i < blockCount; ++i) {
+        const u32 blockSize = zBlockSizeList[tocEntry.zIndexBegin + i];
+        compressedSize += blockSize == 0 ? blockSizeAlloc : blockSize;
+    }
+
+    return compressedSize;
+}
+
+static void inflateTocEntry(const Psarc::Info::TOCEntry &tocEntry, const u32 blockSizeAlloc, const u8 *zData,
+                            const std::vector<u32> &zBlockSizeList, std::vector<u8> &content) {
     if (tocEntry.length == 0)
         return;
 
-    tocEntry.content.resize(tocEntry.length);
+    content.resize(tocEntry.length);
+
+    // Every block except the last one inflates to blockSizeAlloc bytes.
+    // Knowing where each block starts in zData the blocks can be inflated independently.
+    const i32 blockCount = i32((tocEntry.length + blockSizeAlloc - 1) / blockSizeAlloc);
+    std::vector<u64> inOffsets(blockCount);
+    {
+        u64 inCur = 0;
+        for (i32 i = 0; i < blockCount; ++i) {
+            inOffsets[i] = inCur;
+            const u32 blockSize = zBlockSizeList[tocEntry.zIndexBegin + i];
+            inCur += blockSize == 0 ? blockSizeAlloc : blockSize;
+        }
+    }
 
-    const i32 zHeader = 0x78DA;
-    u32 zChunkId = tocEntry.zIndexBegin;
+    const auto inflateBlock = [&](const i32 i) {
+        const i32 zHeader = 0x78DA;
+        const u32 blockSize = zBlockSizeList[tocEntry.zIndexBegin + i];
+        const u8 *in = &zData[inOffsets[i]];
+        u8 *out = &content[u64(i) * blockSizeAlloc];
+        const i32 outSize = i32(min_(u64(blockSizeAlloc), tocEntry.length - u64(i) * blockSizeAlloc));
 
-    u64 inCur = 0;
-    i32 outCur = 0;
-    do {
-        const u32 blockSize = zBlockSizeList[zChunkId];
         if (blockSize == 0) { // raw. full cluster used.
-            memcpy(&tocEntry.content[outCur], &psarcData[tocEntry.offset + inCur], blockSizeAlloc);
-            inCur += blockSizeAlloc;
-            outCur += blockSizeAlloc;
-        } else {
-            const u16 num = u16_be(&psarcData[tocEntry.offset + inCur]);
-            if (num == zHeader) {
-                const i32 size = Inflate::inflate(&psarcData[tocEntry.offset + inCur], blockSize, &tocEntry.content[outCur], i32(tocEntry.length - outCur));
-                inCur += blockSize;
-                outCur += size;
-            } else { // raw. used only for data(chunks) smaller than 64 kb
-                memcpy(&tocEntry.content[outCur], &psarcData[tocEntry.offset + inCur], blockSize);
-                inCur += blockSize;
-                outCur += blockSize;
-            }
+            ASSERT(u32(outSize) == blockSizeAlloc);
+            memcpy(out, in, blockSizeAlloc);
+        } else if (u16_be(in) == zHeader) {
+            const i32 size = Inflate::inflate(in, blockSize, out, outSize);
+            ASSERT(size == outSize);
+        } else { // raw. used only for data(chunks) smaller than 64 kb
+            ASSERT(blockSize == u32(outSize));
+            memcpy(out, in, blockSize);
         }
-        zChunkId += 1;
-    } while (outCur < tocEntry.length);
+    };
+
+    if (blockCount >= parallelInflateMinBlockCount) {
+        ThreadPool::parallelFor(blockCount, inflateBlock);
+    } else {
+        for (i32 i = 0; i < blockCount; ++i)
+            inflateBlock(i);
+    }
 }
 
-static void readManifest(std::vector<Psarc::Info::TOCEntry> &tocEnties, u32 blockSizeAlloc, const u8 *psarcData,
-                         const std::vector<u32> &zBlockSizeList) {
-    Psarc::Info::TOCEntry &tocEntry = tocEnties[0];
+static void buildLookup(Psarc::Info &psarcInfo) {
+    Psarc::Info::Lookup &lookup = psarcInfo.lookup;
+
+    for (i32 i = 1; i < i32(psarcInfo.tocEntries.size()); ++i) {
+        const std::string &name = psarcInfo.tocEntries[i].name;
+        const u64 slash = name.find_last_of('/');
+        const std::string_view basename = std::string_view(name).substr(slash == std::string::npos ? 0 : slash + 1);
+
+        if (basename.ends_with(".xblock")) {
+            if (lookup.xblock == -1)
+                lookup.xblock = i;
+        } else if (basename.ends_with(".hsan")) {
+            if (lookup.hsan == -1)
+                lookup.hsan = i;
+        } else if (basename.ends_with("_preview.bnk")) {
+            if (lookup.previewBnk == -1)
+                lookup.previewBnk = i;
+        } else if (basename.ends_with(".bnk")) {
+            if (lookup.songBnk == -1)
+                lookup.songBnk = i;
+        } else if (basename.ends_with("_64.dds")) {
+            lookup.albumArt64 = i;
+        } else if (basename.ends_with("_128.dds")) {
+            lookup.albumArt128 = i;
+        } else if (basename.ends_with("_256.dds")) {
+            lookup.albumArt256 = i;
+        } else if (basename.ends_with(".wem")) {
+            const u32 wemFileId = u32(strtoul(std::string(basename).c_str(), nullptr, 10));
+            lookup.wem.emplace(wemFileId, i);
+        }
 
-    ASSERT(tocEntry.name.empty());
+        const u64 underscore = basename.find_last_of('_');
+        if (underscore != std::string::npos)
+            lookup.suffix.emplace(basename.substr(underscore), i);
+    }
+}
 
-    tocEntry.name = "NameBlock.bin";
-    inflateTocEntry(tocEntry, blockSizeAlloc, psarcData, zBlockSizeList);
+static void readManifest(Psarc::Info &psarcInfo) {
+    std::vector<Psarc::Info::TOCEntry> &tocEnties = psarcInfo.tocEntries;
+    Psarc::Info::TOCEntry &tocEntry = tocEnties[0];
+
+    ASSERT(tocEntry.name == "NameBlock.bin");
 
     { // read names of toc entries.
         i32 begin = 0;
@@ -113,49 +181,51 @@ static void readManifest(std::vector<Psarc::Info::TOCEntry> &tocEnties, u32 bloc
         }
         tocEnties[tocIndex].name = std::string(reinterpret_cast<const char*>(&tocEntry.content[begin]), tocEntry.content.size() - begin);
     }
-}
 
-Psarc::Info Psarc::parse(const std::vector<u8> &psarcData) {
-    Info psarcInfo;
+    buildLookup(psarcInfo);
+}
 
-    { // parse Header
-        psarcInfo.header.magicNumber = u32_be(&psarcData[0]);
-        ASSERT(psarcInfo.header.magicNumber == 1347633490_u32 && "Invalid Psarc content");
-        psarcInfo.header.version = u32_be(&psarcData[4]);
-        psarcInfo.header.compressMethod = u32_be(&psarcData[8]);
-        psarcInfo.header.totalTocSize = u32_be(&psarcData[12]);
-        psarcInfo.header.TOCEntrySize = u32_be(&psarcData[16]);
-        psarcInfo.header.numFiles = u32_be(&psarcData[20]);
-        psarcInfo.header.blockSizeAlloc = u32_be(&psarcData[24]);
-        psarcInfo.header.archiveFlags = u32_be(&psarcData[28]);
-    }
+static void parseHeader(Psarc::Info &psarcInfo, const u8 *psarcData) {
+    psarcInfo.header.magicNumber = u32_be(&psarcData[0]);
+    ASSERT(psarcInfo.header.magicNumber == 1347633490_u32 && "Invalid Psarc content");
+    psarcInfo.header.version = u32_be(&psarcData[4]);
+    psarcInfo.header.compressMethod = u32_be(&psarcData[8]);
+    psarcInfo.header.totalTocSize = u32_be(&psarcData[12]);
+    psarcInfo.header.TOCEntrySize = u32_be(&psarcData[16]);
+    psarcInfo.header.numFiles = u32_be(&psarcData[20]);
+    psarcInfo.header.blockSizeAlloc = u32_be(&psarcData[24]);
+    psarcInfo.header.archiveFlags = u32_be(&psarcData[28]);
+
+    ASSERT(psarcInfo.header.compressMethod == 2053925218);
+}
 
+static void parseToc(Psarc::Info &psarcInfo, const u8 *psarcData, const u64 psarcSize) {
     { // parse TOC
-        psarcInfo.tocRaw = decryptPsarc(psarcData, 32, psarcInfo.header.totalTocSize);
+        psarcInfo.tocRaw = decryptPsarc(psarcData, psarcSize, psarcInfo.header.totalTocSize);
         for (u32 i = 0; i < psarcInfo.header.numFiles; ++i) {
             const u64 offset = i * 30;
-            Info::TOCEntry tocEntry;
+            Psarc::Info::TOCEntry tocEntry;
             memcpy(tocEntry.md5, &psarcInfo.tocRaw[offset], 16);
             tocEntry.zIndexBegin = u32_be(&psarcInfo.tocRaw[offset + 16]);
             tocEntry.length = u40_be(&psarcInfo.tocRaw[offset + 20]);
             tocEntry.offset = u40_be(&psarcInfo.tocRaw[offset + 25]);
             psarcInfo.tocEntries.push_back(tocEntry);
         }
+        psarcInfo.tocEntries[0].name = "NameBlock.bin";
     }
 
-    std::vector<u32> zBlockSizeList;
     { // parse zBlockSizeList
         const i32 tocSize = psarcInfo.header.totalTocSize - 32;
         const i32 tocChunkSize = (int) (psarcInfo.header.numFiles * psarcInfo.header.TOCEntrySize);
         const i32 bNum = tocBNum(psarcInfo.header.blockSizeAlloc);
         const i32 zNum = (tocSize - tocChunkSize) / bNum;
         const u64 offset = psarcInfo.header.numFiles * 30;
-        zBlockSizeList.resize(zNum);
+        psarcInfo.zBlockSizeList.resize(zNum);
 
         for (int i = 0; i < zNum; ++i) {
             switch (bNum) {
                 case 2: // 64KB
-                    zBlockSizeList[i] = u16_be(&psarcInfo.tocRaw[offset + i * 2]);
+                    psarcInfo.zBlockSizeList[i] = u16_be(&psarcInfo.tocRaw[offset + i * 2]);
                     break;
                 default:
                     ASSERT(false);
@@ -163,27 +233,567 @@ Psarc::Info Psarc::parse(const std::vector<u8> &psarcData) {
             }
         }
     }
+}
 
-    { // decompress
-        switch (psarcInfo.header.compressMethod) {
-            case 2053925218:
-                readManifest(psarcInfo.tocEntries, psarcInfo.header.blockSizeAlloc, &psarcData[0],
-                             zBlockSizeList);
-                break;
-            default:
-                ASSERT(false);
-                break;
-        }
-    }
+Psarc::Info Psarc::parse(const std::vector<u8> &psarcData) {
+    Info psarcInfo;
+
+    ASSERT(psarcData.size() >= 32 && "Invalid Psarc content");
+    parseHeader(psarcInfo, psarcData.data());
+    ::parseToc(psarcInfo, psarcData.data(), psarcData.size());
 
     { // inflate entries
-        for (Info::TOCEntry &tocEntry: psarcInfo.tocEntries) {
-            if (tocEntry.name == "NameBlock.bin")
+        for (const Info::TOCEntry &tocEntry: psarcInfo.tocEntries) {
+            if (tocEntry.length == 0)
                 continue;
 
-            inflateTocEntry(tocEntry, psarcInfo.header.blockSizeAlloc, &psarcData[0], zBlockSizeList);
+            inflateTocEntry(tocEntry, psarcInfo.header.blockSizeAlloc, &psarcData[tocEntry.offset], psarcInfo.zBlockSizeList, tocEntry.content);
         }
     }
 
+    readManifest(psarcInfo);
+
+    return psarcInfo;
+}
+
+Psarc::Info Psarc::parseToc(const char *filepath) {
+    Info psarcInfo;
+    psarcInfo.filepath = filepath;
+
+    loadToc(psarcInfo);
+
     return psarcInfo;
 }
+
+static const u32 repackMagic = 0x4B504652; // "RFPK"
+static const u32 repackVersion = 1;
+static const u64 repackAlignment = 4096;
+
+namespace {
+    struct RepackHeader {
+        u32 magic;
+        u32 version;
+        u64 sourceSize;
+        i64 sourceWriteTime;
+        u32 entryCount;
+        u32 namesSize;
+    };
+    static_assert(sizeof(RepackHeader) == 32);
+
+    struct RepackEntry {
+        u64 offset;
+        u64 length;
+        u32 nameOffset;
+        u32 nameLength;
+        u32 format;
+        u32 reserved;
+    };
+    static_assert(sizeof(RepackEntry) == 32);
+}
+
+static bool sourceFileState(const char *filepath, u64 &size, i64 &writeTime) {
+    std::error_code error;
+    size = std::filesystem::file_size(filepath, error);
+    if (error)
+        return false;
+    writeTime = std::filesystem::last_write_time(filepath, error).time_since_epoch().count();
+    return !error;
+}
+
+static bool loadRepacked(Psarc::Info &psarcInfo) {
+    const std::string repackPath = Psarc::repackPath(psarcInfo.filepath.c_str());
+    if (!File::exists(repackPath.c_str()))
+        return false;
+
+    u64 sourceSize;
+    i64 sourceWriteTime;
+    if (!sourceFileState(psarcInfo.filepath.c_str(), sourceSize, sourceWriteTime))
+        return false;
+
+    const std::shared_ptr<const File::MappedFile> mappedFile = File::map(repackPath.c_str());
+    if (mappedFile == nullptr || mappedFile->size < sizeof(RepackHeader))
+        return false;
+
+    RepackHeader header;
+    memcpy(&header, mappedFile->data, sizeof(header));
+    if (header.magic != repackMagic || header.version != repackVersion || header.sourceSize != sourceSize || header.sourceWriteTime != sourceWriteTime)
+        return false; // outdated. The psarc file is used until it is repacked again.
+    if (header.entryCount == 0 || sizeof(RepackHeader) + u64(header.entryCount) * sizeof(RepackEntry) + header.namesSize > mappedFile->size)
+        return false;
+
+    const u8 *entries = &mappedFile->data[sizeof(RepackHeader)];
+    const char *names = reinterpret_cast<const char *>(&entries[u64(header.entryCount) * sizeof(RepackEntry)]);
+
+    psarcInfo.header = {};
+    psarcInfo.header.numFiles = header.entryCount;
+    psarcInfo.tocEntries.resize(header.entryCount);
+    for (u32 i = 0; i < header.entryCount; ++i) {
+        RepackEntry entry;
+        memcpy(&entry, &entries[u64(i) * sizeof(RepackEntry)], sizeof(entry));
+        const bool validFormat = entry.format == u32(Psarc::ContentFormat::original) || entry.format == u32(Psarc::ContentFormat::sngPlainText) || entry.format == u32(Psarc::ContentFormat::ogg);
+        if (entry.offset > mappedFile->size || entry.length > mappedFile->size - entry.offset || u64(entry.nameOffset) + entry.nameLength > header.namesSize || !validFormat) {
+            psarcInfo.tocEntries.clear();
+            return false;
+        }
+
+        Psarc::Info::TOCEntry &tocEntry = psarcInfo.tocEntries[i];
+        tocEntry.name.assign(&names[entry.nameOffset], entry.nameLength);
+        tocEntry.length = entry.length;
+        tocEntry.offset = entry.offset;
+        tocEntry.format = Psarc::ContentFormat(entry.format);
+    }
+
+    psarcInfo.mappedFile = mappedFile;
+    psarcInfo.repacked = true;
+    File::advise(*mappedFile, 0, mappedFile->size, File::Access::random);
+
+    buildLookup(psarcInfo);
+
+    return true;
+}
+
+// Reads the content of an entry without the content cache
+static void loadContent(const Psarc::Info &psarcInfo, const Psarc::Info::TOCEntry &tocEntry, std::vector<u8> &content) {
+    ASSERT(psarcInfo.mappedFile != nullptr && "Psarc was not opened with parseToc");
+    ASSERT(!psarcInfo.repacked); // nothing to inflate, see Psarc::content
+
+    const File::MappedFile &mappedFile = *psarcInfo.mappedFile;
+
+    const u64 compressedSize = tocEntryCompressedSize(tocEntry, psarcInfo.header.blockSizeAlloc, psarcInfo.zBlockSizeList);
+    ASSERT(tocEntry.offset + compressedSize <= mappedFile.size && "Invalid Psarc content");
+
+    File::advise(mappedFile, tocEntry.offset, compressedSize, File::Access::willNeed);
+    inflateTocEntry(tocEntry, psarcInfo.header.blockSizeAlloc, &mappedFile.data[tocEntry.offset], psarcInfo.zBlockSizeList, content);
+}
+
+static void loadPsarcToc(Psarc::Info &psarcInfo) {
+    psarcInfo.mappedFile = File::map(psarcInfo.filepath.c_str());
+    ASSERT(psarcInfo.mappedFile != nullptr && psarcInfo.mappedFile->size >= 32 && "Invalid Psarc content");
+
+    const File::MappedFile &mappedFile = *psarcInfo.mappedFile;
+
+    parseHeader(psarcInfo, mappedFile.data);
+
+    // The TOC is read front to back once. Entries are accessed in any order afterwards.
+    File::advise(mappedFile, 0, psarcInfo.header.totalTocSize, File::Access::sequential);
+    ::parseToc(psarcInfo, mappedFile.data, mappedFile.size);
+    File::advise(mappedFile, 0, mappedFile.size, File::Access::random);
+
+    loadContent(psarcInfo, psarcInfo.tocEntries[0], psarcInfo.tocEntries[0].content); // owned by psarcInfo, never cached
+    readManifest(psarcInfo);
+}
+
+void Psarc::loadToc(Info &psarcInfo) {
+    if (psarcInfo.mappedFile != nullptr)
+        return;
+
+    if (loadRepacked(psarcInfo))
+        return;
+
+    loadPsarcToc(psarcInfo);
+}
+
+namespace {
+    struct ContentCache {
+        struct Node {
+            const Psarc::Info::TOCEntry *tocEntry;
+            u64 size;
+            u64 lastUsedFrame;
+            std::shared_ptr<const std::vector<u8>> content; // nullptr while a thread inflates it
+        };
+
+        std::mutex mutex;
+        std::condition_variable inflated;
+        std::list<Node> lru; // most recently used first
+        std::unordered_map<const Psarc::Info::TOCEntry *, std::list<Node>::iterator> nodes;
+        u64 frame = 0;
+        const Psarc::Info::TOCEntry *pinnedBegin = nullptr;
+        const Psarc::Info::TOCEntry *pinnedEnd = nullptr;
+        Psarc::ContentCacheStats stats = {};
+    };
+}
+
+static ContentCache &contentCache() {
+    // never destroyed. TOCEntries of static Infos still leave it while static destructors run at exit.
+    static ContentCache *contentCache = new ContentCache;
+    return *contentCache;
+}
+
+static void leaveContentCache(const Psarc::Info::TOCEntry &tocEntry) {
+    if (!tocEntry.cached)
+        return;
+
+    ContentCache &cache = contentCache();
+    const std::unique_lock lock(cache.mutex);
+
+    tocEntry.cached = false;
+
+    const auto it = cache.nodes.find(&tocEntry);
+    if (it == cache.nodes.end())
+        return;
+
+    cache.stats.size -= it->second->size;
+    cache.lru.erase(it->second);
+    cache.nodes.erase(it);
+}
+
+Psarc::Info::TOCEntry &Psarc::Info::TOCEntry::operator=(const TOCEntry &other) {
+    leaveContentCache(*this);
+
+    name = other.name;
+    memcpy(md5, other.md5, sizeof(md5));
+    zIndexBegin = other.zIndexBegin;
+    length = other.length;
+    offset = other.offset;
+    content = other.content;
+    format = other.format;
+
+    return *this;
+}
+
+Psarc::Info::TOCEntry &Psarc::Info::TOCEntry::operator=(TOCEntry &&other) noexcept {
+    leaveContentCache(*this);
+
+    name = std::move(other.name);
+    memcpy(md5, other.md5, sizeof(md5));
+    zIndexBegin = other.zIndexBegin;
+    length = other.length;
+    offset = other.offset;
+    content = std::move(other.content);
+    format = other.format;
+
+    return *this;
+}
+
+Psarc::Info::TOCEntry::~TOCEntry() {
+    leaveContentCache(*this);
+}
+
+void Psarc::pinContent(const Info *psarcInfo) {
+    ContentCache &cache = contentCache();
+    const std::unique_lock lock(cache.mutex);
+
+    if (psarcInfo == nullptr) {
+        cache.pinnedBegin = nullptr;
+        cache.pinnedEnd = nullptr;
+        return;
+    }
+
+    cache.pinnedBegin = psarcInfo->tocEntries.data();
+    cache.pinnedEnd = psarcInfo->tocEntries.data() + psarcInfo->tocEntries.size();
+}
+
+void Psarc::trimContentCache() {
+    ContentCache &cache = contentCache();
+    const std::unique_lock lock(cache.mutex);
+
+    const u64 budget = u64(max_(Global::settings.libraryContentCacheSize, 0)) * 1024 * 1024;
+
+    for (auto it = cache.lru.end(); cache.stats.size > budget && it != cache.lru.begin();) {
+        --it;
+
+        const bool pinned = std::less_equal<>()(cache.pinnedBegin, it->tocEntry) && std::less<>()(it->tocEntry, cache.pinnedEnd);
+        if (pinned || it->lastUsedFrame == cache.frame)
+            continue;
+        if (it->content == nullptr || it->content.use_count() > 1)
+            continue; // still inflating or held by a Content
+
+        it->tocEntry->cached = false;
+        cache.stats.size -= it->size;
+        ++cache.stats.evictions;
+        cache.nodes.erase(it->tocEntry);
+        it = cache.lru.erase(it);
+    }
+
+    ++cache.frame;
+}
+
+Psarc::ContentCacheStats Psarc::contentCacheStats() {
+    ContentCache &cache = contentCache();
+    const std::unique_lock lock(cache.mutex);
+
+    return cache.stats;
+}
+
+Psarc::Content Psarc::content(const Info &psarcInfo, const Info::TOCEntry &tocEntry) {
+    if (tocEntry.content.size() == tocEntry.length)
+        return { tocEntry.content.data(), tocEntry.content.size(), nullptr };
+
+    if (psarcInfo.repacked) { // stored uncompressed, the mapping is the content
+        const File::MappedFile &mappedFile = *psarcInfo.mappedFile;
+        File::advise(mappedFile, tocEntry.offset, tocEntry.length, File::Access::willNeed);
+        return { &mappedFile.data[tocEntry.offset], tocEntry.length, psarcInfo.mappedFile };
+    }
+
+    ContentCache &cache = contentCache();
+    std::unique_lock lock(cache.mutex);
+
+    for (auto it = cache.nodes.find(&tocEntry); it != cache.nodes.end(); it = cache.nodes.find(&tocEntry)) {
+        ContentCache::Node &node = *it->second;
+        if (node.content == nullptr) {
+            cache.inflated.wait(lock); // the node can be gone afterwards, it is looked up again
+            continue;
+        }
+
+        ++cache.stats.hits;
+        cache.lru.splice(cache.lru.begin(), cache.lru, it->second);
+        node.lastUsedFrame = cache.frame;
+        return { node.content->data(), node.content->size(), node.content };
+    }
+
+    // The node without content makes other threads wait for this one. trimContentCache skips it.
+    ++cache.stats.misses;
+    cache.lru.push_front({ &tocEntry, 0, cache.frame, nullptr });
+    cache.nodes.emplace(&tocEntry, cache.lru.begin());
+    tocEntry.cached = true;
+
+    lock.unlock();
+    const std::shared_ptr<std::vector<u8>> content = std::make_shared<std::vector<u8>>();
+    loadContent(psarcInfo, tocEntry, *content);
+    lock.lock();
+
+    ContentCache::Node &node = *cache.nodes.at(&tocEntry);
+    node.content = content;
+    node.size = content->size();
+    node.lastUsedFrame = cache.frame;
+    cache.stats.size += node.size;
+    cache.inflated.notify_all();
+
+    return { content->data(), content->size(), content };
+}
+
+static bool verifyTocEntry(const Psarc::Info &psarcInfo, const Psarc::Info::TOCEntry &tocEntry, std::vector<u8> &scratch) {
+    const File::MappedFile &mappedFile = *psarcInfo.mappedFile;
+    const u32 blockSizeAlloc = psarcInfo.header.blockSizeAlloc;
+    const u64 blockCount = (tocEntry.length + blockSizeAlloc - 1) / blockSizeAlloc;
+
+    if (tocEntry.zIndexBegin + blockCount > psarcInfo.zBlockSizeList.size())
+        return false;
+    if (tocEntry.offset + tocEntryCompressedSize(tocEntry, blockSizeAlloc, psarcInfo.zBlockSizeList) > mappedFile.size)
+        return false;
+
+    u64 inCur = tocEntry.offset;
+    for (u64 i = 0; i < blockCount; ++i) {
+        const u32 blockSize = psarcInfo.zBlockSizeList[tocEntry.zIndexBegin + i];
+        const i32 outSize = i32(min_(u64(blockSizeAlloc), tocEntry.length - i * blockSizeAlloc));
+        const u8 *in = &mappedFile.data[inCur];
+
+        if (blockSize == 0) {
+            if (u32(outSize) != blockSizeAlloc)
+                return false;
+            inCur += blockSizeAlloc;
+        } else if (blockSize >= 2 && u16_be(in) == 0x78DA) {
+            if (!Inflate::verify(in, blockSize, scratch.data(), outSize))
+                return false;
+            inCur += blockSize;
+        } else {
+            if (blockSize != u32(outSize))
+                return false;
+            inCur += blockSize;
+        }
+    }
+
+    return true;
+}
+
+// Maps the archive and reads header and TOC. Checks everything parseHeader and parseToc would assert on.
+static bool openCheckedToc(Psarc::Info &psarcInfo) {
+    psarcInfo.mappedFile = File::map(psarcInfo.filepath.c_str());
+    if (psarcInfo.mappedFile == nullptr || psarcInfo.mappedFile->size < 32)
+        return false;
+
+    const File::MappedFile &mappedFile = *psarcInfo.mappedFile;
+
+    const u32 magicNumber = u32_be(&mappedFile.data[0]);
+    const u32 compressMethod = u32_be(&mappedFile.data[8]);
+    const u32 totalTocSize = u32_be(&mappedFile.data[12]);
+    const u32 tocEntrySize = u32_be(&mappedFile.data[16]);
+    const u32 numFiles = u32_be(&mappedFile.data[20]);
+    const u32 blockSizeAlloc = u32_be(&mappedFile.data[24]);
+
+    if (magicNumber != 1347633490_u32 || compressMethod != 2053925218 || blockSizeAlloc != 65536 || tocEntrySize != 30)
+        return false;
+    if (numFiles == 0 || totalTocSize < 32 + u64(numFiles) * tocEntrySize)
+        return false;
+    if (32 + ((u64(totalTocSize - 32) + 15) & ~15_u64) > mappedFile.size)
+        return false;
+
+    parseHeader(psarcInfo, mappedFile.data);
+    ::parseToc(psarcInfo, mappedFile.data, mappedFile.size);
+
+    return true;
+}
+
+// The TOC stores the md5 of each entry name. NameBlock.bin itself has none.
+// On success the names are read like readManifest does.
+static bool readCheckedManifest(Psarc::Info &psarcInfo, std::vector<u8> &scratch) {
+    if (psarcInfo.header.numFiles < 2)
+        return false; // readManifest expects at least one name
+
+    const Psarc::Info::TOCEntry &nameBlockEntry = psarcInfo.tocEntries[0];
+    if (!verifyTocEntry(psarcInfo, nameBlockEntry, scratch))
+        return false;
+
+    loadContent(psarcInfo, nameBlockEntry, nameBlockEntry.content); // owned by psarcInfo like loadPsarcToc does
+    const std::vector<u8> &nameBlock = nameBlockEntry.content;
+
+    u64 begin = 0;
+    for (u32 i = 1; i < psarcInfo.header.numFiles; ++i) {
+        u64 end = begin;
+        while (end < nameBlock.size() && nameBlock[end] != '\n')
+            ++end;
+        if ((i + 1 < psarcInfo.header.numFiles) == (end == nameBlock.size()))
+            return false; // a name is missing or there are more names than entries
+
+        u8 md5[16];
+        Md5::hash(&nameBlock[0] + begin, end - begin, md5);
+        if (memcmp(md5, psarcInfo.tocEntries[i].md5, sizeof(md5)) != 0)
+            return false;
+
+        begin = end + 1;
+    }
+
+    readManifest(psarcInfo);
+
+    return true;
+}
+
+bool Psarc::verify(const char *filepath) {
+    Info psarcInfo;
+    psarcInfo.filepath = filepath;
+    if (!openCheckedToc(psarcInfo))
+        return false;
+
+    const File::MappedFile &mappedFile = *psarcInfo.mappedFile;
+    File::advise(mappedFile, 0, mappedFile.size, File::Access::sequential);
+
+    std::vector<u8> scratch(psarcInfo.header.blockSizeAlloc);
+    for (const Info::TOCEntry &tocEntry: psarcInfo.tocEntries)
+        if (!verifyTocEntry(psarcInfo, tocEntry, scratch))
+            return false;
+
+    return readCheckedManifest(psarcInfo, scratch);
+}
+
+bool Psarc::tryParseToc(const char *filepath, Info &psarcInfo) {
+    psarcInfo = Info();
+    psarcInfo.filepath = filepath;
+
+    if (loadRepacked(psarcInfo))
+        return true; // only verified archives are repacked
+
+    if (!openCheckedToc(psarcInfo))
+        return false;
+
+    File::advise(*psarcInfo.mappedFile, 0, psarcInfo.mappedFile->size, File::Access::random);
+
+    std::vector<u8> scratch(psarcInfo.header.blockSizeAlloc);
+    if (!readCheckedManifest(psarcInfo, scratch))
+        return false;
+
+    // the entries Song::loadSongInfoManifestOnly parses
+    for (const i32 tocIndex: { psarcInfo.lookup.xblock, psarcInfo.lookup.hsan })
+        if (tocIndex != -1 && !verifyTocEntry(psarcInfo, psarcInfo.tocEntries[tocIndex], scratch))
+            return false;
+
+    return true;
+}
+
+std::string Psarc::repackPath(const char *filepath) {
+    return std::string(filepath) + ".rfpack";
+}
+
+static bool endsWith(const std::string &name, const char *suffix) {
+    const u64 suffixLength = strlen(suffix);
+    return name.size() >= suffixLength && name.compare(name.size() - suffixLength, suffixLength, suffix) == 0;
+}
+
+bool Psarc::repack(const char *filepath) {
+    u64 sourceSize;
+    i64 sourceWriteTime;
+    if (!sourceFileState(filepath, sourceSize, sourceWriteTime))
+        return false;
+
+    if (!verify(filepath)) // everything below asserts on damaged files
+        return false;
+
+    Info psarcInfo;
+    psarcInfo.filepath = filepath;
+    loadPsarcToc(psarcInfo);
+
+    const u32 entryCount = u32(psarcInfo.tocEntries.size());
+
+    std::string names;
+    std::vector<RepackEntry> entries(entryCount);
+    for (u32 i = 0; i < entryCount; ++i) {
+        entries[i].nameOffset = u32(names.size());
+        entries[i].nameLength = u32(psarcInfo.tocEntries[i].name.size());
+        names += psarcInfo.tocEntries[i].name;
+    }
+
+    const RepackHeader header = { repackMagic, repackVersion, sourceSize, sourceWriteTime, entryCount, u32(names.size()) };
+
+    const u64 tableSize = sizeof(RepackHeader) + u64(entryCount) * sizeof(RepackEntry) + names.size();
+    std::vector<u8> repackData((tableSize + repackAlignment - 1) & ~(repackAlignment - 1));
+
+    for (u32 i = 0; i < entryCount; ++i) {
+        const Info::TOCEntry &tocEntry = psarcInfo.tocEntries[i];
+
+        // Not through content(). The cache could evict entries of this background thread.
+        if (tocEntry.content.size() != tocEntry.length)
+            loadContent(psarcInfo, tocEntry, tocEntry.content);
+
+        std::vector<u8> decoded;
+        const std::vector<u8> *data = &tocEntry.content;
+        ContentFormat format = ContentFormat::original;
+        if (i >= 1 && tocEntry.length > 0 && endsWith(tocEntry.name, ".sng")) {
+            decoded = Sng::decode(tocEntry.content);
+            data = &decoded;
+            format = ContentFormat::sngPlainText;
+        } else if (i >= 1 && tocEntry.length > 0 && endsWith(tocEntry.name, ".wem")) {
+            decoded = Wem::to_ogg(tocEntry.content.data(), tocEntry.content.size());
+            data = &decoded;
+            format = ContentFormat::ogg;
+        }
+
+        entries[i].offset = repackData.size();
+        entries[i].length = data->size();
+        entries[i].format = u32(format);
+        repackData.insert(repackData.end(), data->begin(), data->end());
+        repackData.resize((repackData.size() + repackAlignment - 1) & ~(repackAlignment - 1));
+
+        std::vector<u8>().swap(tocEntry.content);
+    }
+
+    memcpy(&repackData[0], &header, sizeof(header));
+    memcpy(&repackData[sizeof(header)], entries.data(), entries.size() * sizeof(RepackEntry));
+    memcpy(&repackData[sizeof(header) + entries.size() * sizeof(RepackEntry)], names.data(), names.size());
+
+    // written under a temporary name so a crash never leaves a half written container behind
+    const std::string repackPath = Psarc::repackPath(filepath);
+    const std::string tempPath = repackPath + ".tmp";
+    std::error_code error;
+    if (!File::save(tempPath.c_str(), reinterpret_cast<const char *>(repackData.data()), repackData.size())) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    std::filesystem::rename(tempPath, repackPath, error);
+    return !error;
+}
+
+i32 Psarc::findTocIndex(const Info &psarcInfo, const std::string &suffix) {
+    const auto it = psarcInfo.lookup.suffix.find(suffix);
+    if (it == psarcInfo.lookup.suffix.end())
+        return -1;
+
+    return it->second;
+}
+
+i32 Psarc::findWemTocIndex(const Info &psarcInfo, const u32 wemFileId) {
+    const auto it = psarcInfo.lookup.wem.find(wemFileId);
+    if (it == psarcInfo.lookup.wem.end())
+        return -1;
+
+    return it->second;
+}
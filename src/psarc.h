@@ -2,12 +2,28 @@
 #define PSARC_H
 
 #include "typedefs.h"
+#include "file.h"
+
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace Psarc {
     std::vector<u8> readPsarcData(const char *filepath);
 
+    enum struct ContentFormat : u8 {
+        original,
+        sngPlainText, // decrypted and inflated, see Sng::parsePlainText
+        ogg, // converted from wem
+    };
+
     struct Info {
+        std::string filepath; // set by parseToc. Entries are inflated from mappedFile on first access.
+        std::shared_ptr<const File::MappedFile> mappedFile;
+        bool repacked = false; // mappedFile is the fast-load container of filepath, see repack()
+
         struct {
             u32 magicNumber;
             u32 version;
@@ -20,18 +36,98 @@ namespace Psarc {
         } header;
 
         std::vector<u8> tocRaw;
+        std::vector<u32> zBlockSizeList;
         struct TOCEntry{
+            TOCEntry() = default;
+            TOCEntry(const TOCEntry &other) { *this = other; }
+            TOCEntry(TOCEntry &&other) noexcept { *this = std::move(other); }
+            TOCEntry &operator=(const TOCEntry &other); // the cached content is not shared, the copy inflates its own
+            TOCEntry &operator=(TOCEntry &&other) noexcept;
+            ~TOCEntry(); // leaves the content cache
+
             std::string name;
-            u8 md5[16];
-            u32 zIndexBegin;
-            u64 length;
-            u64 offset;
-            std::vector<u8> content;
+            u8 md5[16] = {};
+            u32 zIndexBegin = 0; // repacked archives have no zlib blocks
+            u64 length = 0;
+            u64 offset = 0;
+            // Use Psarc::content(). Archives from parse() own the content of every entry, archives from parseToc only that
+            // of NameBlock.bin. It is filled before the Info is shared and never changes afterwards.
+            mutable std::vector<u8> content;
+            mutable bool cached = false; // has content in the content cache. Guarded by its mutex
+            ContentFormat format = ContentFormat::original;
         };
         std::vector<TOCEntry> tocEntries;
+
+        // Built from the entry names when the TOC is read. All values are indices into tocEntries, -1 if the archive has no such entry.
+        struct Lookup {
+            i32 xblock = -1;
+            i32 hsan = -1;
+            i32 songBnk = -1;
+            i32 previewBnk = -1;
+            i32 albumArt64 = -1;
+            i32 albumArt128 = -1;
+            i32 albumArt256 = -1;
+            std::unordered_map<std::string, i32> suffix; // see findTocIndex
+            std::unordered_map<u32, i32> wem; // by the numeric file id in "<id>.wem"
+        } lookup;
     };
 
     Info parse(const std::vector<u8> &psarcData);
+    Info parseToc(const char *filepath); // reads only header, TOC and NameBlock.bin
+    void loadToc(Info &psarcInfo); // does the same for an Info that only has a filepath yet (e.g. from the collection index)
+
+    // The content of an entry. It holds a reference on the bytes, they stay valid as long as the Content is alive.
+    struct Content {
+        const u8 *bytes = nullptr;
+        u64 length = 0;
+        std::shared_ptr<const void> owner; // nullptr when the Info owns the bytes
+
+        const u8 *data() const { return bytes; }
+        u64 size() const { return length; }
+        bool empty() const { return length == 0; }
+        const u8 *begin() const { return bytes; }
+        const u8 *end() const { return bytes + length; }
+        const u8 &operator[](u64 i) const { return bytes[i]; }
+        operator std::span<const u8>() const { return { bytes, length }; }
+    };
+
+    // Entries of archives opened with parseToc/loadToc are inflated on first access and kept in a byte budgeted LRU cache.
+    // Entries of repacked archives are served straight from the mapped file and never enter the cache. Thread safe. An entry that is inflated by another thread is waited for instead of being inflated twice.
+    Content content(const Info &psarcInfo, const Info::TOCEntry &tocEntry);
+
+    // Entries of this archive are never evicted, nullptr unpins. Meant for the song that is played.
+    void pinContent(const Info *psarcInfo);
+
+    // Called once per frame. Evicts the least recently used entries until the cache fits into Library/ContentCacheSize.
+    // Pinned entries, entries used since the last call and entries that are still held by a Content stay.
+    void trimContentCache();
+
+    struct ContentCacheStats {
+        u64 size;
+        u64 hits;
+        u64 misses;
+        u64 evictions;
+    };
+    ContentCacheStats contentCacheStats();
+
+    // Checks a whole archive without asserting: header, TOC, every zlib block against its Adler-32 and the
+    // entry names against the md5s in the TOC. Reads every byte of the file, meant for a background thread.
+    bool verify(const char *filepath);
+
+    // parseToc for files that were never verified. Returns false instead of asserting on a damaged archive.
+    // Besides header and TOC it checks NameBlock.bin, the xblock and the hsan entry, everything a song is listed with.
+    bool tryParseToc(const char *filepath, Info &psarcInfo);
+
+    // Writes the fast-load container of a psarc file next to it. It holds every entry uncompressed, 4 KiB aligned
+    // and already decoded (sng plain text, ogg instead of wem) in the TOC order of the psarc file.
+    // loadToc prefers it over the psarc file as long as the psarc file was not modified.
+    std::string repackPath(const char *filepath);
+    bool repack(const char *filepath);
+
+    // suffix is the end of a file name starting at its last '_'. e.g. "_lead.sng", "_bass2.json", "_vocals.xml"
+    // Returns the index of the first entry with that suffix or -1.
+    i32 findTocIndex(const Info &psarcInfo, const std::string &suffix);
+    i32 findWemTocIndex(const Info &psarcInfo, u32 wemFileId);
 
     //void loadOgg(const Info& psarcInfo, bool preview);
 }
@@ -2,6 +2,18 @@
 
 #include <string.h>
 
+#if (defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)) && !defined(__EMSCRIPTEN__)
+#define RIJNDAEL_AES_NI // selected at runtime, the tables below are the fallback
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AES_NI_TARGET
+#else // _MSC_VER
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+#endif // _MSC_VER
+#endif
+
 static const u8 sm_S[] = {
         99, 124, 119, 123, 242, 107, 111, 197,
         48, 1, 103, 43, 254, 215, 171, 118,
@@ -581,20 +593,10 @@ static const u8 sm_rcon[] = {
         179, 125, 250, 239, 197, 145
 };
 
-static int m_Ke[15][4];
-static u8 m_chain[16];
-static int tk[4];
-
-static void makeKey(const u8 *key, const u8* iv) {
-    //Initialize the chain
-    memcpy(m_chain, iv, sizeof(m_chain));
+static void expandKey(const u8 *key, int Ke[15][4]) {
     int BC = 4;
     int i, j;
-    int m_Kd[15][4] = {};
-    for (i = 0; i <= 14; i++) {
-        for (j = 0; j < BC; j++)
-            m_Ke[i][j] = 0;
-    }
+    int tk[8]; // KC words of the 256 bit key
     int ROUND_KEY_COUNT = (14 + 1) * BC;
     int KC = 8;
     //Copy user material bytes into temporary ints
@@ -608,10 +610,8 @@ static void makeKey(const u8 *key, const u8* iv) {
     }
     //Copy values into round key arrays
     int t = 0;
-    for (j = 0; (j < KC) && (t < ROUND_KEY_COUNT); j++, t++) {
-        m_Ke[t / BC][t % BC] = tk[j];
-        m_Kd[14 - (t / BC)][t % BC] = tk[j];
-    }
+    for (j = 0; (j < KC) && (t < ROUND_KEY_COUNT); j++, t++)
+        Ke[t / BC][t % BC] = tk[j];
     int tt, rconpointer = 0;
     while (t < ROUND_KEY_COUNT) {
         //Extrapolate using phi (the round key evolution function)
@@ -632,24 +632,14 @@ static void makeKey(const u8 *key, const u8* iv) {
         for (j = KC / 2, i = j + 1; i < KC;)
             tk[i++] ^= tk[j++];
         //Copy values into round key arrays
-        for (j = 0; (j < KC) && (t < ROUND_KEY_COUNT); j++, t++) {
-            m_Ke[t / BC][t % BC] = tk[j];
-            m_Kd[14 - (t / BC)][t % BC] = tk[j];
-        }
+        for (j = 0; (j < KC) && (t < ROUND_KEY_COUNT); j++, t++)
+            Ke[t / BC][t % BC] = tk[j];
     }
-    //Inverse MixColumn where needed
-    for (int r = 1; r < 14; r++)
-        for (j = 0; j < BC; j++) {
-            tt = m_Kd[r][j];
-            m_Kd[r][j] = sm_U1[(tt >> 24) & 0xFF] ^
-                         sm_U2[(tt >> 16) & 0xFF] ^
-                         sm_U3[(tt >> 8) & 0xFF] ^
-                         sm_U4[tt & 0xFF];
-        }
+    // CFB only runs the cipher forward. No decryption key schedule is needed.
 }
 
-static void encryptBlock(const u8 *in, u8 *result) {
-    int *Ker = m_Ke[0];
+static void encryptBlock(const int Ke[15][4], const u8 *in, u8 *result) {
+    const int *Ker = Ke[0];
     int t0 = (*(in++) << 24);
     t0 |= (*(in++) << 16);
     t0 |= (*(in++) << 8);
@@ -669,7 +659,7 @@ static void encryptBlock(const u8 *in, u8 *result) {
     int a0, a1, a2, a3;
     //Apply Round Transforms
     for (int r = 1; r < 14; r++) {
-        Ker = m_Ke[r];
+        Ker = Ke[r];
         a0 = (sm_T1[(t0 >> 24) & 0xFF] ^
               sm_T2[(t1 >> 16) & 0xFF] ^
               sm_T3[(t2 >> 8) & 0xFF] ^
@@ -692,7 +682,7 @@ static void encryptBlock(const u8 *in, u8 *result) {
         t3 = a3;
     }
     //Last Round is special
-    Ker = m_Ke[14];
+    Ker = Ke[14];
     int tt = Ker[0];
     result[0] = sm_S[(t0 >> 24) & 0xFF] ^ (tt >> 24);
     result[1] = sm_S[(t1 >> 16) & 0xFF] ^ (tt >> 16);
@@ -720,25 +710,174 @@ static void Xor(u8 *buff, const u8 *chain) {
         *(buff++) ^= *(chain++);
 }
 
-static void decrypt_(const u8 *in, u8 *result, size_t n) {
+static void decrypt_(const int Ke[15][4], u8 chain[16], const u8 *in, u8 *result, size_t n) {
     const u8 *pin = in;
 
-    for (int i = 0; i < n / 16; i++) {
-        encryptBlock(m_chain, result);
+    for (size_t i = 0; i < n / 16; i++) {
+        encryptBlock(Ke, chain, result);
         Xor(result, pin);
-        memcpy(m_chain, pin, 16);
+        memcpy(chain, pin, 16);
         pin += 16;
         result += 16;
     }
 }
 
-void Rijndael::decrypt(const u8 *key, const u8 *in, u8 *result, size_t n, const u8* iv) {
-  if (iv == nullptr)
-  {
-    const u8 iv_empty[16] = {};
-    makeKey(key, iv_empty);
-  }
-  else
-    makeKey(key, iv);
-  decrypt_(in, result, n);
+// big endian 128 bit addition
+static void addToCounter(u8 counter[16], u64 value) {
+    for (int i = 15; i >= 0 && value != 0; i--) {
+        const u64 sum = counter[i] + (value & 0xFF);
+        counter[i] = u8(sum);
+        value = (value >> 8) + (sum >> 8);
+    }
+}
+
+static void decryptCtr_(const int Ke[15][4], u8 counter[16], const u8 *in, u8 *result, size_t n) {
+    for (size_t i = 0; i < n; i += 16) {
+        u8 keyStream[16];
+        encryptBlock(Ke, counter, keyStream);
+        const size_t blockSize = n - i < 16 ? n - i : 16;
+        for (size_t j = 0; j < blockSize; j++)
+            result[i + j] = in[i + j] ^ keyStream[j];
+        addToCounter(counter, 1);
+    }
+}
+
+#ifdef RIJNDAEL_AES_NI
+static bool cpuHasAesNi() {
+#ifdef _MSC_VER
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+    return (cpuInfo[2] & (1 << 25)) != 0;
+#else // _MSC_VER
+    return __builtin_cpu_supports("aes");
+#endif // _MSC_VER
+}
+
+static bool hasAesNi() {
+    static const bool aesNi = cpuHasAesNi();
+    return aesNi;
+}
+
+// CFB decryption only encrypts ciphertext that is already known, so the blocks are independent.
+// Eight blocks go through the AES units at once to hide the latency of aesenc.
+AES_NI_TARGET static void decryptAesNi(const u8 roundKeys[15][16], const u8 *iv, const u8 *in, u8 *result, size_t n) {
+    __m128i rk[15];
+    for (int r = 0; r < 15; r++)
+        rk[r] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(roundKeys[r]));
+
+    const size_t blockCount = n / 16;
+    const auto chain = [&](size_t block) {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i *>(block == 0 ? iv : &in[(block - 1) * 16]));
+    };
+
+    size_t i = 0;
+    for (; i + 8 <= blockCount; i += 8) {
+        __m128i b[8];
+        for (int j = 0; j < 8; j++)
+            b[j] = _mm_xor_si128(chain(i + j), rk[0]);
+        for (int r = 1; r < 14; r++)
+            for (int j = 0; j < 8; j++)
+                b[j] = _mm_aesenc_si128(b[j], rk[r]);
+        for (int j = 0; j < 8; j++) {
+            b[j] = _mm_aesenclast_si128(b[j], rk[14]);
+            const __m128i cipherText = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&in[(i + j) * 16]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(&result[(i + j) * 16]), _mm_xor_si128(b[j], cipherText));
+        }
+    }
+    for (; i < blockCount; i++) {
+        __m128i b = _mm_xor_si128(chain(i), rk[0]);
+        for (int r = 1; r < 14; r++)
+            b = _mm_aesenc_si128(b, rk[r]);
+        b = _mm_aesenclast_si128(b, rk[14]);
+        const __m128i cipherText = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&in[i * 16]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&result[i * 16]), _mm_xor_si128(b, cipherText));
+    }
+}
+
+AES_NI_TARGET static void decryptCtrAesNi(const u8 roundKeys[15][16], u8 counter[16], const u8 *in, u8 *result, size_t n) {
+    __m128i rk[15];
+    for (int r = 0; r < 15; r++)
+        rk[r] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(roundKeys[r]));
+
+    const size_t blockCount = n / 16;
+    size_t i = 0;
+    for (; i + 8 <= blockCount; i += 8) {
+        __m128i b[8];
+        for (int j = 0; j < 8; j++) {
+            b[j] = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(counter)), rk[0]);
+            addToCounter(counter, 1);
+        }
+        for (int r = 1; r < 14; r++)
+            for (int j = 0; j < 8; j++)
+                b[j] = _mm_aesenc_si128(b[j], rk[r]);
+        for (int j = 0; j < 8; j++) {
+            b[j] = _mm_aesenclast_si128(b[j], rk[14]);
+            const __m128i cipherText = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&in[(i + j) * 16]));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(&result[(i + j) * 16]), _mm_xor_si128(b[j], cipherText));
+        }
+    }
+    for (; i * 16 < n; i++) {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(counter)), rk[0]);
+        addToCounter(counter, 1);
+        for (int r = 1; r < 14; r++)
+            b = _mm_aesenc_si128(b, rk[r]);
+        b = _mm_aesenclast_si128(b, rk[14]);
+
+        u8 keyStream[16];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(keyStream), b);
+        const size_t blockSize = n - i * 16 < 16 ? n - i * 16 : 16;
+        for (size_t j = 0; j < blockSize; j++)
+            result[i * 16 + j] = in[i * 16 + j] ^ keyStream[j];
+    }
+}
+#endif // RIJNDAEL_AES_NI
+
+Rijndael::Context Rijndael::makeContext(const u8 *key) {
+    Context context;
+    expandKey(key, context.Ke);
+
+    // the same schedule in the byte order of the AES-NI instructions
+    for (int r = 0; r < 15; r++)
+        for (int c = 0; c < 4; c++) {
+            context.roundKeys[r][c * 4] = u8(context.Ke[r][c] >> 24);
+            context.roundKeys[r][c * 4 + 1] = u8(context.Ke[r][c] >> 16);
+            context.roundKeys[r][c * 4 + 2] = u8(context.Ke[r][c] >> 8);
+            context.roundKeys[r][c * 4 + 3] = u8(context.Ke[r][c]);
+        }
+
+    return context;
+}
+
+void Rijndael::decrypt(const Context &context, const u8 *in, u8 *result, size_t n, const u8 *iv) {
+    u8 chain[16] = {};
+    if (iv != nullptr)
+        memcpy(chain, iv, sizeof(chain));
+
+#ifdef RIJNDAEL_AES_NI
+    if (hasAesNi()) {
+        decryptAesNi(context.roundKeys, chain, in, result, n);
+        return;
+    }
+#endif // RIJNDAEL_AES_NI
+
+    decrypt_(context.Ke, chain, in, result, n);
+}
+
+void Rijndael::decryptCtr(const Context &context, const u8 *in, u8 *result, size_t n, const u8 *iv, u64 firstBlock) {
+    u8 counter[16];
+    memcpy(counter, iv, sizeof(counter));
+    addToCounter(counter, firstBlock);
+
+#ifdef RIJNDAEL_AES_NI
+    if (hasAesNi()) {
+        decryptCtrAesNi(context.roundKeys, counter, in, result, n);
+        return;
+    }
+#endif // RIJNDAEL_AES_NI
+
+    decryptCtr_(context.Ke, counter, in, result, n);
+}
+
+void Rijndael::decrypt(const u8 *key, const u8 *in, u8 *result, size_t n, const u8 *iv) {
+    decrypt(makeContext(key), in, result, n, iv);
 }
@@ -4,7 +4,20 @@
 #include "typedefs.h"
 
 namespace Rijndael {
-    void decrypt(const u8 *key, const u8 *in, u8 *result, size_t n, const u8* iv = nullptr);
+    // AES-256 key schedule. Built once per key and shared by any number of threads.
+    struct Context {
+        int Ke[15][4];
+        u8 roundKeys[15][16]; // Ke as bytes for the AES-NI path
+    };
+    Context makeContext(const u8 *key);
+
+    // CFB-128 decryption. iv == nullptr is an all zero IV. Uses AES-NI when the cpu has it.
+    void decrypt(const Context &context, const u8 *in, u8 *result, size_t n, const u8 *iv = nullptr);
+    void decrypt(const u8 *key, const u8 *in, u8 *result, size_t n, const u8 *iv = nullptr); // expands the key on every call
+
+    // CTR decryption with a big endian 128 bit counter. n does not need to be a multiple of 16.
+    // Starts at counter iv + firstBlock, so separate ranges of one stream can be decrypted in parallel.
+    void decryptCtr(const Context &context, const u8 *in, u8 *result, size_t n, const u8 *iv, u64 firstBlock = 0);
 };
 
 #endif // RIJNDAEL_H
\ No newline at end of file
@@ -0,0 +1,141 @@
+#ifndef SERIALIZE_H
+#define SERIALIZE_H
+
+#include "stringPool.h"
+#include "typedefs.h"
+
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Binary snapshots of data structures. One serialize function per type handles both directions with a Writer or a Reader,
+// so the layout can not get out of sync. The data is written in host byte order and is not meant to leave the machine.
+namespace Serialize
+{
+  struct Writer
+  {
+    static const bool reading = false;
+
+    std::vector<u8> data;
+
+    template<typename T>
+    void operator()(const T& value)
+    {
+      static_assert(std::is_trivially_copyable_v<T>);
+      const u8* begin = reinterpret_cast<const u8*>(&value);
+      data.insert(data.end(), begin, begin + sizeof(T));
+    }
+
+    void operator()(const std::string& value)
+    {
+      (*this)(u32(value.size()));
+      data.insert(data.end(), value.begin(), value.end());
+    }
+
+    // handles are only valid in this run. The text is written instead
+    void operator()(const StringPool::String& value)
+    {
+      const std::string_view view = value.view();
+      (*this)(u32(view.size()));
+      data.insert(data.end(), view.begin(), view.end());
+    }
+  };
+
+  struct Reader
+  {
+    static const bool reading = true;
+
+    const u8* cur;
+    const u8* end;
+    bool valid = true;
+
+    template<typename T>
+    void operator()(T& value)
+    {
+      static_assert(std::is_trivially_copyable_v<T>);
+      if (!valid || u64(end - cur) < sizeof(T))
+      {
+        valid = false;
+        return;
+      }
+      memcpy(&value, cur, sizeof(T));
+      cur += sizeof(T);
+    }
+
+    void operator()(std::string& value)
+    {
+      u32 size = 0;
+      (*this)(size);
+      if (!valid || u64(end - cur) < size)
+      {
+        valid = false;
+        return;
+      }
+      value.assign(reinterpret_cast<const char*>(cur), size);
+      cur += size;
+    }
+
+    void operator()(StringPool::String& value)
+    {
+      u32 size = 0;
+      (*this)(size);
+      if (!valid || u64(end - cur) < size)
+      {
+        valid = false;
+        return;
+      }
+      value = StringPool::intern(std::string_view(reinterpret_cast<const char*>(cur), size));
+      cur += size;
+    }
+  };
+
+  // T is const for the Writer.
+  template<typename Stream, typename T, typename Func>
+  void vector(Stream& stream, T& vector, Func serializeElement)
+  {
+    u32 size = u32(vector.size());
+    stream(size);
+    if constexpr (Stream::reading)
+    {
+      if (!stream.valid || u64(stream.end - stream.cur) < size) // every element takes at least one byte
+      {
+        stream.valid = false;
+        return;
+      }
+      vector.resize(size);
+    }
+    for (auto& element : vector)
+      serializeElement(stream, element);
+  }
+
+  // A vector of trivially copyable elements is copied as one block.
+  template<typename Stream, typename T>
+  void array(Stream& stream, T& vector)
+  {
+    using Element = typename std::remove_cvref_t<T>::value_type;
+    static_assert(std::is_trivially_copyable_v<Element>);
+
+    u32 size = u32(vector.size());
+    stream(size);
+    if constexpr (Stream::reading)
+    {
+      if (!stream.valid || u64(stream.end - stream.cur) / sizeof(Element) < size)
+      {
+        stream.valid = false;
+        return;
+      }
+      vector.resize(size);
+      if (size != 0) // data() of an empty vector can be nullptr
+        memcpy(vector.data(), stream.cur, u64(size) * sizeof(Element));
+      stream.cur += u64(size) * sizeof(Element);
+    }
+    else
+    {
+      const u8* begin = reinterpret_cast<const u8*>(vector.data());
+      stream.data.insert(stream.data.end(), begin, begin + u64(size) * sizeof(Element));
+    }
+  }
+}
+
+#endif // SERIALIZE_H
@@ -251,6 +251,13 @@ static std::map<std::string, std::map<std::string, std::string>> serialize(const
         { "GuitarStringColor6",     hexColor(settings.instrumentGuitarStringColor[6]) }
       }
     },
+    {
+      "Library",
+      {
+        { "ContentCacheSize", std::to_string(settings.libraryContentCacheSize) },
+        { "VerifyIntegrity",  std::to_string(settings.libraryVerifyIntegrity) }
+      }
+    },
     {
       "Midi",
       {
@@ -420,6 +427,8 @@ static Settings::Info deserialize(const std::map<std::string, std::map<std::stri
       colorVec4(serializedSettings.at("Instrument").at("GuitarStringColor5")),
       colorVec4(serializedSettings.at("Instrument").at("GuitarStringColor6"))
     },
+    .libraryContentCacheSize = atoi(serializedSettings.at("Library").at("ContentCacheSize").c_str()),
+    .libraryVerifyIntegrity = bool(atoi(serializedSettings.at("Library").at("VerifyIntegrity").c_str())),
 #ifdef SUPPORT_MIDI
     .autoConnectDevices = serializedSettings.at("Midi").at("AutoConnectDevices"),
 #endif // SUPPORT_MIDI
@@ -456,7 +465,12 @@ bool Settings::init(int argc, char* argv[]) {
   defaultSettings = serialize(Global::settings);
 
   if (Global::isInstalled)
-    Global::settings = deserialize(File::loadIni("settings.ini"));
+  {
+    std::map<std::string, std::map<std::string, std::string>> serializedSettings = File::loadIni("settings.ini");
+    for (const auto& [section, keyValues] : defaultSettings) // keys missing in an older settings.ini keep their default
+      serializedSettings[section].insert(keyValues.begin(), keyValues.end());
+    Global::settings = deserialize(serializedSettings);
+  }
 
   return true;
 }
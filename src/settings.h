@@ -101,6 +101,8 @@ namespace Settings {
       colorVec4("#D20000"),
       colorVec4("#009B71"),
     };
+    i32 libraryContentCacheSize = 256; // MB of inflated psarc entries
+    bool libraryVerifyIntegrity = false;
     u8 midiBinding[128] = { ARR_SET128(0xFF) };
     std::string autoConnectDevices;
     std::string bnkPath = "bnk";
@@ -113,7 +115,7 @@ namespace Settings {
     i32 mixerGuitar2Volume = 100;
     i32 mixerBass2Volume = 100;
     i32 mixerMicrophoneVolume = 100;
-    SongFormat profilePreferedSongFormat = SongFormat::xml;
+    SongFormat profilePreferedSongFormat = SongFormat::sng;
     SaveMode profileSaveMode = SaveMode::statsOnly;
     f32 uiScale = 1.0f;
   };
@@ -3,6 +3,7 @@
 #include "rijndael.h"
 #include "inflate.h"
 #include "helper.h"
+#include "threadPool.h"
 
 #include <string.h>
 
@@ -13,27 +14,28 @@ static const u8 sngKey[32] = {
   0x59, 0xDE, 0x7A, 0xDD, 0xA1, 0x8A, 0x3A, 0x30
 };
 
-static std::vector<u8> decryptSngData(const std::vector<u8>& sngData)
+static std::vector<u8> decryptSngData(std::span<const u8> sngData)
 {
   const u32 magicNumber = u32_le(&sngData[0]);
 
   assert(magicNumber == 0x4A);
 
-  u8 iv[16];
-  memcpy(iv, &sngData[8], sizeof(iv));
+  static const Rijndael::Context sngContext = Rijndael::makeContext(sngKey);
+
+  const u8* iv = &sngData[8];
+
+  // counter mode, every chunk can be decrypted on its own
+  static const i64 chunkSize = 64 * 1024;
 
   const i64 len = sngData.size() - 24;
   std::vector<u8> decrypedData(len);
-  for (i64 i = 0; i < len; i += 16)
-  {
-    Rijndael::decrypt(sngKey, &sngData[24 + i], &decrypedData[i], 16, iv);
-
+  const i32 chunkCount = i32((len + chunkSize - 1) / chunkSize);
+  ThreadPool::parallelFor(chunkCount, [&](i32 i)
     {
-      bool carry = true;
-      for (i64 j = (sizeof(iv)) - 1; j >= 0 && carry; j--)
-        carry = ((iv[j] = (u8)(iv[j] + 1)) == 0);
-    }
-  }
+      const i64 begin = i * chunkSize;
+      const i64 size = min_(chunkSize, len - begin);
+      Rijndael::decryptCtr(sngContext, &sngData[24 + begin], &decrypedData[begin], size, iv, begin / 16);
+    });
 
   return decrypedData;
 }
@@ -50,536 +52,303 @@ static std::vector<u8> inflateSngPlainText(const std::vector<u8>& decrypedSngDat
   return plainText;
 }
 
-Sng::Info Sng::parse(const std::vector<u8>& sngData)
+std::vector<u8> Sng::decode(std::span<const u8> sngData)
 {
-  Sng::Info sngInfo;
-
   const std::vector<u8> decrypedSngData = decryptSngData(sngData);
-  const std::vector<u8> plainText = inflateSngPlainText(decrypedSngData);
+  return inflateSngPlainText(decrypedSngData);
+}
 
-  u64 j = 0;
-  {
-    const i32 bpmCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.bpm.resize(bpmCount);
-    for (i32 i = 0; i < bpmCount; ++i)
-    {
-      sngInfo.bpm[i].time = f32_le(&plainText[j]);
-      j += 4;
-      sngInfo.bpm[i].measure = i16_le(&plainText[j]);
-      j += 2;
-      sngInfo.bpm[i].beat = i16_le(&plainText[j]);
-      j += 2;
-      sngInfo.bpm[i].phraseIteration = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.bpm[i].mask = i32_le(&plainText[j]);
-      j += 4;
-    }
-  }
+Sng::Info Sng::parse(std::span<const u8> sngData)
+{
+  return parsePlainText(decode(sngData));
+}
 
+// the file records that View reads through the Info structs directly
+static_assert(sizeof(Sng::Info::Bpm) == 16);
+static_assert(sizeof(Sng::Info::Phrase) == 44);
+static_assert(sizeof(Sng::Info::Chord) == 72);
+static_assert(sizeof(Sng::Info::BendData::BendData32) == 12);
+static_assert(sizeof(Sng::Info::ChordNotes) == 2376);
+static_assert(sizeof(Sng::Info::Vocal) == 60);
+static_assert(sizeof(Sng::Info::SymbolsHeader) == 32);
+static_assert(sizeof(Sng::Info::SymbolsTexture) == 144);
+static_assert(sizeof(Sng::Info::SymbolDefinition) == 44);
+static_assert(sizeof(Sng::Info::PhraseIteration) == 24);
+static_assert(sizeof(Sng::View::PhraseExtraInfoByLevel) == 16);
+static_assert(sizeof(Sng::Info::Action) == 260);
+static_assert(sizeof(Sng::Info::Event) == 260);
+static_assert(sizeof(Sng::Info::Tone) == 8);
+static_assert(sizeof(Sng::Info::Dna) == 8);
+static_assert(sizeof(Sng::Info::Section) == 88);
+static_assert(sizeof(Sng::Info::Arrangement::Anchor) == 28);
+static_assert(sizeof(Sng::View::AnchorExtension) == 12);
+static_assert(sizeof(Sng::Info::Arrangement::Fingerprint) == 20);
+static_assert(sizeof(Sng::View::Note) == 67);
+static_assert(sizeof(Sng::View::Metadata) == 83);
+static_assert(sizeof(Sng::View::MetadataTail) == 12);
+
+namespace {
+  // Reads the plaintext front to back. Once a read runs past the end, it stays invalid and every further read gives nothing.
+  struct PlainTextReader
   {
-    const i32 phraseCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.phrase.resize(phraseCount);
-    for (i32 i = 0; i < phraseCount; ++i)
-    {
-      sngInfo.phrase[i].solo = plainText[j];
-      j += 1;
-      sngInfo.phrase[i].disparity = plainText[j];
-      j += 1;
-      sngInfo.phrase[i].ignore = plainText[j];
-      j += 1;
-      sngInfo.phrase[i].paddin = plainText[j];
-      j += 1;
-      sngInfo.phrase[i].maxDifficulty = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.phrase[i].phraseIterationLinks = i32_le(&plainText[j]);
-      j += 4;
-      memcpy(&sngInfo.phrase[i].name, &plainText[j], 32);
-      j += 32;
-    }
-  }
+    std::span<const u8> plainText;
+    u64 j = 0;
+    bool valid = true;
 
-  {
-    const i32 chordCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.chord.resize(chordCount);
-    for (i32 i = 0; i < chordCount; ++i)
+    bool has(u64 size)
     {
-      sngInfo.chord[i].mask = plainText[j];
-      j += 4;
-      memcpy(&sngInfo.chord[i].frets, &plainText[j], 6);
-      j += 6;
-      memcpy(&sngInfo.chord[i].fingers, &plainText[j], 6);
-      j += 6;
-      memcpy(&sngInfo.chord[i].notes, &plainText[j], 24);
-      j += 24;
-      memcpy(&sngInfo.chord[i].name, &plainText[j], 32);
-      j += 32;
+      if (valid && size > plainText.size() - j)
+        valid = false;
+      return valid;
     }
-  }
+  };
+}
 
-  {
-    const i32 chordNotesCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.chordNotes.resize(chordNotesCount);
-    for (i32 i = 0; i < chordNotesCount; ++i)
-    {
-      memcpy(&sngInfo.chordNotes[i].noteMask, &plainText[j], 24);
-      j += 24;
-      memcpy(&sngInfo.chordNotes[i].bendData, &plainText[j], 2328);
-      j += 2328;
-      memcpy(&sngInfo.chordNotes[i].slideTo, &plainText[j], 6);
-      j += 6;
-      memcpy(&sngInfo.chordNotes[i].slideUnpitchTo, &plainText[j], 6);
-      j += 6;
-      memcpy(&sngInfo.chordNotes[i].vibrato, &plainText[j], 12);
-      j += 12;
-    }
-  }
+template<typename T>
+static T readRecord(PlainTextReader& reader)
+{
+  T record{};
+  if (!reader.has(sizeof(T)))
+    return record;
 
+  memcpy(&record, &reader.plainText[reader.j], sizeof(T));
+  reader.j += sizeof(T);
+  return record;
+}
+
+template<typename T>
+static Sng::View::Records<T> readRecords(PlainTextReader& reader, i32 count)
+{
+  if (count < 0 || !reader.has(u64(count) * sizeof(T)))
   {
-    const i32 vocalCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.vocal.resize(vocalCount);
-    for (i32 i = 0; i < vocalCount; ++i)
-    {
-      sngInfo.vocal[i].time = f32_le(&plainText[j]);
-      j += 4;
-      sngInfo.vocal[i].note = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.vocal[i].length = f32_le(&plainText[j]);
-      j += 4;
-      memcpy(&sngInfo.vocal[i].lyric, &plainText[j], 48);
-      j += 48;
-    }
+    reader.valid = false;
+    return {};
   }
 
-  if (sngInfo.vocal.size() > 0)
-  {
-    {
-      const i32 symbolsHeaderCount = u32_le(&plainText[j]);
-      j += 4;
-      sngInfo.symbolsHeader.resize(symbolsHeaderCount);
-      for (i32 i = 0; i < symbolsHeaderCount; ++i)
-      {
-        sngInfo.symbolsHeader[i].unk1 = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsHeader[i].unk2 = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsHeader[i].unk3 = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsHeader[i].unk4 = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsHeader[i].unk5 = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsHeader[i].unk6 = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsHeader[i].unk7 = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsHeader[i].unk8 = i32_le(&plainText[j]);
-        j += 4;
-      }
-    }
+  const Sng::View::Records<T> records{ &reader.plainText[reader.j], u64(count) };
+  reader.j += u64(count) * sizeof(T);
+  return records;
+}
 
-    {
-      const i32 symbolsTextureCount = u32_le(&plainText[j]);
-      j += 4;
-      sngInfo.symbolsTexture.resize(symbolsTextureCount);
-      for (i32 i = 0; i < symbolsTextureCount; ++i)
-      {
-        memcpy(&sngInfo.symbolsTexture[i].font, &plainText[j], 128);
-        j += 128;
-        sngInfo.symbolsTexture[i].fontpathLength = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsTexture[i].unk10 = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsTexture[i].width = i32_le(&plainText[j]);
-        j += 4;
-        sngInfo.symbolsTexture[i].height = i32_le(&plainText[j]);
-        j += 4;
-      }
-    }
+template<typename T>
+static Sng::View::Records<T> readCountedRecords(PlainTextReader& reader)
+{
+  const i32 count = readRecord<i32>(reader);
+  return readRecords<T>(reader, count);
+}
 
-    {
-      const i32 symbolDefinitionCount = u32_le(&plainText[j]);
-      j += 4;
-      sngInfo.symbolDefinition.resize(symbolDefinitionCount);
-      for (i32 i = 0; i < symbolDefinitionCount; ++i)
-      {
-        memcpy(&sngInfo.symbolDefinition[i].text, &plainText[j], 12);
-        j += 12;
-        memcpy(&sngInfo.symbolDefinition[i].rectOutter, &plainText[j], 16);
-        j += 16;
-        memcpy(&sngInfo.symbolDefinition[i].rectInner, &plainText[j], 16);
-        j += 16;
-      }
-    }
+// Checks a count before a vector is resized to it. Each item takes at least minimumSize bytes of the plaintext.
+static i32 readCount(PlainTextReader& reader, u64 minimumSize)
+{
+  const i32 count = readRecord<i32>(reader);
+  if (count < 0 || !reader.has(u64(count) * minimumSize))
+  {
+    reader.valid = false;
+    return 0;
   }
+  return count;
+}
 
+Sng::View Sng::view(std::span<const u8> plainText)
+{
+  Sng::View view;
+  PlainTextReader reader{ plainText };
+
+  view.bpm = readCountedRecords<Info::Bpm>(reader);
+  view.phrase = readCountedRecords<Info::Phrase>(reader);
+  view.chord = readCountedRecords<Info::Chord>(reader);
+  view.chordNotes = readCountedRecords<Info::ChordNotes>(reader);
+  view.vocal = readCountedRecords<Info::Vocal>(reader);
+  if (view.vocal.size() > 0)
   {
-    const i32 phraseIterationCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.phraseIteration.resize(phraseIterationCount);
-    for (i32 i = 0; i < phraseIterationCount; ++i)
-    {
-      sngInfo.phraseIteration[i].phraseId = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.phraseIteration[i].startTime = f32_le(&plainText[j]);
-      j += 4;
-      sngInfo.phraseIteration[i].nextPhraseTime = f32_le(&plainText[j]);
-      j += 4;
-      memcpy(&sngInfo.phraseIteration[i].difficulty, &plainText[j], 12);
-      j += 12;
-    }
+    view.symbolsHeader = readCountedRecords<Info::SymbolsHeader>(reader);
+    view.symbolsTexture = readCountedRecords<Info::SymbolsTexture>(reader);
+    view.symbolDefinition = readCountedRecords<Info::SymbolDefinition>(reader);
   }
+  view.phraseIteration = readCountedRecords<Info::PhraseIteration>(reader);
+  view.phraseExtraInfoByLevel = readCountedRecords<View::PhraseExtraInfoByLevel>(reader);
 
   {
-    const i32 phraseExtraInfoByLevelCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.phraseExtraInfoByLevel.resize(phraseExtraInfoByLevelCount);
-    for (i32 i = 0; i < phraseExtraInfoByLevelCount; ++i)
+    view.nLinkedDifficulty.resize(readCount(reader, 2 * sizeof(i32)));
+    for (View::NLinkedDifficulty& nLinkedDifficulty : view.nLinkedDifficulty)
     {
-      sngInfo.phraseExtraInfoByLevel[i].phraseId = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.phraseExtraInfoByLevel[i].difficulty = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.phraseExtraInfoByLevel[i].empty = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.phraseExtraInfoByLevel[i].levelJump = plainText[j];
-      j += 1;
-      sngInfo.phraseExtraInfoByLevel[i].redundant = i16_le(&plainText[j]);
-      j += 2;
-      sngInfo.phraseExtraInfoByLevel[i].padding = plainText[j];
-      j += 1;
+      nLinkedDifficulty.levelBreak = readRecord<i32>(reader);
+      nLinkedDifficulty.nLDPhrase = readCountedRecords<i32>(reader);
     }
   }
 
+  view.action = readCountedRecords<Info::Action>(reader);
+  view.event = readCountedRecords<Info::Event>(reader);
+  view.tone = readCountedRecords<Info::Tone>(reader);
+  view.dna = readCountedRecords<Info::Dna>(reader);
+  view.section = readCountedRecords<Info::Section>(reader);
+
   {
-    const i32 nLinkedDifficultyCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.nLinkedDifficulty.resize(nLinkedDifficultyCount);
-    for (i32 i = 0; i < nLinkedDifficultyCount; ++i)
+    view.arrangement.resize(readCount(reader, 9 * sizeof(i32))); // difficulty and eight counts
+    for (View::Arrangement& arrangement : view.arrangement)
     {
-      sngInfo.nLinkedDifficulty[i].levelBreak = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.nLinkedDifficulty[i].phraseCount = i32_le(&plainText[j]);
-      j += 4;
+      arrangement.difficulty = readRecord<i32>(reader);
+      arrangement.anchors = readCountedRecords<Info::Arrangement::Anchor>(reader);
+      arrangement.anchorExtensions = readCountedRecords<View::AnchorExtension>(reader);
+      arrangement.fingerprints1 = readCountedRecords<Info::Arrangement::Fingerprint>(reader);
+      arrangement.fingerprints2 = readCountedRecords<Info::Arrangement::Fingerprint>(reader);
+      arrangement.notes.resize(readCount(reader, sizeof(View::Note)));
+      for (View::NoteRecord& noteRecord : arrangement.notes)
       {
-        sngInfo.nLinkedDifficulty[i].nLDPhrase.resize(sngInfo.nLinkedDifficulty[i].phraseCount);
-        for (i32 ii = 0; ii < sngInfo.nLinkedDifficulty[i].phraseCount; ++ii)
-        {
-          sngInfo.nLinkedDifficulty[i].nLDPhrase[ii] = i32_le(&plainText[j]);
-          j += 4;
-        }
+        noteRecord.note = readRecord<View::Note>(reader);
+        noteRecord.bendData = readRecords<Info::BendData::BendData32>(reader, noteRecord.note.bendDataCount);
       }
+      arrangement.averageNotesPerIteration = readCountedRecords<f32>(reader);
+      arrangement.notesInIteration1 = readCountedRecords<i32>(reader);
+      arrangement.notesInIteration2 = readCountedRecords<i32>(reader);
     }
   }
 
-  {
-    const i32 actionCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.action.resize(actionCount);
-    for (i32 i = 0; i < actionCount; ++i)
-    {
-      sngInfo.action[i].time = f32_le(&plainText[j]);
-      j += 4;
-      memcpy(&sngInfo.action[i].actionName, &plainText[j], 256);
-      j += 256;
-    }
-  }
+  view.metadata = readRecord<View::Metadata>(reader);
+  view.tuning = readRecords<i16>(reader, view.metadata.stringCount);
+  view.metadataTail = readRecord<View::MetadataTail>(reader);
 
-  {
-    const i32 eventCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.event.resize(eventCount);
-    for (i32 i = 0; i < eventCount; ++i)
-    {
-      sngInfo.event[i].time = f32_le(&plainText[j]);
-      j += 4;
-      memcpy(&sngInfo.event[i].eventName, &plainText[j], 256);
-      j += 256;
-    }
-  }
+  if (!reader.valid)
+    return {};
 
-  {
-    const i32 toneCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.tone.resize(toneCount);
-    for (i32 i = 0; i < toneCount; ++i)
-    {
-      sngInfo.tone[i].time = f32_le(&plainText[j]);
-      j += 4;
-      sngInfo.tone[i].toneId = i32_le(&plainText[j]);
-      j += 4;
-    }
-  }
+  view.valid = true;
+  view.size = reader.j;
+  return view;
+}
+
+template<typename T>
+static std::vector<T> toVector(Sng::View::Records<T> records)
+{
+  std::vector<T> vector(records.size());
+  if (!records.empty())
+    memcpy(vector.data(), records.bytes, records.size() * sizeof(T));
+  return vector;
+}
+
+Sng::Info Sng::parsePlainText(std::span<const u8> plainText)
+{
+  const Sng::View view = Sng::view(plainText);
 
+  Sng::Info sngInfo;
+  if (!view.valid)
+    return sngInfo;
+
+  sngInfo.bpm = toVector(view.bpm);
+  sngInfo.phrase = toVector(view.phrase);
+  sngInfo.chord = toVector(view.chord);
+  sngInfo.chordNotes = toVector(view.chordNotes);
+  sngInfo.vocal = toVector(view.vocal);
+  sngInfo.symbolsHeader = toVector(view.symbolsHeader);
+  sngInfo.symbolsTexture = toVector(view.symbolsTexture);
+  sngInfo.symbolDefinition = toVector(view.symbolDefinition);
+  sngInfo.phraseIteration = toVector(view.phraseIteration);
+
+  sngInfo.phraseExtraInfoByLevel.resize(view.phraseExtraInfoByLevel.size());
+  for (i32 i = 0; i < i32(view.phraseExtraInfoByLevel.size()); ++i)
   {
-    const i32 dnaCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.dna.resize(dnaCount);
-    for (i32 i = 0; i < dnaCount; ++i)
-    {
-      sngInfo.dna[i].time = f32_le(&plainText[j]);
-      j += 4;
-      sngInfo.dna[i].dnaId = i32_le(&plainText[j]);
-      j += 4;
-    }
+    sngInfo.phraseExtraInfoByLevel[i].phraseId = view.phraseExtraInfoByLevel[i].phraseId;
+    sngInfo.phraseExtraInfoByLevel[i].difficulty = view.phraseExtraInfoByLevel[i].difficulty;
+    sngInfo.phraseExtraInfoByLevel[i].empty = view.phraseExtraInfoByLevel[i].empty;
+    sngInfo.phraseExtraInfoByLevel[i].levelJump = view.phraseExtraInfoByLevel[i].levelJump;
+    sngInfo.phraseExtraInfoByLevel[i].redundant = view.phraseExtraInfoByLevel[i].redundant;
+    sngInfo.phraseExtraInfoByLevel[i].padding = view.phraseExtraInfoByLevel[i].padding;
   }
 
+  sngInfo.nLinkedDifficulty.resize(view.nLinkedDifficulty.size());
+  for (i32 i = 0; i < i32(view.nLinkedDifficulty.size()); ++i)
   {
-    const i32 sectionCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.section.resize(sectionCount);
-    for (i32 i = 0; i < sectionCount; ++i)
-    {
-      memcpy(&sngInfo.section[i].name, &plainText[j], 32);
-      j += 32;
-      sngInfo.section[i].number = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.section[i].startTime = f32_le(&plainText[j]);
-      j += 4;
-      sngInfo.section[i].endTime = f32_le(&plainText[j]);
-      j += 4;
-      sngInfo.section[i].startPhraseIterationId = i32_le(&plainText[j]);
-      j += 4;
-      sngInfo.section[i].endPhraseIterationId = i32_le(&plainText[j]);
-      j += 4;
-      memcpy(&sngInfo.section[i].stringMask, &plainText[j], 36);
-      j += 36;
-    }
+    sngInfo.nLinkedDifficulty[i].levelBreak = view.nLinkedDifficulty[i].levelBreak;
+    sngInfo.nLinkedDifficulty[i].phraseCount = i32(view.nLinkedDifficulty[i].nLDPhrase.size());
+    sngInfo.nLinkedDifficulty[i].nLDPhrase = toVector(view.nLinkedDifficulty[i].nLDPhrase);
   }
 
+  sngInfo.action = toVector(view.action);
+  sngInfo.event = toVector(view.event);
+  sngInfo.tone = toVector(view.tone);
+  sngInfo.dna = toVector(view.dna);
+  sngInfo.section = toVector(view.section);
+
+  sngInfo.arrangement.resize(view.arrangement.size());
+  for (i32 i = 0; i < i32(view.arrangement.size()); ++i)
   {
-    const i32 arrangementCount = u32_le(&plainText[j]);
-    j += 4;
-    sngInfo.arrangement.resize(arrangementCount);
-    for (i32 i = 0; i < arrangementCount; ++i)
+    const View::Arrangement& arrangementView = view.arrangement[i];
+    Info::Arrangement& arrangement = sngInfo.arrangement[i];
+
+    arrangement.difficulty = arrangementView.difficulty;
+    arrangement.anchors = toVector(arrangementView.anchors);
+
+    arrangement.anchorExtensions.resize(arrangementView.anchorExtensions.size());
+    for (i32 ii = 0; ii < i32(arrangementView.anchorExtensions.size()); ++ii)
     {
-      sngInfo.arrangement[i].difficulty = i32_le(&plainText[j]);
-      j += 4;
-      const i32 anchorCount = u32_le(&plainText[j]);
-      j += 4;
-      {
-        sngInfo.arrangement[i].anchors.resize(anchorCount);
-        for (i32 ii = 0; ii < anchorCount; ++ii)
-        {
-          sngInfo.arrangement[i].anchors[ii].startBeatTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].anchors[ii].endBeatTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].anchors[ii].unk3_FirstNoteTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].anchors[ii].unk4_LastNoteTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].anchors[ii].fretId = plainText[j];
-          j += 1;
-          memcpy(&sngInfo.arrangement[i].anchors[ii].padding, &plainText[j], 3);
-          j += 3;
-          sngInfo.arrangement[i].anchors[ii].width = i32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].anchors[ii].phraseIterationId = i32_le(&plainText[j]);
-          j += 4;
-        }
-      }
-      const i32 anchorExtensionCount = u32_le(&plainText[j]);
-      j += 4;
-      {
-        sngInfo.arrangement[i].anchorExtensions.resize(anchorExtensionCount);
-        for (i32 ii = 0; ii < anchorExtensionCount; ++ii)
-        {
-          sngInfo.arrangement[i].anchorExtensions[ii].beatTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].anchorExtensions[ii].fretId = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].anchorExtensions[ii].unk2_0 = i32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].anchorExtensions[ii].unk3_0 = i16_le(&plainText[j]);
-          j += 2;
-          sngInfo.arrangement[i].anchorExtensions[ii].unk4_0 = plainText[j];
-          j += 1;
-        }
-      }
-      const i32 fingerprints1Count = u32_le(&plainText[j]);
-      j += 4;
-      {
-        sngInfo.arrangement[i].fingerprints1.resize(fingerprints1Count);
-        for (i32 ii = 0; ii < fingerprints1Count; ++ii)
-        {
-          sngInfo.arrangement[i].fingerprints1[ii].chordId = i32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].fingerprints1[ii].startTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].fingerprints1[ii].endTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].fingerprints1[ii].unk3_FirstNoteTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].fingerprints1[ii].unk4_LastNoteTime = f32_le(&plainText[j]);
-          j += 4;
-        }
-      }
-      const i32 fingerprints2Count = u32_le(&plainText[j]);
-      j += 4;
-      {
-        sngInfo.arrangement[i].fingerprints2.resize(fingerprints2Count);
-        for (i32 ii = 0; ii < fingerprints2Count; ++ii)
-        {
-          sngInfo.arrangement[i].fingerprints2[ii].chordId = i32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].fingerprints2[ii].startTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].fingerprints2[ii].endTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].fingerprints2[ii].unk3_FirstNoteTime = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].fingerprints2[ii].unk4_LastNoteTime = f32_le(&plainText[j]);
-          j += 4;
-        }
-      }
-      const i32 noteCount = u32_le(&plainText[j]);
-      j += 4;
-      {
-        sngInfo.arrangement[i].notes.resize(noteCount);
-        for (i32 ii = 0; ii < noteCount; ++ii)
-        {
-          sngInfo.arrangement[i].notes[ii].noteMask = u32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].noteFlags = u32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].hash = u32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].time = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].stringIndex = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].fretId = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].anchorFretId = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].anchorWidth = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].chordId = i32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].chordNotesId = i32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].phraseId = i32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].phraseIterationId = i32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].fingerPrintId[0] = i16_le(&plainText[j]);
-          j += 2;
-          sngInfo.arrangement[i].notes[ii].fingerPrintId[1] = i16_le(&plainText[j]);
-          j += 2;
-          sngInfo.arrangement[i].notes[ii].nextIterNote = i16_le(&plainText[j]);
-          j += 2;
-          sngInfo.arrangement[i].notes[ii].prevIterNote = i16_le(&plainText[j]);
-          j += 2;
-          sngInfo.arrangement[i].notes[ii].parentPrevNote = i16_le(&plainText[j]);
-          j += 2;
-          sngInfo.arrangement[i].notes[ii].slideTo = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].slideUnpitchTo = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].leftHand = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].tap = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].pickDirection = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].slap = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].pluck = plainText[j];
-          j += 1;
-          sngInfo.arrangement[i].notes[ii].vibrato = i16_le(&plainText[j]);
-          j += 2;
-          sngInfo.arrangement[i].notes[ii].sustain = f32_le(&plainText[j]);
-          j += 4;
-          sngInfo.arrangement[i].notes[ii].maxBend = f32_le(&plainText[j]);
-          j += 4;
-          const i32 bendDataCount = u32_le(&plainText[j]);
-          j += 4;
-          {
-            sngInfo.arrangement[i].notes[ii].bendData.resize(bendDataCount);
-            for (i32 iii = 0; iii < bendDataCount; ++iii)
-            {
-              memcpy(&sngInfo.arrangement[i].notes[iii].bendData, &plainText[j], 2328);
-              j += 2328;
-            }
-          }
-        }
-      }
-      sngInfo.arrangement[i].phraseCount = i32_le(&plainText[j]);
-      j += 4;
-      {
-        sngInfo.arrangement[i].averageNotesPerIteration.resize(sngInfo.arrangement[i].phraseCount);
-        for (i32 ii = 0; ii < sngInfo.arrangement[i].phraseCount; ++ii)
-        {
-          sngInfo.arrangement[i].averageNotesPerIteration[ii] = f32_le(&plainText[j]);
-          j += 4;
-        }
-      }
-      sngInfo.arrangement[i].phraseIterationCount1 = i32_le(&plainText[j]);
-      j += 4;
-      {
-        sngInfo.arrangement[i].notesInIteration1.resize(sngInfo.arrangement[i].phraseIterationCount1);
-        for (i32 ii = 0; ii < sngInfo.arrangement[i].phraseIterationCount1; ++ii)
-        {
-          sngInfo.arrangement[i].notesInIteration1[ii] = i32_le(&plainText[j]);
-          j += 4;
-        }
-      }
-      sngInfo.arrangement[i].phraseIterationCount2 = i32_le(&plainText[j]);
-      j += 4;
-      {
-        sngInfo.arrangement[i].notesInIteration2.resize(sngInfo.arrangement[i].phraseIterationCount2);
-        for (i32 ii = 0; ii < sngInfo.arrangement[i].phraseIterationCount2; ++ii)
-        {
-          sngInfo.arrangement[i].notesInIteration2[ii] = i32_le(&plainText[j]);
-          j += 4;
-        }
-      }
+      arrangement.anchorExtensions[ii].beatTime = arrangementView.anchorExtensions[ii].beatTime;
+      arrangement.anchorExtensions[ii].fretId = arrangementView.anchorExtensions[ii].fretId;
+      arrangement.anchorExtensions[ii].unk2_0 = arrangementView.anchorExtensions[ii].unk2_0;
+      arrangement.anchorExtensions[ii].unk3_0 = arrangementView.anchorExtensions[ii].unk3_0;
+      arrangement.anchorExtensions[ii].unk4_0 = arrangementView.anchorExtensions[ii].unk4_0;
     }
-  }
 
-  {
-    sngInfo.metadata.maxScore = f64_le(&plainText[j]);
-    j += 8;
-    sngInfo.metadata.maxNotesAndChords = f64_le(&plainText[j]);
-    j += 8;
-    sngInfo.metadata.maxNotesAndChordsReal = f64_le(&plainText[j]);
-    j += 8;
-    sngInfo.metadata.pointsPerNote = f64_le(&plainText[j]);
-    j += 8;
-    sngInfo.metadata.firstBeatLength = f32_le(&plainText[j]);
-    j += 4;
-    sngInfo.metadata.startTime = f32_le(&plainText[j]);
-    j += 4;
-    sngInfo.metadata.capoFretId = plainText[j];
-    j += 1;
-    memcpy(&sngInfo.metadata.lastConversionDateTime, &plainText[j], 32);
-    j += 32;
-    sngInfo.metadata.part = i16_le(&plainText[j]);
-    j += 2;
-    sngInfo.metadata.songLength = f32_le(&plainText[j]);
-    j += 4;
-    sngInfo.metadata.stringCount = i32_le(&plainText[j]);
-    j += 4;
+    arrangement.fingerprints1 = toVector(arrangementView.fingerprints1);
+    arrangement.fingerprints2 = toVector(arrangementView.fingerprints2);
+
+    arrangement.notes.resize(arrangementView.notes.size());
+    for (i32 ii = 0; ii < i32(arrangementView.notes.size()); ++ii)
     {
-      sngInfo.metadata.tuning.resize(sngInfo.metadata.stringCount);
-      for (i32 ii = 0; ii < sngInfo.metadata.stringCount; ++ii)
-      {
-        sngInfo.metadata.tuning[ii] = i16_le(&plainText[j]);
-        j += 2;
-      }
+      const View::Note& noteView = arrangementView.notes[ii].note;
+      Info::Arrangement::Note& note = arrangement.notes[ii];
+
+      note.noteMask = noteView.noteMask;
+      note.noteFlags = noteView.noteFlags;
+      note.hash = noteView.hash;
+      note.time = noteView.time;
+      note.stringIndex = noteView.stringIndex;
+      note.fretId = noteView.fretId;
+      note.anchorFretId = noteView.anchorFretId;
+      note.anchorWidth = noteView.anchorWidth;
+      note.chordId = noteView.chordId;
+      note.chordNotesId = noteView.chordNotesId;
+      note.phraseId = noteView.phraseId;
+      note.phraseIterationId = noteView.phraseIterationId;
+      note.fingerPrintId[0] = noteView.fingerPrintId[0];
+      note.fingerPrintId[1] = noteView.fingerPrintId[1];
+      note.nextIterNote = noteView.nextIterNote;
+      note.prevIterNote = noteView.prevIterNote;
+      note.parentPrevNote = noteView.parentPrevNote;
+      note.slideTo = noteView.slideTo;
+      note.slideUnpitchTo = noteView.slideUnpitchTo;
+      note.leftHand = noteView.leftHand;
+      note.tap = noteView.tap;
+      note.pickDirection = noteView.pickDirection;
+      note.slap = noteView.slap;
+      note.pluck = noteView.pluck;
+      note.vibrato = noteView.vibrato;
+      note.sustain = noteView.sustain;
+      note.maxBend = noteView.maxBend;
+      note.bendData = toVector(arrangementView.notes[ii].bendData);
     }
-    sngInfo.metadata.unk11FirstNoteTime = f32_le(&plainText[j]);
-    j += 4;
-    sngInfo.metadata.unk12FirstNoteTime = f32_le(&plainText[j]);
-    j += 4;
-    sngInfo.metadata.maxDifficulty = i32_le(&plainText[j]);
-    j += 4;
+
+    arrangement.phraseCount = i32(arrangementView.averageNotesPerIteration.size());
+    arrangement.averageNotesPerIteration = toVector(arrangementView.averageNotesPerIteration);
+    arrangement.phraseIterationCount1 = i32(arrangementView.notesInIteration1.size());
+    arrangement.notesInIteration1 = toVector(arrangementView.notesInIteration1);
+    arrangement.phraseIterationCount2 = i32(arrangementView.notesInIteration2.size());
+    arrangement.notesInIteration2 = toVector(arrangementView.notesInIteration2);
   }
 
+  sngInfo.metadata.maxScore = view.metadata.maxScore;
+  sngInfo.metadata.maxNotesAndChords = view.metadata.maxNotesAndChords;
+  sngInfo.metadata.maxNotesAndChordsReal = view.metadata.maxNotesAndChordsReal;
+  sngInfo.metadata.pointsPerNote = view.metadata.pointsPerNote;
+  sngInfo.metadata.firstBeatLength = view.metadata.firstBeatLength;
+  sngInfo.metadata.startTime = view.metadata.startTime;
+  sngInfo.metadata.capoFretId = view.metadata.capoFretId;
+  memcpy(&sngInfo.metadata.lastConversionDateTime, &view.metadata.lastConversionDateTime, 32);
+  sngInfo.metadata.part = view.metadata.part;
+  sngInfo.metadata.songLength = view.metadata.songLength;
+  sngInfo.metadata.stringCount = view.metadata.stringCount;
+  sngInfo.metadata.tuning = toVector(view.tuning);
+  sngInfo.metadata.unk11FirstNoteTime = view.metadataTail.unk11FirstNoteTime;
+  sngInfo.metadata.unk12FirstNoteTime = view.metadataTail.unk12FirstNoteTime;
+  sngInfo.metadata.maxDifficulty = view.metadataTail.maxDifficulty;
+
   return sngInfo;
 }
@@ -3,9 +3,48 @@
 
 #include "type.h"
 
+#include <span>
+#include <string.h>
+#include <type_traits>
 #include <vector>
 
 namespace Sng {
+  enum struct NoteMask : u32 // technique flags of Note::noteMask and ChordNotes::noteMask
+  {
+    none,
+    missing = 1 << 0,
+    chord = 1 << 1,
+    open = 1 << 2,
+    fretHandMute = 1 << 3,
+    tremolo = 1 << 4,
+    harmonic = 1 << 5,
+    palmMute = 1 << 6,
+    slap = 1 << 7,
+    pluck = 1 << 8,
+    hammerOn = 1 << 9,
+    pullOff = 1 << 10,
+    slide = 1 << 11,
+    bend = 1 << 12,
+    sustain = 1 << 13,
+    tap = 1 << 14,
+    pinchHarmonic = 1 << 15,
+    vibrato = 1 << 16,
+    mute = 1 << 17,
+    ignore = 1 << 18,
+    leftHand = 1 << 19,
+    rightHand = 1 << 20,
+    highDensity = 1 << 21,
+    slideUnpitchTo = 1 << 22,
+    single = 1 << 23,
+    chordNotes = 1 << 24,
+    doubleStop = 1 << 25,
+    accent = 1 << 26,
+    parent = 1 << 27,
+    child = 1 << 28,
+    arpeggio = 1 << 29,
+    strum = 1u << 31,
+  }BIT_FLAGS(NoteMask);
+
   struct Info {
     InstrumentFlags instrumentFlags = InstrumentFlags::none;
 
@@ -241,7 +280,7 @@ namespace Sng {
         i16 vibrato;
         f32 sustain;
         f32 maxBend;
-        std::vector<BendData> bendData;
+        std::vector<BendData::BendData32> bendData;
       };
 
       i32 difficulty;
@@ -280,7 +319,192 @@ namespace Sng {
     Metadata metadata;
   };
 
-  Sng::Info parse(const std::vector<u8>& sngData);
+  // Reads the decoded plaintext in place, the plaintext must outlive the view.
+  // Record arrays point straight into the plaintext. Behind the notes nothing is aligned, so records are copied out with memcpy when they are read.
+  // A truncated or damaged plaintext gives an empty view that is not valid.
+  struct View
+  {
+    template<typename T>
+    struct Records
+    {
+      static_assert(std::is_trivially_copyable_v<T>);
+
+      struct Iterator
+      {
+        const u8* p;
+
+        T operator*() const
+        {
+          T record;
+          memcpy(&record, p, sizeof(T));
+          return record;
+        }
+        Iterator& operator++()
+        {
+          p += sizeof(T);
+          return *this;
+        }
+        bool operator!=(const Iterator& other) const
+        {
+          return p != other.p;
+        }
+      };
+
+      const u8* bytes = nullptr;
+      u64 count = 0;
+
+      u64 size() const
+      {
+        return count;
+      }
+      bool empty() const
+      {
+        return count == 0;
+      }
+      T operator[](u64 i) const
+      {
+        return *Iterator{ bytes + i * sizeof(T) };
+      }
+      Iterator begin() const
+      {
+        return { bytes };
+      }
+      Iterator end() const
+      {
+        return { bytes + count * sizeof(T) };
+      }
+    };
+
+#pragma pack(push, 1)
+    struct PhraseExtraInfoByLevel
+    {
+      i32 phraseId;
+      i32 difficulty;
+      i32 empty;
+      u8 levelJump;
+      i16 redundant;
+      u8 padding;
+    };
+
+    struct AnchorExtension
+    {
+      f32 beatTime;
+      u8 fretId;
+      i32 unk2_0;
+      i16 unk3_0;
+      u8 unk4_0;
+    };
+
+    struct Note
+    {
+      u32 noteMask;
+      u32 noteFlags;
+      u32 hash;
+      f32 time;
+      u8 stringIndex;
+      u8 fretId;
+      u8 anchorFretId;
+      u8 anchorWidth;
+      i32 chordId;
+      i32 chordNotesId;
+      i32 phraseId;
+      i32 phraseIterationId;
+      i16 fingerPrintId[2];
+      i16 nextIterNote;
+      i16 prevIterNote;
+      i16 parentPrevNote;
+      u8 slideTo;
+      u8 slideUnpitchTo;
+      u8 leftHand;
+      u8 tap;
+      u8 pickDirection;
+      u8 slap;
+      u8 pluck;
+      i16 vibrato;
+      f32 sustain;
+      f32 maxBend;
+      i32 bendDataCount;
+    };
+
+    struct Metadata
+    {
+      f64 maxScore;
+      f64 maxNotesAndChords;
+      f64 maxNotesAndChordsReal;
+      f64 pointsPerNote;
+      f32 firstBeatLength;
+      f32 startTime;
+      u8 capoFretId;
+      char lastConversionDateTime[32];
+      i16 part;
+      f32 songLength;
+      i32 stringCount;
+    };
+
+    struct MetadataTail // behind the tuning
+    {
+      f32 unk11FirstNoteTime;
+      f32 unk12FirstNoteTime;
+      i32 maxDifficulty;
+    };
+#pragma pack(pop)
+
+    bool valid = false;
+
+    Records<Info::Bpm> bpm;
+    Records<Info::Phrase> phrase;
+    Records<Info::Chord> chord;
+    Records<Info::ChordNotes> chordNotes;
+    Records<Info::Vocal> vocal;
+    Records<Info::SymbolsHeader> symbolsHeader;
+    Records<Info::SymbolsTexture> symbolsTexture;
+    Records<Info::SymbolDefinition> symbolDefinition;
+    Records<Info::PhraseIteration> phraseIteration;
+    Records<PhraseExtraInfoByLevel> phraseExtraInfoByLevel;
+
+    struct NLinkedDifficulty
+    {
+      i32 levelBreak;
+      Records<i32> nLDPhrase;
+    };
+    std::vector<NLinkedDifficulty> nLinkedDifficulty;
+
+    Records<Info::Action> action;
+    Records<Info::Event> event;
+    Records<Info::Tone> tone;
+    Records<Info::Dna> dna;
+    Records<Info::Section> section;
+
+    struct NoteRecord // notes have a variable size because of their bend data
+    {
+      Note note;
+      Records<Info::BendData::BendData32> bendData; // follows the note
+    };
+
+    struct Arrangement
+    {
+      i32 difficulty;
+      Records<Info::Arrangement::Anchor> anchors;
+      Records<AnchorExtension> anchorExtensions;
+      Records<Info::Arrangement::Fingerprint> fingerprints1;
+      Records<Info::Arrangement::Fingerprint> fingerprints2;
+      std::vector<NoteRecord> notes;
+      Records<f32> averageNotesPerIteration;
+      Records<i32> notesInIteration1;
+      Records<i32> notesInIteration2;
+    };
+    std::vector<Arrangement> arrangement;
+
+    Metadata metadata;
+    Records<i16> tuning;
+    MetadataTail metadataTail;
+    u64 size = 0; // bytes of the plaintext that were read
+  };
+
+  std::vector<u8> decode(std::span<const u8> sngData); // decrypts and inflates
+  View view(std::span<const u8> plainText);
+  Sng::Info parse(std::span<const u8> sngData);
+  Sng::Info parsePlainText(std::span<const u8> plainText);
 }
 
 #endif // SNG_H
@@ -1,532 +1,1535 @@
 #include "song.h"
 
 #include "psarc.h"
+#include "serialize.h"
 #include "sng.h"
 #include "global.h"
 #include "xml.h"
 
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <string_view>
+
 Song::Info Song::loadSongInfoManifestOnly(const Psarc::Info& psarcInfo) {
 
   Song::Info songInfo;
 
-  for (const Psarc::Info::TOCEntry& tocEntry : psarcInfo.tocEntries) {
-    if (tocEntry.name.ends_with(".xblock"))
-    {
-      songInfo.xblock = XBlock::readXBlock(tocEntry.content);
-      break;
-    }
-  }
+  if (psarcInfo.lookup.xblock != -1)
+    songInfo.xblock = XBlock::readXBlock(Psarc::content(psarcInfo, psarcInfo.tocEntries[psarcInfo.lookup.xblock]));
 
-  for (i32 i = 0; i < psarcInfo.tocEntries.size(); ++i) {
-    const Psarc::Info::TOCEntry& tocEntry = psarcInfo.tocEntries[i];
-    if (tocEntry.name.ends_with(".hsan"))
-    {
-      songInfo.manifestInfos = Manifest::readHsan(tocEntry.content, songInfo.xblock);
-      songInfo.loadState = LoadState::manifest;
-    }
-    else if (tocEntry.name.ends_with("_64.dds")) {
-      songInfo.albumCover64_tocIndex = i;
-    }
-    else if (tocEntry.name.ends_with("_128.dds")) {
-      songInfo.albumCover128_tocIndex = i;
-    }
-    else if (tocEntry.name.ends_with("_256.dds")) {
-      songInfo.albumCover256_tocIndex = i;
-    }
+  if (psarcInfo.lookup.hsan != -1)
+  {
+    songInfo.manifestInfos = Manifest::readHsan(Psarc::content(psarcInfo, psarcInfo.tocEntries[psarcInfo.lookup.hsan]), songInfo.xblock);
+    songInfo.loadState = LoadState::manifest;
   }
 
+  songInfo.albumCover64_tocIndex = psarcInfo.lookup.albumArt64;
+  songInfo.albumCover128_tocIndex = psarcInfo.lookup.albumArt128;
+  songInfo.albumCover256_tocIndex = psarcInfo.lookup.albumArt256;
+
   return songInfo;
 }
 
-void Song::loadSongInfoComplete(const Psarc::Info& psarcInfo, Song::Info& songInfo)
+void Song::loadSongInfoComplete(const Psarc::Info& psarcInfo, Song::Info& songInfo, const std::atomic<bool>* cancel)
 {
   if (songInfo.loadState == LoadState::complete)
     return;
 
   assert(songInfo.loadState == LoadState::manifest);
 
-  for (i32 i = 0; i < psarcInfo.tocEntries.size(); ++i) {
-    const Psarc::Info::TOCEntry& tocEntry = psarcInfo.tocEntries[i];
-
-    if (tocEntry.name.ends_with(".bin")
-      || tocEntry.name.ends_with(".flat")
-      || tocEntry.name.ends_with(".xblock")
-      || tocEntry.name.ends_with(".hsan")
-      || tocEntry.name.ends_with(".dds")
-      || tocEntry.name.ends_with(".bnk")
-      || tocEntry.name.ends_with(".wem")
-      || tocEntry.name.ends_with(".nt")
-      || tocEntry.name.ends_with(".version")
-      || tocEntry.name.ends_with(".appid")
-      || tocEntry.name.ends_with(".sng")
-      || tocEntry.name.ends_with(".xml")
-      || tocEntry.name.ends_with("_vocals.json"))
-    {
-      continue;
-    }
-    else if (tocEntry.name.ends_with("_lead.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else if (tocEntry.name.ends_with("_lead2.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else if (tocEntry.name.ends_with("_lead3.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else if (tocEntry.name.ends_with("_rhythm.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else if (tocEntry.name.ends_with("_rhythm2.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else if (tocEntry.name.ends_with("_rhythm3.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else if (tocEntry.name.ends_with("_bass.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else if (tocEntry.name.ends_with("_bass2.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else if (tocEntry.name.ends_with("_bass3.json"))
-    {
-      const std::vector<Manifest::Tone> tones = Manifest::readJson(tocEntry.content);
-      songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
-    }
-    else
-    {
-      assert(false);
-    }
+  static const char* arrangementJsons[] = {
+    "_lead.json",
+    "_lead2.json",
+    "_lead3.json",
+    "_rhythm.json",
+    "_rhythm2.json",
+    "_rhythm3.json",
+    "_bass.json",
+    "_bass2.json",
+    "_bass3.json"
+  };
+
+  std::vector<i32> tocIndices;
+  for (const char* arrangementJson : arrangementJsons)
+  {
+    const i32 tocIndex = Psarc::findTocIndex(psarcInfo, arrangementJson);
+    if (tocIndex != -1)
+      tocIndices.push_back(tocIndex);
+  }
+  std::sort(tocIndices.begin(), tocIndices.end()); // keep the tone order of the archive
+
+  for (const i32 tocIndex : tocIndices)
+  {
+    if (cancel != nullptr && *cancel)
+      return;
+    const std::vector<Manifest::Tone> tones = Manifest::readJson(Psarc::content(psarcInfo, psarcInfo.tocEntries[tocIndex]));
+    songInfo.tones.insert(songInfo.tones.begin(), tones.begin(), tones.end());
   }
 
   songInfo.loadState = LoadState::complete;
 }
 
-static void readPhrases(const pugi::xml_document& doc, std::vector<Song::Phrase>& phrases)
-{
-  pugi::xml_node phrases_ = doc.child("song").child("phrases");
-
-  //phrases.resize(phrases_.attribute("count").as_int());
+namespace {
+  // Streaming reader over the xml of an arrangement. Walks the content once and never builds a document.
+  struct XmlReader
+  {
+    const char* p;
+    const char* end;
+  };
 
-  for (pugi::xml_node phrase : phrases_.children("phrase")) {
-    Song::Phrase phrase_;
+  struct XmlTag
+  {
+    u32 name; // xmlHash of the element name
+    bool closing; // </name>
+    bool selfClosing; // <name/>. Known once all attributes were read
+  };
+}
 
-    phrase_.maxDifficulty = phrase.attribute("maxDifficulty").as_int();
-    phrase_.name = phrase.attribute("name").as_string();
+static constexpr u32 xmlHash(std::string_view name)
+{
+  u32 hash = 2166136261u; // FNV-1a. No collisions among the element and attribute names of arrangements
+  for (const char c : name)
+    hash = (hash ^ u8(c)) * 16777619u;
+  return hash;
+}
 
-    phrases.push_back(phrase_);
-  }
+static bool xmlIsSpace(char c)
+{
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
 }
 
-static void readPhraseIterations(const pugi::xml_document& doc, std::vector<Song::PhraseIteration>& phraseIterations)
+static void xmlSkipPast(XmlReader& reader, std::string_view terminator)
 {
-  pugi::xml_node phraseIterations_ = doc.child("song").child("phraseIterations");
+  const std::string_view rest(reader.p, reader.end - reader.p);
+  const size_t pos = rest.find(terminator);
+  reader.p = pos == std::string_view::npos ? reader.end : reader.p + pos + terminator.size();
+}
 
-  //phrases.resize(phrases_.attribute("count").as_int());
+// Moves behind the name of the next element. Text, comments, declarations and processing instructions are skipped.
+static bool xmlNextTag(XmlReader& reader, XmlTag& tag)
+{
+  for (;;)
+  {
+    const char* open = static_cast<const char*>(memchr(reader.p, '<', reader.end - reader.p));
+    if (open == nullptr || open + 1 == reader.end)
+      return false;
+    reader.p = open + 1;
 
-  for (pugi::xml_node phraseIteration : phraseIterations_.children("phraseIteration")) {
-    Song::PhraseIteration phraseIteration_;
+    if (*reader.p == '!')
+    {
+      xmlSkipPast(reader, reader.end - reader.p >= 3 && reader.p[1] == '-' && reader.p[2] == '-' ? "-->" : ">");
+      continue;
+    }
+    if (*reader.p == '?')
+    {
+      xmlSkipPast(reader, "?>");
+      continue;
+    }
 
-    phraseIteration_.time = phraseIteration.attribute("time").as_float();
-    phraseIteration_.phraseId = phraseIteration.attribute("phraseId").as_int();
-    phraseIteration_.variation = phraseIteration.attribute("variation").as_string();
+    tag.closing = *reader.p == '/';
+    if (tag.closing)
+      ++reader.p;
 
-    for (pugi::xml_node heroLevel : phraseIteration.child("heroLevels").children("heroLevel")) {
+    const char* name = reader.p;
+    while (reader.p < reader.end && !xmlIsSpace(*reader.p) && *reader.p != '>' && *reader.p != '/')
+      ++reader.p;
+    tag.name = xmlHash(std::string_view(name, reader.p - name));
+    tag.selfClosing = false;
 
-      Song::HeroLevel heroLevel_;
+    if (tag.closing)
+      xmlSkipPast(reader, ">");
 
-      heroLevel_.difficulty = heroLevel.attribute("difficulty").as_int();
-      heroLevel_.hero = heroLevel.attribute("hero").as_int();
+    return true;
+  }
+}
 
-      phraseIteration_.heroLevels.push_back(heroLevel_);
-    }
+// Reads the next attribute of the current tag. Returns false behind the end of the tag.
+static bool xmlNextAttribute(XmlReader& reader, XmlTag& tag, u32& name, std::string_view& value)
+{
+  while (reader.p < reader.end && xmlIsSpace(*reader.p))
+    ++reader.p;
+  if (reader.p == reader.end)
+    return false;
 
-    phraseIterations.push_back(phraseIteration_);
+  if (*reader.p == '/' || *reader.p == '>')
+  {
+    tag.selfClosing = *reader.p == '/';
+    xmlSkipPast(reader, ">");
+    return false;
   }
+
+  const char* nameBegin = reader.p;
+  while (reader.p < reader.end && *reader.p != '=' && !xmlIsSpace(*reader.p))
+    ++reader.p;
+  name = xmlHash(std::string_view(nameBegin, reader.p - nameBegin));
+
+  while (reader.p < reader.end && *reader.p != '"' && *reader.p != '\'')
+    ++reader.p;
+  if (reader.p == reader.end)
+    return false;
+
+  const char quote = *reader.p++;
+  const char* valueEnd = static_cast<const char*>(memchr(reader.p, quote, reader.end - reader.p));
+  if (valueEnd == nullptr)
+    valueEnd = reader.end;
+  value = std::string_view(reader.p, valueEnd - reader.p);
+  reader.p = valueEnd == reader.end ? reader.end : valueEnd + 1;
+
+  return true;
 }
 
-static void readChordTemplates(const pugi::xml_document& doc, std::vector<Song::ChordTemplate>& chordTemplates)
+// The value is a view into the document without a terminating zero, so numbers are parsed within its bounds.
+// Like strtol and strtof leading whitespace and a plus sign are skipped and a malformed value gives 0.
+static std::string_view xmlNumber(std::string_view value)
 {
-  pugi::xml_node chordTemplates_ = doc.child("song").child("chordTemplates");
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t' || value.front() == '\n' || value.front() == '\r'))
+    value.remove_prefix(1);
+  if (!value.empty() && value.front() == '+')
+    value.remove_prefix(1);
+  return value;
+}
 
-  //chordTemplates.resize(chordTemplates_.attribute("count").as_int());
+static i32 xmlInt(std::string_view value)
+{
+  value = xmlNumber(value);
+  i32 i = 0;
+  std::from_chars(value.data(), value.data() + value.size(), i);
+  return i;
+}
 
-  for (pugi::xml_node chordTemplate : chordTemplates_.children("chordTemplate")) {
-    Song::ChordTemplate chordTemplate_;
+static f32 xmlFloat(std::string_view value)
+{
+  value = xmlNumber(value);
+  f32 f = 0.0f;
+  std::from_chars(value.data(), value.data() + value.size(), f);
+  return f;
+}
 
-    chordTemplate_.chordName = chordTemplate.attribute("chordName").as_string();
-    chordTemplate_.displayName = chordTemplate.attribute("displayName").as_string();
-    chordTemplate_.finger0 = chordTemplate.attribute("finger0").as_int();
-    chordTemplate_.finger1 = chordTemplate.attribute("finger1").as_int();
-    chordTemplate_.finger2 = chordTemplate.attribute("finger2").as_int();
-    chordTemplate_.finger3 = chordTemplate.attribute("finger3").as_int();
-    chordTemplate_.finger4 = chordTemplate.attribute("finger4").as_int();
-    chordTemplate_.finger5 = chordTemplate.attribute("finger5").as_int();
-    chordTemplate_.fret0 = chordTemplate.attribute("fret0").as_int();
-    chordTemplate_.fret1 = chordTemplate.attribute("fret1").as_int();
-    chordTemplate_.fret2 = chordTemplate.attribute("fret2").as_int();
-    chordTemplate_.fret3 = chordTemplate.attribute("fret3").as_int();
-    chordTemplate_.fret4 = chordTemplate.attribute("fret4").as_int();
-    chordTemplate_.fret5 = chordTemplate.attribute("fret5").as_int();
+static bool xmlBool(std::string_view value)
+{
+  return !value.empty() && (value[0] == '1' || value[0] == 't' || value[0] == 'T' || value[0] == 'y' || value[0] == 'Y');
+}
 
-    chordTemplates.push_back(chordTemplate_);
+static void appendUtf8(std::string& string, u32 codePoint)
+{
+  if (codePoint < 0x80)
+  {
+    string += char(codePoint);
+  }
+  else if (codePoint < 0x800)
+  {
+    string += char(0xC0 | (codePoint >> 6));
+    string += char(0x80 | (codePoint & 0x3F));
+  }
+  else if (codePoint < 0x10000)
+  {
+    string += char(0xE0 | (codePoint >> 12));
+    string += char(0x80 | ((codePoint >> 6) & 0x3F));
+    string += char(0x80 | (codePoint & 0x3F));
+  }
+  else
+  {
+    string += char(0xF0 | (codePoint >> 18));
+    string += char(0x80 | ((codePoint >> 12) & 0x3F));
+    string += char(0x80 | ((codePoint >> 6) & 0x3F));
+    string += char(0x80 | (codePoint & 0x3F));
   }
 }
 
-static void readEbeats(const pugi::xml_document& doc, std::vector<Song::Ebeat>& ebeats)
+// &#N; and &#xN; at i. On success i is moved to the ';'
+static bool xmlCharacterReference(std::string_view value, size_t& i, std::string& string)
 {
-  pugi::xml_node ebeats_ = doc.child("song").child("ebeats");
+  if (value.substr(i, 2) != "&#")
+    return false;
+
+  const bool hex = i + 2 < value.size() && (value[i + 2] == 'x' || value[i + 2] == 'X');
+  const size_t digitsBegin = i + (hex ? 3 : 2);
+  const size_t semicolon = value.find(';', digitsBegin);
+  if (semicolon == std::string_view::npos || semicolon == digitsBegin)
+    return false;
+
+  u32 codePoint = 0;
+  const std::from_chars_result result = std::from_chars(value.data() + digitsBegin, value.data() + semicolon, codePoint, hex ? 16 : 10);
+  if (result.ec != std::errc() || result.ptr != value.data() + semicolon)
+    return false;
+  if (codePoint == 0 || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint <= 0xDFFF))
+    return false;
+
+  appendUtf8(string, codePoint);
+  i = semicolon;
+  return true;
+}
 
-  //ebeats.resize(ebeats_.attribute("count").as_int());
+static std::string xmlString(std::string_view value)
+{
+  std::string string;
+  string.reserve(value.size());
+  for (size_t i = 0; i < value.size(); ++i)
+  {
+    if (value[i] == '&')
+    {
+      if (xmlCharacterReference(value, i, string))
+        continue;
+
+      static const struct { std::string_view entity; char c; } entities[] = {
+        { "&amp;", '&' }, { "&lt;", '<' }, { "&gt;", '>' }, { "&quot;", '"' }, { "&apos;", '\'' }
+      };
+      bool decoded = false;
+      for (const auto& entity : entities)
+      {
+        if (value.substr(i, entity.entity.size()) == entity.entity)
+        {
+          string += entity.c;
+          i += entity.entity.size() - 1;
+          decoded = true;
+          break;
+        }
+      }
+      if (decoded)
+        continue;
+    }
+    string += value[i];
+  }
+  return string;
+}
 
-  for (pugi::xml_node ebeat : ebeats_.children("ebeat")) {
-    Song::Ebeat ebeat_;
+static StringPool::String xmlIntern(std::string_view value)
+{
+  if (value.find('&') == std::string_view::npos) // nothing to decode
+    return StringPool::intern(value);
+  return StringPool::intern(xmlString(value));
+}
 
-    ebeat_.time = ebeat.attribute("time").as_float();
-    ebeat_.measure = ebeat.attribute("measure").as_int(-1);
+// count is only a hint. A damaged file can not reserve more items than its remaining content can hold.
+template<typename T>
+static void xmlReserveCount(XmlReader& reader, XmlTag& tag, std::vector<T>& items)
+{
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+    if (name == xmlHash("count"))
+    {
+      const u64 shortestElementLength = sizeof("<a/>") - 1;
+      items.reserve(min_(u64(max_(xmlInt(value), 0)), u64(reader.end - reader.p) / shortestElementLength));
+    }
+}
 
-    ebeats.push_back(ebeat_);
+static void xmlSkipAttributes(XmlReader& reader, XmlTag& tag)
+{
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
   }
 }
 
-static void readSections(const pugi::xml_document& doc, std::vector<Song::Section>& sections) {
-  pugi::xml_node sections_ = doc.child("song").child("sections");
+// time is not stored in the note. Chord notes have the time of their chord.
+static void xmlReadNote(XmlReader& reader, XmlTag& tag, f32& time, f32& sustain, Song::TranscriptionTrack::Note& note)
+{
+  using Technique = Song::TranscriptionTrack::Technique;
 
-  //sections.resize(sections_.attribute("count").as_int());
+  time = 0.0f;
+  sustain = 0.0f;
+  note = Song::TranscriptionTrack::Note{};
 
-  for (pugi::xml_node section : sections_.children("section")) {
-    Song::Section section_;
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    Technique technique = Technique::none;
+    switch (name)
+    {
+    case xmlHash("time"): time = xmlFloat(value); break;
+    case xmlHash("fret"): note.fret = i8(xmlInt(value)); break;
+    case xmlHash("leftHand"): note.leftHand = i8(xmlInt(value)); break;
+    case xmlHash("slideTo"): note.slideTo = i8(xmlInt(value)); break;
+    case xmlHash("string"): note.string = i8(xmlInt(value)); break;
+    case xmlHash("sustain"): sustain = xmlFloat(value); break;
+    case xmlHash("slideUnpitchTo"): note.slideUnpitchTo = i8(xmlInt(value)); break;
+    case xmlHash("vibrato"): note.vibrato = i16(xmlInt(value)); break;
+    case xmlHash("linkNext"): technique = Technique::linkNext; break;
+    case xmlHash("accent"): technique = Technique::accent; break;
+    case xmlHash("bend"): technique = Technique::bend; break;
+    case xmlHash("hammerOn"): technique = Technique::hammerOn; break;
+    case xmlHash("harmonic"): technique = Technique::harmonic; break;
+    case xmlHash("hopo"): technique = Technique::hopo; break;
+    case xmlHash("ignore"): technique = Technique::ignore; break;
+    case xmlHash("mute"): technique = Technique::mute; break;
+    case xmlHash("palmMute"): technique = Technique::palmMute; break;
+    case xmlHash("pluck"): technique = Technique::pluck; break;
+    case xmlHash("pullOff"): technique = Technique::pullOff; break;
+    case xmlHash("slap"): technique = Technique::slap; break;
+    case xmlHash("tremolo"): technique = Technique::tremolo; break;
+    case xmlHash("harmonicPinch"): technique = Technique::harmonicPinch; break;
+    case xmlHash("pickDirection"): technique = Technique::pickDirection; break;
+    case xmlHash("rightHand"): technique = Technique::rightHand; break;
+    case xmlHash("tap"): technique = Technique::tap; break;
+    }
+    if (technique != Technique::none && xmlBool(value))
+      note.technique |= technique;
+  }
+}
 
-    section_.name = section.attribute("name").as_string();
-    section_.number = section.attribute("number").as_int();
-    section_.startTime = section.attribute("startTime").as_float();
+static void xmlReadPhrase(XmlReader& reader, XmlTag& tag, Song::Phrase& phrase)
+{
+  phrase.maxDifficulty = 0;
 
-    sections.push_back(section_);
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("maxDifficulty"): phrase.maxDifficulty = xmlInt(value); break;
+    case xmlHash("name"): phrase.name = xmlIntern(value); break;
+    }
   }
 }
 
-static void readSongNotes(const pugi::xml_document& doc, std::vector<Song::TranscriptionTrack::Note>& notes) {
-  pugi::xml_node notes_ = doc.child("song").child("transcriptionTrack").child("notes");
-
-  //songNotes.notes.resize(notes.attribute("count").as_int());
+static void xmlReadPhraseIteration(XmlReader& reader, XmlTag& tag, Song::PhraseIteration& phraseIteration)
+{
+  phraseIteration.time = 0.0f;
+  phraseIteration.phraseId = 0;
 
-  for (pugi::xml_node note : notes_.children("note")) {
-
-    Song::TranscriptionTrack::Note note_;
-
-    note_.time = note.attribute("time").as_float();
-    note_.linkNext = note.attribute("linkNext").as_bool();
-    note_.accent = note.attribute("accent").as_bool();
-    note_.bend = note.attribute("bend").as_bool();
-    note_.fret = note.attribute("fret").as_int();
-    note_.hammerOn = note.attribute("hammerOn").as_bool();
-    note_.harmonic = note.attribute("harmonic").as_bool();
-    note_.hopo = note.attribute("hopo").as_bool();
-    note_.ignore = note.attribute("ignore").as_bool();
-    note_.leftHand = note.attribute("leftHand").as_bool();
-    note_.mute = note.attribute("mute").as_bool();
-    note_.palmMute = note.attribute("palmMute").as_bool();
-    note_.pluck = note.attribute("pluck").as_bool();
-    note_.pullOff = note.attribute("pullOff").as_bool();
-    note_.slap = note.attribute("slap").as_bool();
-    note_.slideTo = note.attribute("slideTo").as_int();
-    note_.string = note.attribute("string").as_int();
-    note_.sustain = note.attribute("sustain").as_float();
-    note_.tremolo = note.attribute("tremolo").as_bool();
-    note_.harmonicPinch = note.attribute("harmonicPinch").as_bool();
-    note_.pickDirection = note.attribute("pickDirection").as_bool();
-    note_.rightHand = note.attribute("rightHand").as_bool();
-    note_.slideUnpitchTo = note.attribute("slideUnpitchTo").as_int();
-    note_.tap = note.attribute("tap").as_bool();
-    note_.vibrato = note.attribute("vibrato").as_int();
-
-    notes.push_back(note_);
-  }
-}
-
-static void readSongChords(const pugi::xml_document& doc, std::vector<Song::TranscriptionTrack::Chord>& chords) {
-  pugi::xml_node chords_ = doc.child("song").child("transcriptionTrack").child("chords");
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("time"): phraseIteration.time = xmlFloat(value); break;
+    case xmlHash("phraseId"): phraseIteration.phraseId = xmlInt(value); break;
+    case xmlHash("variation"): phraseIteration.variation = xmlIntern(value); break;
+    }
+  }
+}
 
-  //songNotes.notes.resize(notes.attribute("count").as_int());
+static void xmlReadHeroLevel(XmlReader& reader, XmlTag& tag, Song::HeroLevel& heroLevel)
+{
+  heroLevel = Song::HeroLevel{};
 
-  for (pugi::xml_node chord : chords_.children("chord")) {
-    Song::TranscriptionTrack::Chord chord_;
-
-    chord_.time = chord.attribute("time").as_float();
-    chord_.chordId = chord.attribute("chordId").as_int(-1);
-    chord_.strum = chord.attribute("strum").as_bool();
-
-    for (pugi::xml_node chordNote : chord.children("chordNote")) {
-
-      Song::TranscriptionTrack::Note note_;
-
-      note_.time = chordNote.attribute("time").as_float();
-      note_.linkNext = chordNote.attribute("linkNext").as_bool();
-      note_.accent = chordNote.attribute("accent").as_bool();
-      note_.bend = chordNote.attribute("bend").as_bool();
-      note_.fret = chordNote.attribute("fret").as_int();
-      note_.hammerOn = chordNote.attribute("hammerOn").as_bool();
-      note_.harmonic = chordNote.attribute("harmonic").as_bool();
-      note_.hopo = chordNote.attribute("hopo").as_bool();
-      note_.ignore = chordNote.attribute("ignore").as_bool();
-      note_.leftHand = chordNote.attribute("leftHand").as_int();
-      note_.mute = chordNote.attribute("mute").as_bool();
-      note_.palmMute = chordNote.attribute("palmMute").as_bool();
-      note_.pluck = chordNote.attribute("pluck").as_bool();
-      note_.pullOff = chordNote.attribute("pullOff").as_bool();
-      note_.slap = chordNote.attribute("slap").as_bool();
-      note_.slideTo = chordNote.attribute("slideTo").as_bool();
-      note_.string = chordNote.attribute("string").as_int();
-      note_.sustain = chordNote.attribute("sustain").as_float();
-      note_.tremolo = chordNote.attribute("tremolo").as_bool();
-      note_.harmonicPinch = chordNote.attribute("harmonicPinch").as_bool();
-      note_.pickDirection = chordNote.attribute("pickDirection").as_bool();
-      note_.rightHand = chordNote.attribute("rightHand").as_bool();
-      note_.slideUnpitchTo = chordNote.attribute("slideUnpitchTo").as_bool();
-      note_.tap = chordNote.attribute("tap").as_bool();
-      note_.vibrato = chordNote.attribute("vibrato").as_bool();
-
-      chord_.chordNotes.push_back(note_);
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("difficulty"): heroLevel.difficulty = xmlInt(value); break;
+    case xmlHash("hero"): heroLevel.hero = xmlInt(value); break;
     }
-
-    chords.push_back(chord_);
   }
 }
 
-static void readSongAnchors(const pugi::xml_document& doc, std::vector<Song::TranscriptionTrack::Anchor>& anchors) {
-  pugi::xml_node anchors_ = doc.child("song").child("transcriptionTrack").child("anchors");
+static void xmlReadChordTemplate(XmlReader& reader, XmlTag& tag, Song::ChordTemplate& chordTemplate)
+{
+  chordTemplate.finger0 = chordTemplate.finger1 = chordTemplate.finger2 = chordTemplate.finger3 = chordTemplate.finger4 = chordTemplate.finger5 = 0;
+  chordTemplate.fret0 = chordTemplate.fret1 = chordTemplate.fret2 = chordTemplate.fret3 = chordTemplate.fret4 = chordTemplate.fret5 = 0;
 
-  //songNotes.notes.resize(notes.attribute("count").as_int());
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("chordName"): chordTemplate.chordName = xmlIntern(value); break;
+    case xmlHash("displayName"): chordTemplate.displayName = xmlIntern(value); break;
+    case xmlHash("finger0"): chordTemplate.finger0 = xmlInt(value); break;
+    case xmlHash("finger1"): chordTemplate.finger1 = xmlInt(value); break;
+    case xmlHash("finger2"): chordTemplate.finger2 = xmlInt(value); break;
+    case xmlHash("finger3"): chordTemplate.finger3 = xmlInt(value); break;
+    case xmlHash("finger4"): chordTemplate.finger4 = xmlInt(value); break;
+    case xmlHash("finger5"): chordTemplate.finger5 = xmlInt(value); break;
+    case xmlHash("fret0"): chordTemplate.fret0 = xmlInt(value); break;
+    case xmlHash("fret1"): chordTemplate.fret1 = xmlInt(value); break;
+    case xmlHash("fret2"): chordTemplate.fret2 = xmlInt(value); break;
+    case xmlHash("fret3"): chordTemplate.fret3 = xmlInt(value); break;
+    case xmlHash("fret4"): chordTemplate.fret4 = xmlInt(value); break;
+    case xmlHash("fret5"): chordTemplate.fret5 = xmlInt(value); break;
+    }
+  }
+}
 
-  for (pugi::xml_node anchor : anchors_.children("anchor")) {
-    Song::TranscriptionTrack::Anchor anchor_;
+static void xmlReadEbeat(XmlReader& reader, XmlTag& tag, Song::Ebeat& ebeat)
+{
+  ebeat.time = 0.0f;
+  ebeat.measure = -1;
 
-    anchor_.time = anchor.attribute("time").as_float();
-    anchor_.fret = anchor.attribute("fret").as_int();
-    anchor_.width = anchor.attribute("width").as_int();
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("time"): ebeat.time = xmlFloat(value); break;
+    case xmlHash("measure"): ebeat.measure = xmlInt(value); break;
+    }
+  }
+}
+
+static void xmlReadSection(XmlReader& reader, XmlTag& tag, Song::Section& section)
+{
+  section.number = 0;
+  section.startTime = 0.0f;
 
-    anchors.push_back(anchor_);
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("name"): section.name = xmlString(value); break;
+    case xmlHash("number"): section.number = xmlInt(value); break;
+    case xmlHash("startTime"): section.startTime = xmlFloat(value); break;
+    }
   }
 }
 
-static void readSongHandShape(const pugi::xml_document& doc, std::vector<Song::TranscriptionTrack::HandShape>& handShapes) {
-  pugi::xml_node handShapes_ = doc.child("song").child("transcriptionTrack").child("handShapes");
+static void xmlReadChord(XmlReader& reader, XmlTag& tag, Song::TranscriptionTrack::Chord& chord, i32 chordNoteBegin)
+{
+  chord.time = 0.0f;
+  chord.chordId = -1;
+  chord.strum = false;
+  chord.chordNoteBegin = chordNoteBegin;
+  chord.chordNoteCount = 0;
+
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("time"): chord.time = xmlFloat(value); break;
+    case xmlHash("chordId"): chord.chordId = xmlInt(value); break;
+    case xmlHash("strum"): chord.strum = xmlBool(value); break;
+    }
+  }
+}
 
-  //songNotes.notes.resize(notes.attribute("count").as_int());
+static void xmlReadAnchor(XmlReader& reader, XmlTag& tag, Song::TranscriptionTrack::Anchor& anchor)
+{
+  anchor = Song::TranscriptionTrack::Anchor{};
 
-  for (pugi::xml_node handShape : handShapes_.children("handShape")) {
-    Song::TranscriptionTrack::HandShape handShape_;
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("time"): anchor.time = xmlFloat(value); break;
+    case xmlHash("fret"): anchor.fret = xmlInt(value); break;
+    case xmlHash("width"): anchor.width = xmlInt(value); break;
+    }
+  }
+}
 
-    handShape_.chordId = handShape.attribute("chordId").as_int(-1);
-    handShape_.endTime = handShape.attribute("endTime").as_float();
-    handShape_.startTime = handShape.attribute("startTime").as_float();
+static void xmlReadHandShape(XmlReader& reader, XmlTag& tag, Song::TranscriptionTrack::HandShape& handShape)
+{
+  handShape.chordId = -1;
+  handShape.endTime = 0.0f;
+  handShape.startTime = 0.0f;
 
-    handShapes.push_back(handShape_);
+  u32 name;
+  std::string_view value;
+  while (xmlNextAttribute(reader, tag, name, value))
+  {
+    switch (name)
+    {
+    case xmlHash("chordId"): handShape.chordId = xmlInt(value); break;
+    case xmlHash("endTime"): handShape.endTime = xmlFloat(value); break;
+    case xmlHash("startTime"): handShape.startTime = xmlFloat(value); break;
+    }
   }
 }
 
-static Song::Track load_xml(const Psarc::Info::TOCEntry& tocEntry)
+static Song::Track load_xml(const Psarc::Info& psarcInfo, const Psarc::Info::TOCEntry& tocEntry)
 {
   Song::Track songTrack;
 
-  pugi::xml_document doc;
-  pugi::xml_parse_result result = doc.load_string(reinterpret_cast<const char*>(tocEntry.content.data()));
-  assert(result.status == pugi::status_ok);
+  const Psarc::Content content = Psarc::content(psarcInfo, tocEntry);
+  XmlReader reader{ reinterpret_cast<const char*>(content.data()), reinterpret_cast<const char*>(content.data()) + content.size() };
+
+  // the open elements, song is the first. Only the path below a child of song matters for the dispatch
+  u32 path[8];
+  i32 depth = 0;
+
+  XmlTag tag;
+  while (xmlNextTag(reader, tag))
+  {
+    if (tag.closing)
+    {
+      depth = max_(depth - 1, 0);
+      continue;
+    }
 
-  readPhrases(doc, songTrack.phrases);
-  readPhraseIterations(doc, songTrack.phraseIterations);
-  readChordTemplates(doc, songTrack.chordTemplates);
-  readEbeats(doc, songTrack.ebeats);
-  readSongNotes(doc, songTrack.transcriptionTrack.notes);
-  readSongChords(doc, songTrack.transcriptionTrack.chords);
-  readSongAnchors(doc, songTrack.transcriptionTrack.anchors);
-  readSongHandShape(doc, songTrack.transcriptionTrack.handShape);
+    const u32 section = depth >= 2 ? path[1] : 0;
+    const u32 parent = depth >= 1 && depth <= i32(NUM(path)) ? path[depth - 1] : 0;
+    Song::TranscriptionTrack& transcriptionTrack = songTrack.transcriptionTrack;
+
+    switch (depth == 1 ? tag.name : section)
+    {
+    case xmlHash("phrases"):
+      if (depth == 1)
+        xmlReserveCount(reader, tag, songTrack.phrases);
+      else if (depth == 2)
+        xmlReadPhrase(reader, tag, songTrack.phrases.emplace_back());
+      else
+        xmlSkipAttributes(reader, tag);
+      break;
+    case xmlHash("phraseIterations"):
+      if (depth == 1)
+        xmlReserveCount(reader, tag, songTrack.phraseIterations);
+      else if (depth == 2)
+        xmlReadPhraseIteration(reader, tag, songTrack.phraseIterations.emplace_back());
+      else if (depth == 3 && tag.name == xmlHash("heroLevels") && !songTrack.phraseIterations.empty())
+        xmlReserveCount(reader, tag, songTrack.phraseIterations.back().heroLevels);
+      else if (depth == 4 && parent == xmlHash("heroLevels") && !songTrack.phraseIterations.empty())
+        xmlReadHeroLevel(reader, tag, songTrack.phraseIterations.back().heroLevels.emplace_back());
+      else
+        xmlSkipAttributes(reader, tag);
+      break;
+    case xmlHash("chordTemplates"):
+      if (depth == 1)
+        xmlReserveCount(reader, tag, songTrack.chordTemplates);
+      else if (depth == 2)
+        xmlReadChordTemplate(reader, tag, songTrack.chordTemplates.emplace_back());
+      else
+        xmlSkipAttributes(reader, tag);
+      break;
+    case xmlHash("ebeats"):
+      if (depth == 1)
+        xmlReserveCount(reader, tag, songTrack.ebeats);
+      else if (depth == 2)
+        xmlReadEbeat(reader, tag, songTrack.ebeats.emplace_back());
+      else
+        xmlSkipAttributes(reader, tag);
+      break;
+    case xmlHash("sections"):
+      if (depth == 1)
+        xmlReserveCount(reader, tag, songTrack.sections);
+      else if (depth == 2)
+        xmlReadSection(reader, tag, songTrack.sections.emplace_back());
+      else
+        xmlSkipAttributes(reader, tag);
+      break;
+    case xmlHash("transcriptionTrack"):
+      if (depth == 2)
+      {
+        switch (tag.name)
+        {
+        case xmlHash("notes"):
+          xmlReserveCount(reader, tag, transcriptionTrack.notes);
+          transcriptionTrack.noteTime.reserve(transcriptionTrack.notes.capacity());
+          transcriptionTrack.noteSustain.reserve(transcriptionTrack.notes.capacity());
+          break;
+        case xmlHash("chords"): xmlReserveCount(reader, tag, transcriptionTrack.chords); break;
+        case xmlHash("anchors"): xmlReserveCount(reader, tag, transcriptionTrack.anchors); break;
+        case xmlHash("handShapes"): xmlReserveCount(reader, tag, transcriptionTrack.handShape); break;
+        default: xmlSkipAttributes(reader, tag); break;
+        }
+      }
+      else if (depth == 3)
+      {
+        switch (parent)
+        {
+        case xmlHash("notes"):
+          xmlReadNote(reader, tag, transcriptionTrack.noteTime.emplace_back(), transcriptionTrack.noteSustain.emplace_back(), transcriptionTrack.notes.emplace_back());
+          break;
+        case xmlHash("chords"): xmlReadChord(reader, tag, transcriptionTrack.chords.emplace_back(), i32(transcriptionTrack.chordNotes.size())); break;
+        case xmlHash("anchors"): xmlReadAnchor(reader, tag, transcriptionTrack.anchors.emplace_back()); break;
+        case xmlHash("handShapes"): xmlReadHandShape(reader, tag, transcriptionTrack.handShape.emplace_back()); break;
+        default: xmlSkipAttributes(reader, tag); break;
+        }
+      }
+      else if (depth == 4 && tag.name == xmlHash("chordNote") && !transcriptionTrack.chords.empty())
+      {
+        f32 time;
+        xmlReadNote(reader, tag, time, transcriptionTrack.chordNoteSustain.emplace_back(), transcriptionTrack.chordNotes.emplace_back());
+        ++transcriptionTrack.chords.back().chordNoteCount;
+      }
+      else
+      {
+        xmlSkipAttributes(reader, tag);
+      }
+      break;
+    default:
+      xmlSkipAttributes(reader, tag);
+      break;
+    }
+
+    if (!tag.selfClosing)
+    {
+      if (depth < i32(NUM(path)))
+        path[depth] = tag.name;
+      ++depth;
+    }
+  }
 
   return songTrack;
 }
 
-static Song::Track load_sng(const Psarc::Info::TOCEntry& tocEntry)
+static bool hasMask(Sng::NoteMask mask, Sng::NoteMask flag)
 {
-  Song::Track songTrack;
+  return to_underlying(mask & flag) != 0;
+}
 
-  const Sng::Info sngInfo = Sng::parse(tocEntry.content);
+static Song::TranscriptionTrack::Technique readNoteMask(Sng::NoteMask mask)
+{
+  using Technique = Song::TranscriptionTrack::Technique;
 
-  for (i32 i = 0; i < sngInfo.phrase.size(); ++i)
+  static const struct
   {
-    Song::Phrase phrase;
-    phrase.name = sngInfo.phrase[i].name;
-    phrase.maxDifficulty = sngInfo.phrase[i].maxDifficulty;
-    songTrack.phrases.push_back(phrase);
+    Sng::NoteMask mask;
+    Technique technique;
+  } techniques[] = {
+    { Sng::NoteMask::parent, Technique::linkNext },
+    { Sng::NoteMask::accent, Technique::accent },
+    { Sng::NoteMask::bend, Technique::bend },
+    { Sng::NoteMask::hammerOn, Technique::hammerOn },
+    { Sng::NoteMask::harmonic, Technique::harmonic },
+    { Sng::NoteMask::hammerOn | Sng::NoteMask::pullOff, Technique::hopo },
+    { Sng::NoteMask::ignore, Technique::ignore },
+    { Sng::NoteMask::fretHandMute, Technique::mute },
+    { Sng::NoteMask::palmMute, Technique::palmMute },
+    { Sng::NoteMask::pluck, Technique::pluck },
+    { Sng::NoteMask::pullOff, Technique::pullOff },
+    { Sng::NoteMask::slap, Technique::slap },
+    { Sng::NoteMask::tremolo, Technique::tremolo },
+    { Sng::NoteMask::pinchHarmonic, Technique::harmonicPinch },
+    { Sng::NoteMask::rightHand, Technique::rightHand },
+    { Sng::NoteMask::tap, Technique::tap },
+  };
+
+  Technique technique = Technique::none;
+  for (const auto& entry : techniques)
+    if (hasMask(mask, entry.mask))
+      technique |= entry.technique;
+  return technique;
+}
+
+static void readSngChord(const Sng::View& sng, const Sng::View::Note& sngNote, Song::Levels::Level& level)
+{
+  Song::TranscriptionTrack::Chord& chord = level.chords.emplace_back();
+  chord.time = sngNote.time;
+  chord.chordId = sngNote.chordId;
+  chord.strum = hasMask(Sng::NoteMask(sngNote.noteMask), Sng::NoteMask::strum);
+  chord.chordNoteBegin = i32(level.chordNotes.size());
+  chord.chordNoteCount = 0;
+
+  if (sngNote.chordId < 0 || sngNote.chordId >= i32(sng.chord.size()))
+    return;
+
+  const Sng::Info::Chord chordTemplate = sng.chord[sngNote.chordId];
+  const bool hasChordNotes = sngNote.chordNotesId >= 0 && sngNote.chordNotesId < i32(sng.chordNotes.size());
+  const Sng::Info::ChordNotes chordNotes = hasChordNotes ? sng.chordNotes[sngNote.chordNotesId] : Sng::Info::ChordNotes{};
+
+  for (i32 i = 0; i < i32(NUM(chordTemplate.frets)); ++i)
+  {
+    if (chordTemplate.frets[i] == 0xFF) // string is not part of the chord
+      continue;
+
+    Song::TranscriptionTrack::Note note{};
+    note.string = i8(i);
+    note.fret = i8(chordTemplate.frets[i]);
+    note.leftHand = i8(chordTemplate.fingers[i]);
+    note.slideTo = -1;
+    note.slideUnpitchTo = -1;
+    if (hasChordNotes)
+    {
+      note.technique = readNoteMask(Sng::NoteMask(chordNotes.noteMask[i]));
+      note.slideTo = i8(chordNotes.slideTo[i]);
+      note.slideUnpitchTo = i8(chordNotes.slideUnpitchTo[i]);
+      note.vibrato = chordNotes.vibrato[i];
+    }
+    level.chordNotes.push_back(note);
+    level.chordNoteSustain.push_back(f32(sngNote.sustain)); // a copy, the packed field is not aligned
+    ++chord.chordNoteCount;
   }
-  for (i32 i = 0; i < sngInfo.phraseIteration.size(); ++i)
+}
+
+// Splits items sorted by time at the start times of the phrase iterations. Items before the first phrase iteration belong to it.
+template<typename T, typename TimeOf>
+static void splitByPhraseIteration(const Sng::View& sng, const std::vector<T>& items, TimeOf timeOf, std::vector<i32>& begin)
+{
+  const i32 phraseIterationCount = max_(i32(sng.phraseIteration.size()), 1);
+
+  begin.resize(phraseIterationCount + 1);
+  i32 item = 0;
+  for (i32 i = 1; i < phraseIterationCount; ++i)
   {
-    Song::PhraseIteration phraseIteration;
-    phraseIteration.time = sngInfo.phraseIteration[i].startTime;
-    phraseIteration.phraseId = sngInfo.phraseIteration[i].phraseId;
-    songTrack.phraseIterations.push_back(phraseIteration);
+    const f32 startTime = sng.phraseIteration[i].startTime;
+    while (item < i32(items.size()) && timeOf(items[item]) < startTime)
+      ++item;
+    begin[i] = item;
   }
-  for (i32 j = sngInfo.arrangement.size() - 1; j >= 0; --j)
+  begin[phraseIterationCount] = i32(items.size());
+}
+
+static Song::Levels readSngLevels(const Sng::View& sng)
+{
+  Song::Levels levels;
+
+  for (const Sng::View::Arrangement& arrangement : sng.arrangement)
   {
-    for (i32 i = 0; i < sngInfo.arrangement[j].notes.size(); ++i)
-    {
-      Song::TranscriptionTrack::Note note{};
-      note.string = sngInfo.arrangement[j].notes[i].stringIndex;
-      note.time = sngInfo.arrangement[j].notes[i].time;
-      note.fret = sngInfo.arrangement[j].notes[i].fretId;
+    Song::Levels::Level& level = levels.level.emplace_back();
+    level.difficulty = arrangement.difficulty;
 
-      bool found = false;
-      for (i32 k = 0; k < songTrack.transcriptionTrack.notes.size(); ++k)
+    for (const Sng::View::NoteRecord& noteRecord : arrangement.notes)
+    {
+      const Sng::View::Note& sngNote = noteRecord.note;
+      if (sngNote.chordId >= 0)
       {
-        if (songTrack.transcriptionTrack.notes[k].time == note.time)
-        {
-          found = true;
-          break;
-        }
+        readSngChord(sng, sngNote, level);
+        continue;
       }
 
-      if (!found)
-        songTrack.transcriptionTrack.notes.push_back(note);
+      Song::TranscriptionTrack::Note note{};
+      note.technique = readNoteMask(Sng::NoteMask(sngNote.noteMask));
+      if (sngNote.pickDirection == 1)
+        note.technique |= Song::TranscriptionTrack::Technique::pickDirection;
+      note.string = i8(sngNote.stringIndex);
+      note.fret = i8(sngNote.fretId);
+      note.slideTo = i8(sngNote.slideTo);
+      note.slideUnpitchTo = i8(sngNote.slideUnpitchTo);
+      note.leftHand = i8(sngNote.leftHand);
+      note.vibrato = sngNote.vibrato;
+      level.noteTime.push_back(f32(sngNote.time)); // copies, the packed fields are not aligned
+      level.noteSustain.push_back(f32(sngNote.sustain));
+      level.notes.push_back(note);
     }
 
-    for (i32 i = 0; i < sngInfo.arrangement[j].anchors.size(); ++i)
+    level.anchorTime.reserve(arrangement.anchors.size());
+    level.anchorFret.reserve(arrangement.anchors.size());
+    level.anchorWidth.reserve(arrangement.anchors.size());
+    for (const Sng::Info::Arrangement::Anchor& sngAnchor : arrangement.anchors)
     {
-      Song::TranscriptionTrack::Anchor anchor{};
-      anchor.fret = sngInfo.arrangement[j].anchors[i].fretId;
-      anchor.time = sngInfo.arrangement[j].anchors[i].startBeatTime;
-      anchor.width = sngInfo.arrangement[j].anchors[i].width;
+      level.anchorTime.push_back(sngAnchor.startBeatTime);
+      level.anchorFret.push_back(sngAnchor.fretId);
+      level.anchorWidth.push_back(u8(sngAnchor.width));
+    }
 
-      bool found = false;
-      for (i32 k = 0; k < songTrack.transcriptionTrack.anchors.size(); ++k)
+    // hand shapes and arpeggios are stored apart. Both are sorted by start time
+    level.handShapes.reserve(arrangement.fingerprints1.size() + arrangement.fingerprints2.size());
+    for (const Sng::View::Records<Sng::Info::Arrangement::Fingerprint>& fingerprints : { arrangement.fingerprints1, arrangement.fingerprints2 })
+    {
+      const i32 mergeBegin = i32(level.handShapes.size());
+      for (const Sng::Info::Arrangement::Fingerprint& fingerprint : fingerprints)
       {
-        if (songTrack.transcriptionTrack.anchors[k].time == anchor.time)
-        {
-          found = true;
-          break;
-        }
+        Song::TranscriptionTrack::HandShape handShape;
+        handShape.chordId = fingerprint.chordId;
+        handShape.endTime = fingerprint.endTime;
+        handShape.startTime = fingerprint.startTime;
+        level.handShapes.push_back(handShape);
       }
-
-      if (!found)
-        songTrack.transcriptionTrack.anchors.push_back(anchor);
+      std::inplace_merge(level.handShapes.begin(), level.handShapes.begin() + mergeBegin, level.handShapes.end(),
+        [](const Song::TranscriptionTrack::HandShape& a, const Song::TranscriptionTrack::HandShape& b) { return a.startTime < b.startTime; });
     }
+
+    splitByPhraseIteration(sng, level.noteTime, [](f32 time) { return time; }, level.noteBegin);
+    splitByPhraseIteration(sng, level.anchorTime, [](f32 time) { return time; }, level.anchorBegin);
+    splitByPhraseIteration(sng, level.chords, [](const Song::TranscriptionTrack::Chord& chord) { return chord.time; }, level.chordBegin);
+    splitByPhraseIteration(sng, level.handShapes, [](const Song::TranscriptionTrack::HandShape& handShape) { return handShape.startTime; }, level.handShapeBegin);
   }
 
-  return songTrack;
+  for (i32 i = 0; i < i32(levels.level.size()); ++i)
+  {
+    const i32 difficulty = max_(levels.level[i].difficulty, 0);
+    if (difficulty >= i32(levels.levelOfDifficulty.size()))
+      levels.levelOfDifficulty.resize(difficulty + 1, -1);
+    levels.levelOfDifficulty[difficulty] = i;
+  }
+  for (i32 i = 1; i < i32(levels.levelOfDifficulty.size()); ++i)
+    if (levels.levelOfDifficulty[i] == -1)
+      levels.levelOfDifficulty[i] = levels.levelOfDifficulty[i - 1];
+  for (i32 i = i32(levels.levelOfDifficulty.size()) - 2; i >= 0; --i)
+    if (levels.levelOfDifficulty[i] == -1)
+      levels.levelOfDifficulty[i] = levels.levelOfDifficulty[i + 1];
+
+  levels.activeLevel.resize(max_(i32(sng.phraseIteration.size()), 1));
+
+  return levels;
 }
 
-static Song::Track load(const Psarc::Info& psarcInfo, const std::string& name)
+// The level a difficulty selects for a phrase iteration. The phrase maxDifficulty caps difficulty.
+static i32 levelOfPhraseIteration(const Song::Track& track, i32 phraseIteration, i32 difficulty)
 {
-  switch (Global::settings.profilePreferedSongFormat)
+  if (phraseIteration < i32(track.phraseIterations.size()))
   {
-  case SongFormat::sng:
+    const i32 phraseId = track.phraseIterations[phraseIteration].phraseId;
+    if (phraseId >= 0 && phraseId < i32(track.phrases.size()))
+      difficulty = min_(difficulty, track.phrases[phraseId].maxDifficulty);
+  }
+  difficulty = clamp(difficulty, 0, i32(track.levels.levelOfDifficulty.size()) - 1);
+
+  return track.levels.levelOfDifficulty[difficulty];
+}
+
+// Reserves room for the densest choice of levels, so applyLevels and setLevel do not reallocate the arrays of the track.
+static void reserveLevels(Song::Track& track)
+{
+  i32 noteCount = 0;
+  i32 anchorCount = 0;
+  i32 chordCount = 0;
+  i32 chordNoteCount = 0;
+  i32 handShapeCount = 0;
+  for (i32 i = 0; i < i32(track.levels.activeLevel.size()); ++i)
   {
-    const std::string nameSng = name + ".sng";
-    for (const Psarc::Info::TOCEntry& tocEntry : psarcInfo.tocEntries)
-    {
-      if (tocEntry.name.ends_with(nameSng))
-        return load_sng(tocEntry);
-    }
-    const std::string nameXml = name + ".xml";
-    for (const Psarc::Info::TOCEntry& tocEntry : psarcInfo.tocEntries)
+    i32 maxNoteCount = 0;
+    i32 maxAnchorCount = 0;
+    i32 maxChordCount = 0;
+    i32 maxChordNoteCount = 0;
+    i32 maxHandShapeCount = 0;
+    for (const Song::Levels::Level& level : track.levels.level)
     {
-      if (tocEntry.name.ends_with(nameXml))
-        return load_xml(tocEntry);
+      maxNoteCount = max_(maxNoteCount, level.noteBegin[i + 1] - level.noteBegin[i]);
+      maxAnchorCount = max_(maxAnchorCount, level.anchorBegin[i + 1] - level.anchorBegin[i]);
+      maxChordCount = max_(maxChordCount, level.chordBegin[i + 1] - level.chordBegin[i]);
+      if (level.chordBegin[i + 1] > level.chordBegin[i])
+      {
+        const Song::TranscriptionTrack::Chord& lastChord = level.chords[level.chordBegin[i + 1] - 1];
+        maxChordNoteCount = max_(maxChordNoteCount, lastChord.chordNoteBegin + lastChord.chordNoteCount - level.chords[level.chordBegin[i]].chordNoteBegin);
+      }
+      maxHandShapeCount = max_(maxHandShapeCount, level.handShapeBegin[i + 1] - level.handShapeBegin[i]);
     }
+    noteCount += maxNoteCount;
+    anchorCount += maxAnchorCount;
+    chordCount += maxChordCount;
+    chordNoteCount += maxChordNoteCount;
+    handShapeCount += maxHandShapeCount;
   }
-  break;
-  case SongFormat::xml:
+  track.transcriptionTrack.noteTime.reserve(noteCount);
+  track.transcriptionTrack.noteSustain.reserve(noteCount);
+  track.transcriptionTrack.notes.reserve(noteCount);
+  track.transcriptionTrack.anchors.reserve(anchorCount);
+  track.transcriptionTrack.chords.reserve(chordCount);
+  track.transcriptionTrack.chordNoteSustain.reserve(chordNoteCount);
+  track.transcriptionTrack.chordNotes.reserve(chordNoteCount);
+  track.transcriptionTrack.handShape.reserve(handShapeCount);
+}
+
+// SNG strings are fixed size fields. A string that fills its field has no terminating zero.
+template<typename T, u64 N>
+static std::string_view sngString(const T (&field)[N])
+{
+  const char* characters = reinterpret_cast<const char*>(field);
+  return std::string_view(characters, strnlen(characters, N));
+}
+
+static Song::Track load_sng(const Psarc::Info& psarcInfo, const Psarc::Info::TOCEntry& tocEntry)
+{
+  Song::Track songTrack;
+
+  const Psarc::Content content = Psarc::content(psarcInfo, tocEntry);
+  std::vector<u8> decoded;
+  const std::span<const u8> plainText = tocEntry.format == Psarc::ContentFormat::sngPlainText ? std::span<const u8>(content) : std::span<const u8>(decoded = Sng::decode(content));
+  const Sng::View sng = Sng::view(plainText);
+  if (!sng.valid)
+    return songTrack;
+
+  for (const Sng::Info::Phrase& sngPhrase : sng.phrase)
   {
-    const std::string nameXml = name + ".xml";
-    for (const Psarc::Info::TOCEntry& tocEntry : psarcInfo.tocEntries)
+    Song::Phrase phrase;
+    phrase.name = StringPool::intern(sngString(sngPhrase.name));
+    phrase.maxDifficulty = sngPhrase.maxDifficulty;
+    songTrack.phrases.push_back(phrase);
+  }
+  for (const Sng::Info::PhraseIteration& sngPhraseIteration : sng.phraseIteration)
+  {
+    Song::PhraseIteration phraseIteration;
+    phraseIteration.time = sngPhraseIteration.startTime;
+    phraseIteration.phraseId = sngPhraseIteration.phraseId;
+    for (i32 i = 0; i < i32(NUM(sngPhraseIteration.difficulty)); ++i)
     {
-      if (tocEntry.name.ends_with(nameXml))
-        return load_xml(tocEntry);
+      if (sngPhraseIteration.difficulty[i] == 0)
+        continue;
+
+      Song::HeroLevel heroLevel;
+      heroLevel.difficulty = sngPhraseIteration.difficulty[i];
+      heroLevel.hero = i + 1;
+      phraseIteration.heroLevels.push_back(heroLevel);
     }
-    const std::string nameSng = name + ".sng";
-    for (const Psarc::Info::TOCEntry& tocEntry : psarcInfo.tocEntries)
+    songTrack.phraseIterations.push_back(phraseIteration);
+  }
+  for (const Sng::Info::Chord& sngChord : sng.chord)
+  {
+    Song::ChordTemplate chordTemplate;
+    chordTemplate.chordName = StringPool::intern(sngString(sngChord.name));
+    chordTemplate.displayName = chordTemplate.chordName;
+    i32* const fingers[] = { &chordTemplate.finger0, &chordTemplate.finger1, &chordTemplate.finger2, &chordTemplate.finger3, &chordTemplate.finger4, &chordTemplate.finger5 };
+    i32* const frets[] = { &chordTemplate.fret0, &chordTemplate.fret1, &chordTemplate.fret2, &chordTemplate.fret3, &chordTemplate.fret4, &chordTemplate.fret5 };
+    for (i32 i = 0; i < i32(NUM(frets)); ++i)
     {
-      if (tocEntry.name.ends_with(nameSng))
-        return load_sng(tocEntry);
+      *fingers[i] = i8(sngChord.fingers[i]);
+      *frets[i] = i8(sngChord.frets[i]);
     }
+    songTrack.chordTemplates.push_back(chordTemplate);
   }
-  break;
+  for (const Sng::Info::Bpm& sngBpm : sng.bpm)
+  {
+    Song::Ebeat ebeat;
+    ebeat.time = sngBpm.time;
+    ebeat.measure = sngBpm.beat == 0 ? sngBpm.measure : -1; // like the xml, only the first beat of a measure has its number
+    songTrack.ebeats.push_back(ebeat);
+  }
+  for (const Sng::Info::Section& sngSection : sng.section)
+  {
+    Song::Section section;
+    section.name = sngString(sngSection.name);
+    section.number = sngSection.number;
+    section.startTime = sngSection.startTime;
+    songTrack.sections.push_back(section);
+  }
+
+  songTrack.levels = readSngLevels(sng);
+  reserveLevels(songTrack);
+  for (i32 i = 0; i < i32(songTrack.levels.activeLevel.size()); ++i)
+    songTrack.levels.activeLevel[i] = levelOfPhraseIteration(songTrack, i, std::numeric_limits<i32>::max());
+  Song::applyLevels(songTrack);
+
+  return songTrack;
+}
+
+static Song::Track load(const Psarc::Info& psarcInfo, const std::string& name)
+{
+  const i32 sngTocIndex = Psarc::findTocIndex(psarcInfo, name + ".sng");
+  const i32 xmlTocIndex = Psarc::findTocIndex(psarcInfo, name + ".xml");
+
+  switch (Global::settings.profilePreferedSongFormat)
+  {
+  case SongFormat::sng:
+    if (sngTocIndex != -1)
+      return load_sng(psarcInfo, psarcInfo.tocEntries[sngTocIndex]);
+    if (xmlTocIndex != -1)
+      return load_xml(psarcInfo, psarcInfo.tocEntries[xmlTocIndex]);
+    break;
+  case SongFormat::xml:
+    if (xmlTocIndex != -1)
+      return load_xml(psarcInfo, psarcInfo.tocEntries[xmlTocIndex]);
+    if (sngTocIndex != -1)
+      return load_sng(psarcInfo, psarcInfo.tocEntries[sngTocIndex]);
+    break;
   }
 
   assert(false);
   return Song::Track();
 }
 
-Song::Track Song::loadTrack(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags)
+static const char* arrangementName(InstrumentFlags instrumentFlags)
 {
   switch (instrumentFlags)
   {
   case InstrumentFlags::LeadGuitar:
-    return load(psarcInfo, "_lead");
+    return "_lead";
   case InstrumentFlags::LeadGuitar | InstrumentFlags::Second:
-    return load(psarcInfo, "_lead2");
+    return "_lead2";
   case InstrumentFlags::LeadGuitar | InstrumentFlags::Third:
-    return load(psarcInfo, "_lead3");
+    return "_lead3";
   case InstrumentFlags::RhythmGuitar:
-    return load(psarcInfo, "_rhythm");
+    return "_rhythm";
   case InstrumentFlags::RhythmGuitar | InstrumentFlags::Second:
-    return load(psarcInfo, "_rhythm2");
+    return "_rhythm2";
   case InstrumentFlags::RhythmGuitar | InstrumentFlags::Third:
-    return load(psarcInfo, "_rhythm3");
+    return "_rhythm3";
   case InstrumentFlags::BassGuitar:
-    return load(psarcInfo, "_bass");
+    return "_bass";
   case InstrumentFlags::BassGuitar | InstrumentFlags::Second:
-    return load(psarcInfo, "_bass2");
+    return "_bass2";
   case InstrumentFlags::BassGuitar | InstrumentFlags::Third:
-    return load(psarcInfo, "_bass3");
+    return "_bass3";
   }
+
+  assert(false);
+  return "";
 }
 
-std::vector<Song::Vocal> Song::loadVocals(const Psarc::Info& psarcInfo) {
-  for (const Psarc::Info::TOCEntry& tocEntry : psarcInfo.tocEntries)
+Song::Track Song::loadTrack(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags)
+{
+  return load(psarcInfo, arrangementName(instrumentFlags));
+}
+
+static i32 sliceSize(const std::vector<i32>& begin, i32 phraseIteration)
+{
+  return begin[phraseIteration + 1] - begin[phraseIteration];
+}
+
+// Makes room for newSize items in place of the oldSize items at begin. Within the reserved capacity this only moves the items behind.
+template<typename T>
+static void resizeSlice(std::vector<T>& items, i32 begin, i32 oldSize, i32 newSize)
+{
+  if (newSize > oldSize)
+    items.insert(items.begin() + begin + oldSize, newSize - oldSize, T{});
+  else
+    items.erase(items.begin() + begin + newSize, items.begin() + begin + oldSize);
+}
+
+void Song::setLevel(Track& track, i32 phraseIteration, i32 difficulty)
+{
+  if (track.levels.level.empty())
+    return;
+
+  ASSERT(phraseIteration >= 0 && phraseIteration < i32(track.levels.activeLevel.size()));
+
+  const i32 previousLevel = track.levels.activeLevel[phraseIteration];
+  const i32 newLevel = levelOfPhraseIteration(track, phraseIteration, difficulty);
+  if (newLevel == previousLevel)
+    return;
+  track.levels.activeLevel[phraseIteration] = newLevel;
+
+  // where the slice of the phrase iteration starts in the transcription track
+  i32 noteBegin = 0;
+  i32 chordBegin = 0;
+  i32 anchorBegin = 0;
+  i32 handShapeBegin = 0;
+  for (i32 i = 0; i < phraseIteration; ++i)
   {
-    if (tocEntry.name.ends_with("_vocals.xml"))
+    const Levels::Level& level = track.levels.level[track.levels.activeLevel[i]];
+    noteBegin += sliceSize(level.noteBegin, i);
+    chordBegin += sliceSize(level.chordBegin, i);
+    anchorBegin += sliceSize(level.anchorBegin, i);
+    handShapeBegin += sliceSize(level.handShapeBegin, i);
+  }
+
+  const Levels::Level& oldLevel = track.levels.level[previousLevel];
+  const Levels::Level& level = track.levels.level[newLevel];
+  TranscriptionTrack& transcriptionTrack = track.transcriptionTrack;
+
+  { // notes
+    const i32 oldSize = sliceSize(oldLevel.noteBegin, phraseIteration);
+    const i32 newSize = sliceSize(level.noteBegin, phraseIteration);
+    resizeSlice(transcriptionTrack.noteTime, noteBegin, oldSize, newSize);
+    resizeSlice(transcriptionTrack.noteSustain, noteBegin, oldSize, newSize);
+    resizeSlice(transcriptionTrack.notes, noteBegin, oldSize, newSize);
+    const i32 levelNoteBegin = level.noteBegin[phraseIteration];
+    std::copy_n(level.noteTime.begin() + levelNoteBegin, newSize, transcriptionTrack.noteTime.begin() + noteBegin);
+    std::copy_n(level.noteSustain.begin() + levelNoteBegin, newSize, transcriptionTrack.noteSustain.begin() + noteBegin);
+    std::copy_n(level.notes.begin() + levelNoteBegin, newSize, transcriptionTrack.notes.begin() + noteBegin);
+  }
+
+  { // chords and their notes. The chords behind the slice point to chord notes that move
+    const i32 oldSize = sliceSize(oldLevel.chordBegin, phraseIteration);
+    const i32 newSize = sliceSize(level.chordBegin, phraseIteration);
+    const i32 chordNoteBegin = chordBegin < i32(transcriptionTrack.chords.size()) ? transcriptionTrack.chords[chordBegin].chordNoteBegin : i32(transcriptionTrack.chordNotes.size());
+    i32 oldChordNoteCount = 0;
+    for (i32 i = chordBegin; i < chordBegin + oldSize; ++i)
+      oldChordNoteCount += transcriptionTrack.chords[i].chordNoteCount;
+    const i32 levelChordBegin = level.chordBegin[phraseIteration];
+    const i32 levelChordNoteBegin = newSize > 0 ? level.chords[levelChordBegin].chordNoteBegin : 0;
+    i32 newChordNoteCount = 0;
+    for (i32 i = levelChordBegin; i < levelChordBegin + newSize; ++i)
+      newChordNoteCount += level.chords[i].chordNoteCount;
+
+    resizeSlice(transcriptionTrack.chords, chordBegin, oldSize, newSize);
+    for (i32 i = 0; i < newSize; ++i)
     {
-      pugi::xml_document doc;
-      pugi::xml_parse_result result = doc.load_string(reinterpret_cast<const char*>(tocEntry.content.data()));
-      assert(result.status == pugi::status_ok);
+      TranscriptionTrack::Chord& chord = transcriptionTrack.chords[chordBegin + i];
+      chord = level.chords[levelChordBegin + i];
+      chord.chordNoteBegin += chordNoteBegin - levelChordNoteBegin;
+    }
+    for (i32 i = chordBegin + newSize; i < i32(transcriptionTrack.chords.size()); ++i)
+      transcriptionTrack.chords[i].chordNoteBegin += newChordNoteCount - oldChordNoteCount;
 
-      pugi::xml_node vocals = doc.child("vocals");
+    resizeSlice(transcriptionTrack.chordNoteSustain, chordNoteBegin, oldChordNoteCount, newChordNoteCount);
+    resizeSlice(transcriptionTrack.chordNotes, chordNoteBegin, oldChordNoteCount, newChordNoteCount);
+    std::copy_n(level.chordNoteSustain.begin() + levelChordNoteBegin, newChordNoteCount, transcriptionTrack.chordNoteSustain.begin() + chordNoteBegin);
+    std::copy_n(level.chordNotes.begin() + levelChordNoteBegin, newChordNoteCount, transcriptionTrack.chordNotes.begin() + chordNoteBegin);
+  }
 
-      std::vector<Song::Vocal> vocals_;
+  { // anchors
+    const i32 newSize = sliceSize(level.anchorBegin, phraseIteration);
+    resizeSlice(transcriptionTrack.anchors, anchorBegin, sliceSize(oldLevel.anchorBegin, phraseIteration), newSize);
+    for (i32 i = 0; i < newSize; ++i)
+    {
+      const i32 j = level.anchorBegin[phraseIteration] + i;
+      TranscriptionTrack::Anchor& anchor = transcriptionTrack.anchors[anchorBegin + i];
+      anchor.fret = level.anchorFret[j];
+      anchor.time = level.anchorTime[j];
+      anchor.width = level.anchorWidth[j];
+    }
+  }
+
+  { // hand shapes
+    const i32 newSize = sliceSize(level.handShapeBegin, phraseIteration);
+    resizeSlice(transcriptionTrack.handShape, handShapeBegin, sliceSize(oldLevel.handShapeBegin, phraseIteration), newSize);
+    std::copy_n(level.handShapes.begin() + level.handShapeBegin[phraseIteration], newSize, transcriptionTrack.handShape.begin() + handShapeBegin);
+  }
+}
 
-      //songNotes.notes.resize(notes.attribute("count").as_int());
+void Song::applyLevels(Track& track)
+{
+  if (track.levels.level.empty())
+    return;
 
-      for (pugi::xml_node vocal : vocals.children("vocal")) {
-        Song::Vocal vocal_;
+  TranscriptionTrack& transcriptionTrack = track.transcriptionTrack;
+  transcriptionTrack.noteTime.clear();
+  transcriptionTrack.noteSustain.clear();
+  transcriptionTrack.notes.clear();
+  transcriptionTrack.chords.clear();
+  transcriptionTrack.chordNoteSustain.clear();
+  transcriptionTrack.chordNotes.clear();
+  transcriptionTrack.anchors.clear();
+  transcriptionTrack.handShape.clear();
+
+  for (i32 i = 0; i < i32(track.levels.activeLevel.size()); ++i)
+  {
+    const Levels::Level& level = track.levels.level[track.levels.activeLevel[i]];
 
-        vocal_.time = vocal.attribute("time").as_float();
-        vocal_.note = vocal.attribute("note").as_int();
-        vocal_.length = vocal.attribute("length").as_float();
-        vocal_.lyric = vocal.attribute("lyric").as_string();
+    const i32 noteBegin = level.noteBegin[i];
+    const i32 noteEnd = level.noteBegin[i + 1];
+    transcriptionTrack.noteTime.insert(transcriptionTrack.noteTime.end(), level.noteTime.begin() + noteBegin, level.noteTime.begin() + noteEnd);
+    transcriptionTrack.noteSustain.insert(transcriptionTrack.noteSustain.end(), level.noteSustain.begin() + noteBegin, level.noteSustain.begin() + noteEnd);
+    transcriptionTrack.notes.insert(transcriptionTrack.notes.end(), level.notes.begin() + noteBegin, level.notes.begin() + noteEnd);
 
-        vocals_.push_back(vocal_);
-      }
+    for (i32 j = level.chordBegin[i]; j < level.chordBegin[i + 1]; ++j)
+    {
+      TranscriptionTrack::Chord chord = level.chords[j];
+      const i32 chordNoteBegin = chord.chordNoteBegin;
+      const i32 chordNoteEnd = chordNoteBegin + chord.chordNoteCount;
+      chord.chordNoteBegin = i32(transcriptionTrack.chordNotes.size());
+      transcriptionTrack.chordNoteSustain.insert(transcriptionTrack.chordNoteSustain.end(), level.chordNoteSustain.begin() + chordNoteBegin, level.chordNoteSustain.begin() + chordNoteEnd);
+      transcriptionTrack.chordNotes.insert(transcriptionTrack.chordNotes.end(), level.chordNotes.begin() + chordNoteBegin, level.chordNotes.begin() + chordNoteEnd);
+      transcriptionTrack.chords.push_back(chord);
+    }
 
-      return vocals_;
+    for (i32 j = level.anchorBegin[i]; j < level.anchorBegin[i + 1]; ++j)
+    {
+      TranscriptionTrack::Anchor anchor{};
+      anchor.fret = level.anchorFret[j];
+      anchor.time = level.anchorTime[j];
+      anchor.width = level.anchorWidth[j];
+      transcriptionTrack.anchors.push_back(anchor);
     }
+
+    transcriptionTrack.handShape.insert(transcriptionTrack.handShape.end(), level.handShapes.begin() + level.handShapeBegin[i], level.handShapes.begin() + level.handShapeBegin[i + 1]);
   }
+}
+
+std::vector<Song::Vocal> Song::loadVocals(const Psarc::Info& psarcInfo) {
+  const i32 tocIndex = Psarc::findTocIndex(psarcInfo, "_vocals.xml");
+  if (tocIndex == -1)
+    return {};
+
+  pugi::xml_document doc;
+  const Psarc::Content content = Psarc::content(psarcInfo, psarcInfo.tocEntries[tocIndex]);
+  pugi::xml_parse_result result = doc.load_buffer(content.data(), content.size()); // the content is not zero terminated
+  assert(result.status == pugi::status_ok);
+
+  pugi::xml_node vocals = doc.child("vocals");
+
+  std::vector<Song::Vocal> vocals_;
+
+  //songNotes.notes.resize(notes.attribute("count").as_int());
+
+  for (pugi::xml_node vocal : vocals.children("vocal")) {
+    Song::Vocal vocal_;
+
+    vocal_.time = vocal.attribute("time").as_float();
+    vocal_.note = vocal.attribute("note").as_int();
+    vocal_.length = vocal.attribute("length").as_float();
+    vocal_.lyric = StringPool::intern(vocal.attribute("lyric").as_string());
+
+    vocals_.push_back(vocal_);
+  }
+
+  return vocals_;
+}
+
+// The track cache keeps a snapshot of the track and the vocals of an arrangement in a directory of its own, the psarc
+// directory can be read-only. It is valid as long as size and write time of the psarc file and the prefered song format
+// did not change.
+static const char trackCacheDirectory[] = "trackcache";
+static const u32 trackCacheMagic = 0x4B525452; // "RTRK"
+static const u32 trackCacheVersion = 2;
+
+static const InstrumentFlags arrangementInstrumentFlags[] = {
+  InstrumentFlags::LeadGuitar,
+  InstrumentFlags::LeadGuitar | InstrumentFlags::Second,
+  InstrumentFlags::LeadGuitar | InstrumentFlags::Third,
+  InstrumentFlags::RhythmGuitar,
+  InstrumentFlags::RhythmGuitar | InstrumentFlags::Second,
+  InstrumentFlags::RhythmGuitar | InstrumentFlags::Third,
+  InstrumentFlags::BassGuitar,
+  InstrumentFlags::BassGuitar | InstrumentFlags::Second,
+  InstrumentFlags::BassGuitar | InstrumentFlags::Third
+};
+
+template<typename Stream, typename T>
+static void serializeLevel(Stream& stream, T& level)
+{
+  stream(level.difficulty);
+  Serialize::array(stream, level.noteTime);
+  Serialize::array(stream, level.noteSustain);
+  Serialize::array(stream, level.notes);
+  Serialize::array(stream, level.anchorTime);
+  Serialize::array(stream, level.anchorFret);
+  Serialize::array(stream, level.anchorWidth);
+  Serialize::array(stream, level.chords);
+  Serialize::array(stream, level.chordNoteSustain);
+  Serialize::array(stream, level.chordNotes);
+  Serialize::array(stream, level.handShapes);
+  Serialize::array(stream, level.noteBegin);
+  Serialize::array(stream, level.anchorBegin);
+  Serialize::array(stream, level.chordBegin);
+  Serialize::array(stream, level.handShapeBegin);
+}
+
+template<typename Stream, typename T>
+static void serializeTrack(Stream& stream, T& track)
+{
+  Serialize::vector(stream, track.phrases, [](Stream& stream_, auto& phrase)
+    {
+      stream_(phrase.maxDifficulty);
+      stream_(phrase.name);
+    });
+  Serialize::vector(stream, track.phraseIterations, [](Stream& stream_, auto& phraseIteration)
+    {
+      stream_(phraseIteration.time);
+      stream_(phraseIteration.phraseId);
+      stream_(phraseIteration.variation);
+      Serialize::array(stream_, phraseIteration.heroLevels);
+    });
+  Serialize::vector(stream, track.chordTemplates, [](Stream& stream_, auto& chordTemplate)
+    {
+      stream_(chordTemplate.chordName);
+      stream_(chordTemplate.displayName);
+      stream_(chordTemplate.finger0);
+      stream_(chordTemplate.finger1);
+      stream_(chordTemplate.finger2);
+      stream_(chordTemplate.finger3);
+      stream_(chordTemplate.finger4);
+      stream_(chordTemplate.finger5);
+      stream_(chordTemplate.fret0);
+      stream_(chordTemplate.fret1);
+      stream_(chordTemplate.fret2);
+      stream_(chordTemplate.fret3);
+      stream_(chordTemplate.fret4);
+      stream_(chordTemplate.fret5);
+    });
+  Serialize::array(stream, track.ebeats);
+  Serialize::vector(stream, track.sections, [](Stream& stream_, auto& section)
+    {
+      stream_(section.name);
+      stream_(section.number);
+      stream_(section.startTime);
+    });
+  Serialize::array(stream, track.transcriptionTrack.noteTime);
+  Serialize::array(stream, track.transcriptionTrack.noteSustain);
+  Serialize::array(stream, track.transcriptionTrack.notes);
+  Serialize::array(stream, track.transcriptionTrack.chords);
+  Serialize::array(stream, track.transcriptionTrack.chordNoteSustain);
+  Serialize::array(stream, track.transcriptionTrack.chordNotes);
+  Serialize::array(stream, track.transcriptionTrack.anchors);
+  Serialize::array(stream, track.transcriptionTrack.handShape);
+  Serialize::vector(stream, track.levels.level, [](Stream& stream_, auto& level) { serializeLevel(stream_, level); });
+  Serialize::array(stream, track.levels.levelOfDifficulty);
+  Serialize::array(stream, track.levels.activeLevel);
+}
+
+template<typename Stream, typename T>
+static void serializeVocals(Stream& stream, T& vocals)
+{
+  Serialize::vector(stream, vocals, [](Stream& stream_, auto& vocal)
+    {
+      stream_(vocal.time);
+      stream_(vocal.note);
+      stream_(vocal.length);
+      stream_(vocal.lyric);
+    });
+}
+
+namespace {
+  struct TrackCacheHeader
+  {
+    u32 magic;
+    u32 version;
+    u64 sourceSize;
+    i64 sourceWriteTime;
+    SongFormat songFormat;
+    InstrumentFlags instrumentFlags;
+  };
+}
+
+template<typename Stream, typename T>
+static void serializeTrackCacheHeader(Stream& stream, T& header)
+{
+  stream(header.magic);
+  stream(header.version);
+  stream(header.sourceSize);
+  stream(header.sourceWriteTime);
+  stream(header.songFormat);
+  stream(header.instrumentFlags);
+}
+
+static TrackCacheHeader trackCacheHeader(const std::string& filepath, InstrumentFlags instrumentFlags, bool& valid)
+{
+  TrackCacheHeader header{};
+  header.magic = trackCacheMagic;
+  header.version = trackCacheVersion;
+  header.songFormat = Global::settings.profilePreferedSongFormat;
+  header.instrumentFlags = instrumentFlags;
+
+  std::error_code error;
+  header.sourceSize = std::filesystem::file_size(filepath, error);
+  if (!error)
+    header.sourceWriteTime = std::filesystem::last_write_time(filepath, error).time_since_epoch().count();
+  valid = !error;
+
+  return header;
+}
+
+// A chord references its notes by index
+static bool validChordNotes(const std::vector<Song::TranscriptionTrack::Chord>& chords, u64 chordNoteCount)
+{
+  for (const Song::TranscriptionTrack::Chord& chord : chords)
+    if (chord.chordNoteBegin < 0 || chord.chordNoteCount < 0 || u64(chord.chordNoteBegin) + u64(chord.chordNoteCount) > chordNoteCount)
+      return false;
+  return true;
+}
+
+// Each phrase iteration of a level is a range [begin[i], begin[i + 1]) of its arrays
+static bool validLevelRanges(const std::vector<i32>& begin, u64 phraseIterationCount, u64 count)
+{
+  if (begin.size() != phraseIterationCount + 1 || begin.front() < 0 || u64(begin.back()) > count)
+    return false;
+  for (u64 i = 1; i < begin.size(); ++i)
+    if (begin[i] < begin[i - 1])
+      return false;
+  return true;
+}
+
+// The indices applyLevels and reserveLevels follow. A damaged cache file must not make them read out of bounds.
+static bool validTrackIndices(const Song::Track& track)
+{
+  const Song::TranscriptionTrack& transcriptionTrack = track.transcriptionTrack;
+  if (transcriptionTrack.noteSustain.size() != transcriptionTrack.noteTime.size() || transcriptionTrack.notes.size() != transcriptionTrack.noteTime.size())
+    return false;
+  if (transcriptionTrack.chordNoteSustain.size() != transcriptionTrack.chordNotes.size() || !validChordNotes(transcriptionTrack.chords, transcriptionTrack.chordNotes.size()))
+    return false;
+
+  const Song::Levels& levels = track.levels;
+  const u64 phraseIterationCount = levels.activeLevel.size();
+  for (const Song::Levels::Level& level : levels.level)
+  {
+    if (level.noteSustain.size() != level.noteTime.size() || level.notes.size() != level.noteTime.size())
+      return false;
+    if (level.anchorFret.size() != level.anchorTime.size() || level.anchorWidth.size() != level.anchorTime.size())
+      return false;
+    if (level.chordNoteSustain.size() != level.chordNotes.size() || !validChordNotes(level.chords, level.chordNotes.size()))
+      return false;
+    if (!validLevelRanges(level.noteBegin, phraseIterationCount, level.noteTime.size())
+      || !validLevelRanges(level.anchorBegin, phraseIterationCount, level.anchorTime.size())
+      || !validLevelRanges(level.chordBegin, phraseIterationCount, level.chords.size())
+      || !validLevelRanges(level.handShapeBegin, phraseIterationCount, level.handShapes.size()))
+      return false;
+  }
+  for (const i32 activeLevel : levels.activeLevel)
+    if (activeLevel < 0 || activeLevel >= i32(levels.level.size()))
+      return false;
+  for (const i32 level : levels.levelOfDifficulty)
+    if (level < 0 || level >= i32(levels.level.size()))
+      return false;
+  if (!levels.level.empty() && levels.levelOfDifficulty.empty())
+    return false; // setLevel picks from it
+
+  return true;
+}
+
+static bool loadTrackCache(const std::string& cachePath, const TrackCacheHeader& expectedHeader, Song::Track& track, std::vector<Song::Vocal>& vocals)
+{
+  if (!File::exists(cachePath.c_str()))
+    return false;
+
+  const std::shared_ptr<const File::MappedFile> mappedFile = File::map(cachePath.c_str());
+  if (mappedFile == nullptr)
+    return false;
+
+  Serialize::Reader reader{ mappedFile->data, mappedFile->data + mappedFile->size };
+
+  TrackCacheHeader header;
+  serializeTrackCacheHeader(reader, header);
+  if (!reader.valid || header.magic != expectedHeader.magic || header.version != expectedHeader.version || header.sourceSize != expectedHeader.sourceSize
+    || header.sourceWriteTime != expectedHeader.sourceWriteTime || header.songFormat != expectedHeader.songFormat || header.instrumentFlags != expectedHeader.instrumentFlags)
+    return false; // outdated. Parsed again and overwritten.
+
+  Song::Track cachedTrack;
+  std::vector<Song::Vocal> cachedVocals;
+  serializeTrack(reader, cachedTrack);
+  serializeVocals(reader, cachedVocals);
+  if (!reader.valid || reader.cur != reader.end || !validTrackIndices(cachedTrack))
+    return false;
+
+  track = std::move(cachedTrack);
+  vocals = std::move(cachedVocals);
+  if (!track.levels.level.empty())
+    reserveLevels(track);
+
+  return true;
+}
+
+// Without a writable cache directory the arrangement is parsed every time
+static void saveTrackCache(const std::string& cachePath, const TrackCacheHeader& header, const Song::Track& track, const std::vector<Song::Vocal>& vocals)
+{
+  Serialize::Writer writer;
+  serializeTrackCacheHeader(writer, header);
+  serializeTrack(writer, track);
+  serializeVocals(writer, vocals);
+
+  std::error_code error;
+  std::filesystem::create_directories(trackCacheDirectory, error);
+
+  const std::string tempPath = cachePath + ".tmp";
+  if (!File::save(tempPath.c_str(), reinterpret_cast<const char*>(writer.data.data()), writer.data.size()))
+  {
+    std::filesystem::remove(tempPath, error);
+    return;
+  }
+
+  std::filesystem::rename(tempPath, cachePath, error);
+}
+
+static std::string trackCachePath(const std::string& filepath, InstrumentFlags instrumentFlags)
+{
+  const std::string filename = std::filesystem::path(filepath).filename().string();
+  return (std::filesystem::path(trackCacheDirectory) / (filename + arrangementName(instrumentFlags) + ".rftrack")).string();
+}
+
+std::string Song::trackCachePath(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags)
+{
+  return ::trackCachePath(psarcInfo.filepath, instrumentFlags);
+}
+
+void Song::removeTrackCaches(const std::string& filepath)
+{
+  for (const InstrumentFlags instrumentFlags : arrangementInstrumentFlags)
+  {
+    std::error_code error;
+    std::filesystem::remove(::trackCachePath(filepath, instrumentFlags), error);
+  }
+}
+
+void Song::loadArrangement(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags, Track& track, std::vector<Vocal>& vocals, const std::atomic<bool>* cancel)
+{
+  bool cacheable = !psarcInfo.filepath.empty(); // archives parsed from memory have no file to compare against
+  TrackCacheHeader header{};
+  std::string cachePath;
+  if (cacheable)
+  {
+    header = trackCacheHeader(psarcInfo.filepath, instrumentFlags, cacheable);
+    cachePath = trackCachePath(psarcInfo, instrumentFlags);
+  }
+
+  if (cacheable && loadTrackCache(cachePath, header, track, vocals))
+    return;
+
+  track = loadTrack(psarcInfo, instrumentFlags);
+  if (cancel != nullptr && *cancel)
+    return;
+  vocals = loadVocals(psarcInfo);
 
-  return {};
+  if (cacheable && (cancel == nullptr || !*cancel))
+    saveTrackCache(cachePath, header, track, vocals);
 }
 
 const char* Song::tuningName(const Tuning& tuning) {
@@ -5,6 +5,8 @@
 #include "sng.h"
 #include "xblock.h"
 
+#include <atomic>
+
 namespace Psarc { struct Info; }
 
 namespace Song {
@@ -16,9 +18,17 @@ namespace Song {
     complete,
   };
 
+  enum struct Integrity : u8
+  {
+    unknown,
+    ok,
+    damaged,
+  };
+
   struct Info
   {
     LoadState loadState = LoadState::none;
+    Integrity integrity = Integrity::unknown;
     XBlock::Info xblock;
     std::vector<Manifest::Info> manifestInfos;
     std::vector<Manifest::Tone> tones;
@@ -31,12 +41,13 @@ namespace Song {
   };
 
   Info loadSongInfoManifestOnly(const Psarc::Info& psarcInfo);
-  void loadSongInfoComplete(const Psarc::Info& psarcInfo, Song::Info& songInfo);
+  // Returns early without completing songInfo when cancel is set.
+  void loadSongInfoComplete(const Psarc::Info& psarcInfo, Song::Info& songInfo, const std::atomic<bool>* cancel = nullptr);
 
   struct Phrase
   {
     i32 maxDifficulty;
-    std::string name;
+    StringPool::String name;
   };
 
   struct HeroLevel
@@ -49,14 +60,14 @@ namespace Song {
   {
     f32 time;
     i32 phraseId;
-    std::string variation;
+    StringPool::String variation;
     std::vector<HeroLevel> heroLevels;
   };
 
   struct ChordTemplate
   {
-    std::string chordName;
-    std::string displayName;
+    StringPool::String chordName;
+    StringPool::String displayName;
     i32 finger0;
     i32 finger1;
     i32 finger2;
@@ -86,41 +97,51 @@ namespace Song {
 
   struct TranscriptionTrack
   {
+    enum struct Technique : u32
+    {
+      none,
+      linkNext = 1 << 0,
+      accent = 1 << 1,
+      bend = 1 << 2,
+      hammerOn = 1 << 3,
+      harmonic = 1 << 4,
+      hopo = 1 << 5,
+      ignore = 1 << 6,
+      mute = 1 << 7,
+      palmMute = 1 << 8,
+      pluck = 1 << 9,
+      pullOff = 1 << 10,
+      slap = 1 << 11,
+      tremolo = 1 << 12,
+      harmonicPinch = 1 << 13,
+      pickDirection = 1 << 14,
+      rightHand = 1 << 15,
+      tap = 1 << 16,
+    }BIT_FLAGS_FRIEND(Technique);
+
+    // Time and sustain are kept in arrays of their own, so scanning for the visible notes does not load the rest.
     struct Note
     {
-      f32 time;
-      bool linkNext;
-      bool accent;
-      bool bend;
-      i32 fret;
-      bool hammerOn;
-      bool harmonic;
-      bool hopo;
-      bool ignore;
-      i32 leftHand;
-      bool mute;
-      bool palmMute;
-      bool pluck;
-      bool pullOff;
-      bool slap;
-      i32 slideTo;
-      i32 string;
-      f32 sustain;
-      bool tremolo;
-      bool harmonicPinch;
-      bool pickDirection;
-      bool rightHand;
-      i32 slideUnpitchTo;
-      bool tap;
-      i32 vibrato;
+      Technique technique;
+      i16 vibrato;
+      i8 string;
+      i8 fret;
+      i8 slideTo;
+      i8 slideUnpitchTo;
+      i8 leftHand;
+
+      bool has(Technique flag) const
+      {
+        return to_underlying(technique & flag) != 0;
+      }
     };
     struct Chord
     {
       f32 time;
       i32 chordId;
       bool strum;
-
-      std::vector<Note> chordNotes;
+      i32 chordNoteBegin; // index into chordNotes. Chord notes have the time of their chord
+      i32 chordNoteCount;
     };
     struct Anchor
     {
@@ -135,12 +156,44 @@ namespace Song {
       f32 startTime;
     };
 
+    std::vector<f32> noteTime;
+    std::vector<f32> noteSustain;
     std::vector<Note> notes;
     std::vector<Chord> chords;
+    std::vector<f32> chordNoteSustain;
+    std::vector<Note> chordNotes;
     std::vector<Anchor> anchors;
     std::vector<HandShape> handShape;
   };
 
+  // Every difficulty level of an arrangement, built once when the SNG is loaded.
+  // A level keeps its notes and anchors sorted by time as structure of arrays and split by phrase iteration.
+  struct Levels
+  {
+    struct Level
+    {
+      i32 difficulty;
+      std::vector<f32> noteTime;
+      std::vector<f32> noteSustain;
+      std::vector<TranscriptionTrack::Note> notes;
+      std::vector<f32> anchorTime;
+      std::vector<u8> anchorFret;
+      std::vector<u8> anchorWidth;
+      std::vector<TranscriptionTrack::Chord> chords; // chordNoteBegin is an index into chordNotes of the level
+      std::vector<f32> chordNoteSustain;
+      std::vector<TranscriptionTrack::Note> chordNotes;
+      std::vector<TranscriptionTrack::HandShape> handShapes; // includes the arpeggios
+      std::vector<i32> noteBegin; // first note of each phrase iteration. One more entry than phrase iterations
+      std::vector<i32> anchorBegin;
+      std::vector<i32> chordBegin;
+      std::vector<i32> handShapeBegin;
+    };
+
+    std::vector<Level> level;
+    std::vector<i32> levelOfDifficulty; // a difficulty without a level of its own uses the next lower one
+    std::vector<i32> activeLevel; // per phrase iteration
+  };
+
   struct Track
   {
     std::vector<Phrase> phrases;
@@ -149,19 +202,34 @@ namespace Song {
     std::vector<Ebeat> ebeats;
     std::vector<Section> sections;
     TranscriptionTrack transcriptionTrack;
+    Levels levels; // empty when the track was loaded from XML
   };
 
   Track loadTrack(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags);
+  // Switches the level of one phrase iteration while the song plays. The phrase maxDifficulty caps difficulty.
+  // Only the slice of the phrase iteration in transcriptionTrack is replaced. It is linear in the phrase iterations before it,
+  // plus moving the items behind it. No allocation, the capacity loadTrack reserved fits any choice of levels.
+  void setLevel(Track& track, i32 phraseIteration, i32 difficulty);
+  // Rebuilds the whole transcriptionTrack from the active levels, linear in the notes of the track. loadTrack calls it once.
+  void applyLevels(Track& track);
 
   struct Vocal
   {
     f32 time;
     i32 note;
     f32 length;
-    std::string lyric;
+    StringPool::String lyric;
   };
   std::vector<Vocal> loadVocals(const Psarc::Info& psarcInfo);
 
+  // Track and vocals of an arrangement. Read from the track cache file when it is up to date and intact,
+  // otherwise loaded with loadTrack and loadVocals and written to the track cache.
+  // When cancel is set in between, it returns early and writes no track cache.
+  void loadArrangement(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags, Track& track, std::vector<Vocal>& vocals, const std::atomic<bool>* cancel = nullptr);
+  std::string trackCachePath(const Psarc::Info& psarcInfo, InstrumentFlags instrumentFlags);
+  // The track caches of all arrangements of a psarc file that was modified or removed
+  void removeTrackCaches(const std::string& filepath);
+
   const char* tuningName(const Tuning& tuning);
 }
 
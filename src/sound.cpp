@@ -3,6 +3,7 @@
 #include "data.h"
 #include "global.h"
 #include "pcm.h"
+#include "player.h"
 #include "plugin.h"
 #include "settings.h"
 
@@ -208,21 +209,7 @@ static void audioPlaybackCallback(void* userdata, u8* stream, i32 len)
     break;
   }
 
-  if (Global::musicBufferPosition != nullptr)
-  {
-    const i64 remainingLength = &Global::musicBuffer[Global::musicBufferLength] - Global::musicBufferPosition;
-    if (remainingLength > 0)
-    {
-      len = i32(len > remainingLength ? remainingLength : len);
-      SDL_MixAudioFormat(stream, Global::musicBufferPosition, AUDIO_F32LSB, len, Global::settings.mixerMusicVolume);
-
-      Global::musicBufferPosition += len;
-    }
-    else
-    {
-      Global::musicBufferPosition = nullptr;
-    }
-  }
+  Player::mixMusic(stream, len);
 
 #ifndef __EMSCRIPTEN__
   recordingFirst = !recordingFirst;
@@ -267,3 +254,13 @@ void Sound::init()
 #endif // #ifndef __EMSCRIPTEN__
   SDL_PauseAudioDevice(devid_out, false);
 }
+
+void Sound::lockPlayback()
+{
+  SDL_LockAudioDevice(devid_out);
+}
+
+void Sound::unlockPlayback()
+{
+  SDL_UnlockAudioDevice(devid_out);
+}
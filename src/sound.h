@@ -6,6 +6,9 @@
 namespace Sound
 {
   void init();
+  // The playback callback does not run while the output device is locked. Global::musicBuffer is swapped in between.
+  void lockPlayback();
+  void unlockPlayback();
 };
 
 #endif // SOUND_H
@@ -0,0 +1,95 @@
+#include "stringPool.h"
+
+#include <mutex>
+#include <string.h>
+#include <unordered_map>
+
+// A handle is the chunk index in the upper and the offset inside the chunk in the lower 16 bits.
+// Each entry is the u32 length followed by the characters and a terminating zero.
+static const u32 chunkSize = 1 << 16;
+static const u32 maxChunkCount = 1 << 16;
+
+namespace {
+  struct Pool
+  {
+    std::mutex mutex;
+    char* chunks[maxChunkCount]; // chunks never move, so the handed out handles stay valid without locking
+    u32 chunkCount = 0;
+    u32 chunkUsed = chunkSize;
+    std::unordered_map<std::string_view, u32> handles;
+  };
+}
+
+static char* append(Pool& pool, std::string_view string, u32& handle)
+{
+  const u32 entrySize = sizeof(u32) + u32(string.size()) + 1;
+  if (pool.chunkUsed + entrySize > chunkSize)
+  {
+    ASSERT(pool.chunkCount < maxChunkCount);
+    pool.chunks[pool.chunkCount++] = new char[entrySize > chunkSize ? entrySize : chunkSize]; // a long string gets a chunk of its own
+    pool.chunkUsed = 0;
+  }
+
+  handle = ((pool.chunkCount - 1) << 16) | pool.chunkUsed;
+  char* entry = pool.chunks[pool.chunkCount - 1] + pool.chunkUsed;
+  const u32 length = u32(string.size());
+  memcpy(entry, &length, sizeof(u32));
+  memcpy(entry + sizeof(u32), string.data(), string.size());
+  entry[sizeof(u32) + string.size()] = '\0';
+  pool.chunkUsed = entrySize > chunkSize ? chunkSize : pool.chunkUsed + entrySize;
+
+  return entry + sizeof(u32);
+}
+
+static Pool& pool()
+{
+  static Pool* pool = []
+  {
+    Pool* pool_ = new Pool; // never destroyed. Strings are still read while static destructors run at exit.
+    u32 handle;
+    append(*pool_, "", handle);
+    ASSERT(handle == 0);
+    return pool_;
+  }();
+  return *pool;
+}
+
+static const char* entry(u32 handle)
+{
+  return pool().chunks[handle >> 16] + (handle & 0xFFFF);
+}
+
+const char* StringPool::String::c_str() const
+{
+  return entry(handle) + sizeof(u32);
+}
+
+std::string_view StringPool::String::view() const
+{
+  const char* e = entry(handle);
+  u32 length;
+  memcpy(&length, e, sizeof(u32));
+  return std::string_view(e + sizeof(u32), length);
+}
+
+StringPool::String StringPool::intern(std::string_view string)
+{
+  String interned;
+  if (string.empty())
+    return interned;
+
+  Pool& pool_ = pool();
+  const std::unique_lock lock(pool_.mutex);
+
+  const auto it = pool_.handles.find(string);
+  if (it != pool_.handles.end())
+  {
+    interned.handle = it->second;
+    return interned;
+  }
+
+  const char* characters = append(pool_, string, interned.handle);
+  pool_.handles.emplace(std::string_view(characters, string.size()), interned.handle);
+
+  return interned;
+}
@@ -0,0 +1,30 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include "typedefs.h"
+
+#include <string_view>
+
+// Interned strings of the song collection. Each distinct string is stored once in an arena that lives for the whole run.
+// A String is a 32-bit handle into it, so equal strings have equal handles.
+namespace StringPool
+{
+  struct String
+  {
+    u32 handle = 0; // 0 is the empty string
+
+    const char* c_str() const;
+    std::string_view view() const;
+    u32 size() const { return u32(view().size()); }
+    bool empty() const { return handle == 0; }
+    char operator[](u32 i) const { return c_str()[i]; }
+
+    bool operator==(const String& other) const { return handle == other.handle; }
+    bool operator==(std::string_view other) const { return view() == other; }
+  };
+
+  // Thread safe. Reading a String never locks.
+  String intern(std::string_view string);
+}
+
+#endif // STRING_POOL_H
@@ -3,14 +3,21 @@
 #ifdef RUN_TEST
 
 #include "base64.h"
+#include "file.h"
 #include "getopt.h"
 #include "global.h"
+#include "inflate.h"
 #include "installer.h"
+#include "md5.h"
 #include "pcm.h"
+#include "player.h"
 #include "psarc.h"
 #include "rijndael.h"
 #include "settings.h"
+#include "sng.h"
 #include "song.h"
+#include "stringPool.h"
+#include "threadPool.h"
 #include "wem.h"
 #ifdef SUPPORT_BNK
 #include "bnk.h"
@@ -19,6 +26,7 @@
 
 #include <SDL2/SDL.h>
 
+#include <algorithm>
 #include <filesystem>
 
 static void base64Test()
@@ -122,6 +130,112 @@ static void endianesTest()
   assert(16909060_u64 == u40_be(data));
 }
 
+static void md5Test()
+{
+  const auto md5Hex = [](const char* text)
+  {
+    u8 digest[16];
+    Md5::hash(reinterpret_cast<const u8*>(text), strlen(text), digest);
+
+    char hex[33];
+    for (i32 i = 0; i < 16; ++i)
+      sprintf(&hex[i * 2], "%02x", digest[i]);
+    return std::string(hex);
+  };
+
+  assert(md5Hex("") == "d41d8cd98f00b204e9800998ecf8427e");
+  assert(md5Hex("abc") == "900150983cd24fb0d6963f7d28e17f72");
+  assert(md5Hex("message digest") == "f96b697d7cb7938d525a2f31aaf161d0");
+  assert(md5Hex("12345678901234567890123456789012345678901234567890123456789012345678901234567890") == "57edf4a22be3c955ac49da2e2107b67a");
+}
+
+static void inflateTest()
+{
+  static const char text[] = "12345678901234567890123456789012345678901234567890123456789012345678901234567890";
+  static const i32 textLen = sizeof(text) - 1;
+
+  static const u8 compressed[] = {
+    0x78, 0xda, 0x33, 0x34, 0x32, 0x36, 0x31, 0x35, 0x33, 0xb7, 0xb0, 0x34, 0x30, 0xa4, 0x0a, 0x0b,
+    0x00, 0x97, 0xb6, 0x10, 0x69
+  };
+
+  u8 stored[7 + textLen + 4] = { 0x78, 0x01, 0x01, u8(textLen), 0x00, u8(~textLen), 0xFF };
+  memcpy(&stored[7], text, textLen);
+  memcpy(&stored[7 + textLen], &compressed[sizeof(compressed) - 4], 4); // same adler-32
+
+  for (const auto& [data, size] : { std::pair(compressed, i32(sizeof(compressed))), std::pair(static_cast<const u8*>(stored), i32(sizeof(stored))) })
+  {
+    u8 plainText[textLen];
+    u32 crc = 0;
+    ASSERT(Inflate::inflate(data, size, plainText, textLen, &crc) == textLen);
+    ASSERT(memcmp(plainText, text, textLen) == 0);
+    ASSERT(crc == 0x7ca94a72);
+
+    memset(plainText, 0, textLen);
+    ASSERT(Inflate::inflate(data, size, plainText, textLen) == textLen);
+    ASSERT(memcmp(plainText, text, textLen) == 0);
+    ASSERT(Inflate::verify(data, size, plainText, textLen));
+  }
+
+  { // stream fed one byte at a time and read in small windows
+    Inflate::Stream stream;
+    std::string plainText;
+    i32 fed = 0;
+    Inflate::StreamStatus status;
+    do
+    {
+      u8 window[7];
+      i32 used;
+      i32 written;
+      status = stream.decode(&stored[fed], min_(i32(sizeof(stored)) - fed, 1), used, window, sizeof(window), written);
+      fed += used;
+      plainText.append(reinterpret_cast<const char*>(window), written);
+      ASSERT(status != Inflate::StreamStatus::error);
+    } while (status != Inflate::StreamStatus::end);
+    ASSERT(plainText == text);
+  }
+
+  { // 100000 bytes with matches that cross the end of the stream window
+    static const u8 longCompressed[] = {
+      0x78, 0xda, 0xed, 0xc5, 0x59, 0x36, 0x82, 0x01, 0x18, 0x00, 0xd0, 0x3f, 0x15, 0x5a, 0x45, 0x23,
+      0x5a, 0x45, 0x9a, 0x64, 0x15, 0x0d, 0xa8, 0x56, 0x91, 0xa9, 0xb2, 0x0a, 0x34, 0xd0, 0x2a, 0x0c,
+      0x15, 0x36, 0x66, 0x1d, 0xdf, 0x39, 0xf7, 0xbe, 0xdc, 0x24, 0x5f, 0xeb, 0x4e, 0x9e, 0x3f, 0x12,
+      0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x22, 0x77,
+      0xfb, 0xf2, 0x99, 0x2a, 0x9c, 0xf7, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+      0x49, 0x92, 0x24, 0x49, 0x0a, 0x5d, 0xb1, 0xde, 0xbf, 0x7b, 0xfd, 0x3a, 0x90, 0x24, 0x49, 0x92,
+      0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x29, 0x74, 0x8b, 0xef, 0x74, 0xa9,
+      0x31, 0xb8, 0x97, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+      0x29, 0x74, 0xcd, 0xab, 0x87, 0xe5, 0x36, 0x53, 0x96, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+      0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x29, 0x74, 0xbb, 0x6c, 0xa5, 0x75, 0xfd, 0xb8, 0x92, 0x24,
+      0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x29, 0x74, 0x37, 0xd3,
+      0xf5, 0xfe, 0xf0, 0xa4, 0x2d, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92,
+      0x24, 0x49, 0x52, 0xe8, 0x8e, 0x4e, 0x2f, 0x86, 0xb3, 0xb7, 0x1f, 0x49, 0x92, 0x24, 0x49, 0x92,
+      0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x42, 0x37, 0x7f, 0xff, 0x3d, 0x3e, 0xeb,
+      0x8c, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x0a,
+      0x5d, 0xf5, 0x72, 0xfc, 0xb4, 0xf9, 0xcb, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24, 0x49, 0x92, 0x24,
+      0x49, 0x92, 0x24, 0x49, 0x92, 0x14, 0xba, 0x7f, 0x7a, 0x4e, 0xce, 0x02
+    };
+
+    Inflate::Stream stream;
+    i32 fed = 0;
+    i32 total = 0;
+    for (;;)
+    {
+      u8 window[1000];
+      i32 used;
+      i32 written;
+      const Inflate::StreamStatus status = stream.decode(&longCompressed[fed], min_(i32(sizeof(longCompressed)) - fed, 5), used, window, sizeof(window), written);
+      fed += used;
+      for (i32 i = 0; i < written; ++i, ++total)
+        ASSERT(window[i] == u8((total % 7) * 31 + total / 10000));
+      ASSERT(status != Inflate::StreamStatus::error);
+      if (status == Inflate::StreamStatus::end)
+        break;
+    }
+    ASSERT(total == 100000);
+  }
+}
+
 static void installerTest() {
   if (Global::isInstalled) {
     std::filesystem::remove("settings.ini");
@@ -139,6 +253,80 @@ static void installerTest() {
   ASSERT(!Global::isInstalled);
 };
 
+static void stringPoolTest() {
+  const StringPool::String empty = StringPool::intern("");
+  ASSERT(empty.empty());
+  ASSERT(empty == StringPool::String());
+  ASSERT(empty.c_str()[0] == '\0');
+
+  const StringPool::String a = StringPool::intern("Napalm Death");
+  const StringPool::String b = StringPool::intern(std::string("Napalm Death"));
+  ASSERT(a == b);
+  ASSERT(a.handle == b.handle);
+  ASSERT(a.size() == 12);
+  ASSERT(a == "Napalm Death");
+  ASSERT(!(a == StringPool::intern("Napalm")));
+
+  // longer than a chunk and interned from many threads
+  const std::string longString(100000, 'x');
+  ThreadPool::parallelFor(64, [&](i32 i)
+    {
+      const StringPool::String string = StringPool::intern(i % 2 == 0 ? longString : std::to_string(i % 8));
+      ASSERT(string.view() == (i % 2 == 0 ? longString : std::to_string(i % 8)));
+    });
+  ASSERT(StringPool::intern(longString) == StringPool::intern(longString));
+  ASSERT(strlen(StringPool::intern(longString).c_str()) == longString.size());
+}
+
+static void playerTest()
+{
+  const u64 bytesPerSecond = u64(Global::settings.audioSampleRate) * 2 * sizeof(f32);
+  std::vector<u8> music(bytesPerSecond);
+  std::vector<u8> stream(bytesPerSecond / 10);
+
+  const f32 frameDelta = Global::frameDelta;
+  Global::frameDelta = 100.0f; // the playback callback mixes one frame of music per frame
+  Global::musicBuffer = music.data();
+  Global::musicBufferLength = music.size();
+  Global::musicBufferDecodedLength = music.size() / 2;
+  Player::seek(0.0f);
+
+  const auto playFrame = [&stream]()
+  {
+    Player::mixMusic(stream.data(), i32(stream.size()));
+    Player::tick();
+  };
+
+  for (i32 i = 0; i < 5; ++i)
+    playFrame();
+  ASSERT(Global::musicTimeElapsed > 0.499f && Global::musicTimeElapsed < 0.501f);
+
+  // the decoder falls behind. The music waits for it and the song time with it
+  for (i32 i = 0; i < 3; ++i)
+    playFrame();
+  ASSERT(Global::musicBufferPosition == Global::musicBuffer + music.size() / 2);
+  ASSERT(Global::musicTimeElapsed > 0.499f && Global::musicTimeElapsed < 0.501f);
+
+  Global::musicBufferDecodedLength = music.size();
+  for (i32 i = 0; i < 2; ++i)
+    playFrame();
+  ASSERT(Global::musicBufferPosition == Global::musicBuffer + 7 * stream.size());
+  ASSERT(Global::musicTimeElapsed > 0.699f && Global::musicTimeElapsed < 0.701f);
+
+  // a seek does not pass the decoded audio
+  Global::musicBufferDecodedLength = music.size() / 4;
+  Player::seek(0.9f);
+  ASSERT(Global::musicBufferPosition == Global::musicBuffer + music.size() / 4);
+  ASSERT(Global::musicTimeElapsed > 0.249f && Global::musicTimeElapsed < 0.251f);
+
+  Global::musicBufferPosition = nullptr;
+  Global::musicBuffer = nullptr;
+  Global::musicBufferLength = 0;
+  Global::musicBufferDecodedLength = 0;
+  Global::musicTimeElapsed = 0.0f;
+  Global::frameDelta = frameDelta;
+}
+
 static void settingsTest() {
   //    if (Installer::isInstalled(".")) {
   //        std::filesystem::remove("settings.ini");
@@ -363,6 +551,48 @@ static void rijndaelTest() {
   Rijndael::decrypt(psarcKey, &encryptedPsarc[32], plainText, plainTextLen);
   for (size_t i = 0; i < plainTextLen; ++i)
     ASSERT(expectedPlainText[i] == plainText[i]);
+
+  { // one context used by several threads at once
+    const Rijndael::Context context = Rijndael::makeContext(psarcKey);
+    ThreadPool::parallelFor(16, [&](i32)
+      {
+        u8 plainText_[plainTextLen];
+        Rijndael::decrypt(context, &encryptedPsarc[32], plainText_, plainTextLen);
+        for (size_t i = 0; i < plainTextLen; ++i)
+          ASSERT(expectedPlainText[i] == plainText_[i]);
+      });
+  }
+
+  { // ctr matches a single block cfb decryption per counter value. The iv carries into the upper bytes.
+    const Rijndael::Context context = Rijndael::makeContext(psarcKey);
+    const u8 iv[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0xFF, 0xFF, 0xFF, 0xFF, 0xF0 };
+    const size_t len = plainTextLen - 5;
+
+    u8 expected[plainTextLen];
+    u8 counter[16];
+    memcpy(counter, iv, sizeof(counter));
+    for (size_t i = 0; i < len; i += 16)
+    {
+      u8 block[16] = {};
+      memcpy(block, &encryptedPsarc[32 + i], min_(len - i, size_t(16)));
+      u8 decryptedBlock[16];
+      Rijndael::decrypt(context, block, decryptedBlock, 16, counter);
+      memcpy(&expected[i], decryptedBlock, min_(len - i, size_t(16)));
+
+      bool carry = true;
+      for (i32 j = 15; j >= 0 && carry; j--)
+        carry = ++counter[j] == 0;
+    }
+
+    u8 ctrPlainText[plainTextLen];
+    Rijndael::decryptCtr(context, &encryptedPsarc[32], ctrPlainText, len, iv);
+    ASSERT(memcmp(expected, ctrPlainText, len) == 0);
+
+    u8 splitPlainText[plainTextLen];
+    Rijndael::decryptCtr(context, &encryptedPsarc[32], splitPlainText, 272, iv);
+    Rijndael::decryptCtr(context, &encryptedPsarc[32 + 272], &splitPlainText[272], len - 272, iv, 272 / 16);
+    ASSERT(memcmp(expected, splitPlainText, len) == 0);
+  }
 }
 
 static void manifestInfosTest(const std::vector<Manifest::Info>& manifestInfos)
@@ -949,6 +1179,26 @@ static void pcmTest(const std::vector<u8>& ogg)
   assert(pcmDataSize == 7136254);
 
   free(pcmData);
+
+  // decoded piece by piece into a buffer that does not move
+  const i32 sampleRateOgg = Pcm::decodeOgg(ogg.data(), ogg.size(), &pcmData, pcmDataSize);
+  Pcm::OggStream stream;
+  const bool opened = Pcm::openOggStream(stream, ogg.data(), ogg.size(), sampleRateOgg);
+  assert(opened);
+  assert(stream.pcmDataCapacity == pcmDataSize);
+  const u8* streamPcmData = stream.pcmData;
+  i32 pieces = 1;
+  while (Pcm::decodeOggStream(stream))
+  {
+    assert(stream.pcmData == streamPcmData);
+    ++pieces;
+  }
+  Pcm::closeOggStream(stream);
+  assert(pieces > 1);
+  assert(stream.pcmDataSize == pcmDataSize);
+  assert(memcmp(stream.pcmData, pcmData, pcmDataSize) == 0);
+  free(stream.pcmData);
+  free(pcmData);
 }
 
 static void oggTest(const Psarc::Info& psarcInfo)
@@ -4351,6 +4601,504 @@ static void oggTest(const Psarc::Info& psarcInfo)
   pcmTest(ogg);
 }
 
+static void psarcLookupTest(const Psarc::Info& psarcInfo)
+{
+  assert(psarcInfo.lookup.albumArt128 == 1);
+  assert(psarcInfo.lookup.albumArt256 == 2);
+  assert(psarcInfo.lookup.albumArt64 == 3);
+  assert(psarcInfo.lookup.songBnk == 8);
+  assert(psarcInfo.lookup.previewBnk == 10);
+  assert(Psarc::findWemTocIndex(psarcInfo, 736512270) == 9);
+  assert(Psarc::findWemTocIndex(psarcInfo, 1) == -1);
+  assert(psarcInfo.tocEntries[Psarc::findTocIndex(psarcInfo, "_bass.sng")].name.ends_with("_bass.sng"));
+  assert(psarcInfo.tocEntries[Psarc::findTocIndex(psarcInfo, "_lead.json")].name.ends_with("_lead.json"));
+  assert(psarcInfo.tocEntries[Psarc::findTocIndex(psarcInfo, "_vocals.xml")].name.ends_with("_vocals.xml"));
+  assert(psarcInfo.tocEntries[psarcInfo.lookup.xblock].name.ends_with(".xblock"));
+  assert(psarcInfo.tocEntries[psarcInfo.lookup.hsan].name.ends_with(".hsan"));
+  assert(Psarc::findTocIndex(psarcInfo, "_rhythm.sng") == -1);
+}
+
+// The test psarc saved as a file in the temp directory for the tests that open it by path.
+// Files a failed run left behind are replaced. At the end the settings are restored and the file, its repacked container and its track caches are removed.
+struct TestPsarcFile
+{
+  TestPsarcFile(const char* filename, const std::vector<u8>& psarcData)
+    : filepath((std::filesystem::temp_directory_path() / filename).string())
+    , settings(Global::settings)
+  {
+    remove();
+    File::save(filepath.c_str(), reinterpret_cast<const char*>(psarcData.data()), psarcData.size());
+  }
+
+  ~TestPsarcFile()
+  {
+    Global::settings = settings;
+    remove();
+  }
+
+  void remove() const
+  {
+    Song::removeTrackCaches(filepath);
+    std::filesystem::remove(Psarc::repackPath(filepath.c_str()));
+    std::filesystem::remove(filepath);
+  }
+
+  const std::string filepath;
+  const Settings::Info settings;
+};
+
+static void psarcLazyTest(const std::vector<u8>& psarcData, const Psarc::Info& psarcInfo)
+{
+  const TestPsarcFile psarcFile("psarcLazyTest.psarc", psarcData);
+  const std::string& filepath = psarcFile.filepath;
+
+  {
+    const Psarc::Info psarcInfoLazy = Psarc::parseToc(filepath.c_str());
+
+    assert(psarcInfoLazy.tocEntries.size() == psarcInfo.tocEntries.size());
+    for (i32 i = 1; i < psarcInfo.tocEntries.size(); ++i)
+    {
+      assert(psarcInfoLazy.tocEntries[i].name == psarcInfo.tocEntries[i].name);
+      assert(psarcInfoLazy.tocEntries[i].content.empty() || psarcInfoLazy.tocEntries[i].length == 0);
+    }
+    for (i32 i = 0; i < psarcInfo.tocEntries.size(); ++i)
+      assert(std::ranges::equal(Psarc::content(psarcInfoLazy, psarcInfoLazy.tocEntries[i]), psarcInfo.tocEntries[i].content));
+  }
+}
+
+static void psarcRepackTest(const std::vector<u8>& psarcData, const Psarc::Info& psarcInfo)
+{
+  const TestPsarcFile psarcFile("psarcRepackTest.psarc", psarcData);
+  const std::string& filepath = psarcFile.filepath;
+
+  assert(Psarc::repack(filepath.c_str()));
+
+  {
+    const Psarc::Info psarcInfoRepacked = Psarc::parseToc(filepath.c_str());
+    assert(psarcInfoRepacked.repacked);
+    assert(psarcInfoRepacked.tocEntries.size() == psarcInfo.tocEntries.size());
+    assert(psarcInfoRepacked.lookup.xblock == psarcInfo.lookup.xblock);
+
+    const Psarc::ContentCacheStats statsBefore = Psarc::contentCacheStats();
+    for (i32 i = 1; i < psarcInfo.tocEntries.size(); ++i)
+    {
+      const Psarc::Info::TOCEntry& tocEntry = psarcInfoRepacked.tocEntries[i];
+      assert(tocEntry.name == psarcInfo.tocEntries[i].name);
+
+      const Psarc::Content content = Psarc::content(psarcInfoRepacked, tocEntry);
+      assert(tocEntry.zIndexBegin == 0);
+      if (tocEntry.length > 0) // served from the mapping without a copy
+        assert(content.data() == psarcInfoRepacked.mappedFile->data + tocEntry.offset);
+      switch (tocEntry.format)
+      {
+      case Psarc::ContentFormat::original:
+        assert(std::ranges::equal(content, psarcInfo.tocEntries[i].content));
+        break;
+      case Psarc::ContentFormat::sngPlainText:
+        assert(std::ranges::equal(content, Sng::decode(psarcInfo.tocEntries[i].content)));
+        break;
+      case Psarc::ContentFormat::ogg:
+        assert(std::ranges::equal(content, Wem::to_ogg(psarcInfo.tocEntries[i].content.data(), psarcInfo.tocEntries[i].content.size())));
+        break;
+      }
+    }
+    assert(Psarc::contentCacheStats().misses == statsBefore.misses);
+    assert(Psarc::contentCacheStats().size == statsBefore.size);
+  }
+
+  { // a damaged container is not used. Entries start behind the 32 byte header, each is 32 bytes: offset, length, name offset, name length, format
+    const std::string repackPath = Psarc::repackPath(filepath.c_str());
+    const std::vector<u8> repackData = File::load(repackPath.c_str(), "rb");
+
+    std::vector<u8> damagedData = repackData;
+    const u64 offset = ~u64(0) - 8; // offset + length wraps around
+    memcpy(&damagedData[32 + 32], &offset, sizeof(offset));
+    File::save(repackPath.c_str(), reinterpret_cast<const char*>(damagedData.data()), damagedData.size());
+    assert(!Psarc::parseToc(filepath.c_str()).repacked);
+
+    damagedData = repackData;
+    const u32 format = 7;
+    memcpy(&damagedData[32 + 32 + 24], &format, sizeof(format));
+    File::save(repackPath.c_str(), reinterpret_cast<const char*>(damagedData.data()), damagedData.size());
+    assert(!Psarc::parseToc(filepath.c_str()).repacked);
+
+    File::save(repackPath.c_str(), reinterpret_cast<const char*>(repackData.data()), repackData.size());
+    assert(Psarc::parseToc(filepath.c_str()).repacked);
+  }
+
+  // a modified psarc file makes the container outdated
+  std::filesystem::last_write_time(filepath, std::filesystem::last_write_time(filepath) + std::chrono::hours(1));
+  assert(!Psarc::parseToc(filepath.c_str()).repacked);
+}
+
+static void psarcContentCacheTest(const std::vector<u8>& psarcData, const Psarc::Info& psarcInfo)
+{
+  const TestPsarcFile psarcFile("psarcContentCacheTest.psarc", psarcData);
+  const std::string& filepath = psarcFile.filepath;
+
+  Global::settings.libraryContentCacheSize = 0;
+
+  {
+    const Psarc::Info psarcInfoCached = Psarc::parseToc(filepath.c_str());
+    for (i32 i = 0; i < psarcInfo.tocEntries.size(); ++i)
+      Psarc::content(psarcInfoCached, psarcInfoCached.tocEntries[i]);
+
+    const Psarc::ContentCacheStats before = Psarc::contentCacheStats();
+    assert(before.size > 0);
+
+    Psarc::trimContentCache(); // entries used since the last trim stay
+    assert(Psarc::contentCacheStats().evictions == before.evictions);
+
+    Psarc::pinContent(&psarcInfoCached);
+    Psarc::trimContentCache();
+    assert(Psarc::contentCacheStats().evictions == before.evictions);
+
+    i32 largest = 1;
+    for (i32 i = 1; i < psarcInfo.tocEntries.size(); ++i)
+      if (psarcInfo.tocEntries[i].length > psarcInfo.tocEntries[largest].length)
+        largest = i;
+    const Psarc::Content held = Psarc::content(psarcInfoCached, psarcInfoCached.tocEntries[largest]);
+
+    Psarc::pinContent(nullptr);
+    Psarc::trimContentCache();
+    Psarc::trimContentCache(); // held is used in the last frame, now it only stays because it is held
+    const Psarc::ContentCacheStats after = Psarc::contentCacheStats();
+    assert(after.evictions > before.evictions);
+    assert(after.size < before.size);
+    assert(after.size >= held.size());
+    assert(std::ranges::equal(held, psarcInfo.tocEntries[largest].content));
+
+    for (i32 i = 0; i < psarcInfo.tocEntries.size(); ++i)
+      assert(std::ranges::equal(Psarc::content(psarcInfoCached, psarcInfoCached.tocEntries[i]), psarcInfo.tocEntries[i].content));
+    assert(Psarc::contentCacheStats().misses > after.misses);
+
+    // concurrent access while entries are evicted
+    const i32 entryCount = i32(psarcInfo.tocEntries.size());
+    ThreadPool::parallelFor(entryCount * 8, [&](i32 i)
+      {
+        const i32 tocIndex = i % entryCount;
+        const Psarc::Content content = Psarc::content(psarcInfoCached, psarcInfoCached.tocEntries[tocIndex]);
+        if (i % 5 == 0)
+          Psarc::trimContentCache();
+        assert(std::ranges::equal(content, psarcInfo.tocEntries[tocIndex].content));
+      });
+  }
+  assert(Psarc::contentCacheStats().size == 0);
+}
+
+static void psarcVerifyTest(const std::vector<u8>& psarcData, const Psarc::Info& psarcInfo)
+{
+  const TestPsarcFile psarcFile("psarcVerifyTest.psarc", psarcData);
+  const std::string& filepath = psarcFile.filepath;
+
+  assert(Psarc::verify(filepath.c_str()));
+
+  { // damage the data of a zlib block
+    u64 zlibOffset = 0;
+    for (const Psarc::Info::TOCEntry& tocEntry : psarcInfo.tocEntries)
+      if (tocEntry.length > 0 && u16_be(&psarcData[tocEntry.offset]) == 0x78DA)
+        zlibOffset = tocEntry.offset;
+    assert(zlibOffset != 0);
+
+    std::vector<u8> damagedData = psarcData;
+    damagedData[zlibOffset + 8] ^= 0x10;
+    File::save(filepath.c_str(), reinterpret_cast<const char*>(damagedData.data()), damagedData.size());
+    assert(!Psarc::verify(filepath.c_str()));
+  }
+
+  File::save(filepath.c_str(), reinterpret_cast<const char*>(psarcData.data()), psarcData.size() - 16);
+  assert(!Psarc::verify(filepath.c_str()));
+
+  { // the collection lists unverified files with tryParseToc
+    File::save(filepath.c_str(), reinterpret_cast<const char*>(psarcData.data()), psarcData.size());
+    Psarc::Info psarcInfoChecked;
+    assert(Psarc::tryParseToc(filepath.c_str(), psarcInfoChecked));
+    assert(psarcInfoChecked.tocEntries.size() == psarcInfo.tocEntries.size());
+    for (u64 i = 0; i < psarcInfo.tocEntries.size(); ++i)
+      assert(psarcInfoChecked.tocEntries[i].name == psarcInfo.tocEntries[i].name);
+
+    std::vector<u8> damagedData = psarcData;
+    damagedData[psarcInfo.tocEntries[0].offset + 8] ^= 0x10; // NameBlock.bin
+    File::save(filepath.c_str(), reinterpret_cast<const char*>(damagedData.data()), damagedData.size());
+    assert(!Psarc::tryParseToc(filepath.c_str(), psarcInfoChecked));
+
+    damagedData = psarcData;
+    damagedData[0] = 'X';
+    File::save(filepath.c_str(), reinterpret_cast<const char*>(damagedData.data()), damagedData.size());
+    assert(!Psarc::tryParseToc(filepath.c_str(), psarcInfoChecked));
+  }
+}
+
+static void sngViewTest(const Psarc::Info& psarcInfo)
+{
+  const std::vector<u8> plainText = Sng::decode(Psarc::content(psarcInfo, psarcInfo.tocEntries[Psarc::findTocIndex(psarcInfo, "_bass.sng")]));
+
+  const Sng::View view = Sng::view(plainText);
+  const Sng::Info sngInfo = Sng::parsePlainText(plainText);
+
+  ASSERT(view.bpm.size() == sngInfo.bpm.size());
+  ASSERT(view.phrase.size() == sngInfo.phrase.size());
+  ASSERT(view.phraseIteration.size() == sngInfo.phraseIteration.size());
+  ASSERT(view.section.size() == sngInfo.section.size());
+  ASSERT(view.arrangement.size() == sngInfo.arrangement.size());
+  for (i32 i = 0; i < i32(view.arrangement.size()); ++i)
+  {
+    ASSERT(view.arrangement[i].anchors.size() == sngInfo.arrangement[i].anchors.size());
+    ASSERT(view.arrangement[i].notes.size() == sngInfo.arrangement[i].notes.size());
+    for (i32 ii = 0; ii < i32(view.arrangement[i].notes.size()); ++ii)
+    {
+      ASSERT(view.arrangement[i].notes[ii].note.time == sngInfo.arrangement[i].notes[ii].time);
+      ASSERT(view.arrangement[i].notes[ii].note.fretId == sngInfo.arrangement[i].notes[ii].fretId);
+      ASSERT(view.arrangement[i].notes[ii].bendData.size() == sngInfo.arrangement[i].notes[ii].bendData.size());
+    }
+    ASSERT(view.arrangement[i].averageNotesPerIteration.size() == sngInfo.arrangement[i].averageNotesPerIteration.size());
+    for (i32 ii = 0; ii < i32(view.arrangement[i].averageNotesPerIteration.size()); ++ii)
+      ASSERT(view.arrangement[i].averageNotesPerIteration[ii] == sngInfo.arrangement[i].averageNotesPerIteration[ii]);
+  }
+  ASSERT(i32(view.tuning.size()) == view.metadata.stringCount);
+
+  // the view reads the plaintext up to its last byte
+  ASSERT(view.valid);
+  ASSERT(view.size == plainText.size());
+
+  // a truncated plaintext gives an invalid view. Records behind the notes are read at any alignment
+  for (const u64 size : { u64(0), u64(3), plainText.size() / 2, plainText.size() - 1 })
+  {
+    const Sng::View truncatedView = Sng::view(std::span<const u8>(plainText.data(), size));
+    ASSERT(!truncatedView.valid);
+    ASSERT(truncatedView.arrangement.empty());
+    ASSERT(Sng::parsePlainText(std::span<const u8>(plainText.data(), size)).arrangement.empty());
+  }
+  std::vector<u8> shifted(plainText.size() + 1);
+  memcpy(shifted.data() + 1, plainText.data(), plainText.size());
+  const Sng::View shiftedView = Sng::view(std::span<const u8>(shifted.data() + 1, plainText.size()));
+  ASSERT(shiftedView.valid);
+  ASSERT(shiftedView.metadata.stringCount == view.metadata.stringCount);
+  ASSERT(shiftedView.tuning[0] == view.tuning[0]);
+}
+
+static void songTrackTest(const Psarc::Info& psarcInfo)
+{
+  const SongFormat preferedSongFormat = Global::settings.profilePreferedSongFormat;
+  Global::settings.profilePreferedSongFormat = SongFormat::sng;
+
+  const Song::Track track = Song::loadTrack(psarcInfo, InstrumentFlags::BassGuitar);
+
+  Global::settings.profilePreferedSongFormat = SongFormat::xml;
+  const Song::Track xmlTrack = Song::loadTrack(psarcInfo, InstrumentFlags::BassGuitar);
+  Global::settings.profilePreferedSongFormat = preferedSongFormat;
+
+  ASSERT(track.phrases.size() == xmlTrack.phrases.size());
+  ASSERT(track.ebeats.size() == xmlTrack.ebeats.size());
+  for (i32 i = 0; i < i32(track.ebeats.size()); ++i)
+  {
+    ASSERT(track.ebeats[i].time == xmlTrack.ebeats[i].time);
+    ASSERT(track.ebeats[i].measure == xmlTrack.ebeats[i].measure);
+  }
+  ASSERT(track.transcriptionTrack.noteSustain[0] == 0.002f);
+  ASSERT(track.transcriptionTrack.notes[0].slideTo == -1);
+  ASSERT(track.transcriptionTrack.notes[0].leftHand == -1);
+  ASSERT(!track.transcriptionTrack.notes[0].has(Song::TranscriptionTrack::Technique::hammerOn | Song::TranscriptionTrack::Technique::tap));
+  ASSERT(track.transcriptionTrack.anchors.size() == 1);
+
+  // one difficulty level with 4 notes. Each phrase iteration takes its notes from it once
+  ASSERT(track.phraseIterations.size() == 2);
+  ASSERT(track.transcriptionTrack.notes.size() == 4);
+  for (i32 i = 1; i < i32(track.transcriptionTrack.notes.size()); ++i)
+    ASSERT(track.transcriptionTrack.noteTime[i - 1] <= track.transcriptionTrack.noteTime[i]);
+  for (i32 i = 1; i < i32(track.transcriptionTrack.anchors.size()); ++i)
+    ASSERT(track.transcriptionTrack.anchors[i - 1].time <= track.transcriptionTrack.anchors[i].time);
+
+  Song::Track levelTrack = track;
+  ASSERT(levelTrack.levels.level.size() == 1);
+  ASSERT(levelTrack.levels.activeLevel.size() == 2);
+  ASSERT(levelTrack.levels.level[0].noteBegin.back() == 4);
+
+  { // a second level: the notes one fret higher, one more note in the last phrase iteration and a chord in each phrase iteration
+    Song::Levels::Level level = levelTrack.levels.level[0];
+    level.difficulty = 1;
+    for (Song::TranscriptionTrack::Note& note : level.notes)
+      ++note.fret;
+    level.noteTime.push_back(level.noteTime.back());
+    level.noteSustain.push_back(level.noteSustain.back());
+    level.notes.push_back(level.notes.back());
+    ++level.noteBegin.back();
+
+    level.chords.clear();
+    level.chordNotes.clear();
+    level.chordNoteSustain.clear();
+    for (i32 i = 0; i < 2; ++i)
+    {
+      Song::TranscriptionTrack::Chord chord{};
+      chord.time = level.noteTime[level.noteBegin[i]];
+      chord.chordId = i;
+      chord.chordNoteBegin = i32(level.chordNotes.size());
+      chord.chordNoteCount = 2 - i;
+      for (i32 j = 0; j < chord.chordNoteCount; ++j)
+      {
+        Song::TranscriptionTrack::Note chordNote{};
+        chordNote.string = i8(j);
+        chordNote.fret = i8(10 * i + j);
+        level.chordNotes.push_back(chordNote);
+        level.chordNoteSustain.push_back(f32(i));
+      }
+      level.chords.push_back(chord);
+    }
+    level.chordBegin = { 0, 1, 2 };
+    levelTrack.levels.level.push_back(level);
+    levelTrack.levels.levelOfDifficulty = { 0, 1 };
+    for (Song::Phrase& phrase : levelTrack.phrases)
+      phrase.maxDifficulty = 1;
+  }
+  Song::applyLevels(levelTrack);
+
+  { // a copy does not have to keep the capacity loadTrack reserved. Room for the densest choice of levels is enough
+    Song::TranscriptionTrack& transcriptionTrack = levelTrack.transcriptionTrack;
+    transcriptionTrack.noteTime.reserve(5);
+    transcriptionTrack.noteSustain.reserve(5);
+    transcriptionTrack.notes.reserve(5);
+    transcriptionTrack.chords.reserve(2 + levelTrack.levels.level[0].chords.size());
+    transcriptionTrack.chordNoteSustain.reserve(3 + levelTrack.levels.level[0].chordNotes.size());
+    transcriptionTrack.chordNotes.reserve(3 + levelTrack.levels.level[0].chordNotes.size());
+    transcriptionTrack.anchors.reserve(levelTrack.levels.level[0].anchorTime.size());
+    transcriptionTrack.handShape.reserve(levelTrack.levels.level[0].handShapes.size());
+  }
+
+  // setLevel replaces the slice of one phrase iteration in place. The result is the same as a rebuild
+  const auto assertRebuilt = [](const Song::Track& switchedTrack)
+  {
+    Song::Track rebuiltTrack = switchedTrack;
+    Song::applyLevels(rebuiltTrack);
+    const Song::TranscriptionTrack& switched = switchedTrack.transcriptionTrack;
+    const Song::TranscriptionTrack& rebuilt = rebuiltTrack.transcriptionTrack;
+    ASSERT(switched.noteTime == rebuilt.noteTime);
+    ASSERT(switched.noteSustain == rebuilt.noteSustain);
+    ASSERT(switched.notes.size() == rebuilt.notes.size());
+    for (u64 i = 0; i < switched.notes.size(); ++i)
+      ASSERT(switched.notes[i].fret == rebuilt.notes[i].fret);
+    ASSERT(switched.chords.size() == rebuilt.chords.size());
+    for (u64 i = 0; i < switched.chords.size(); ++i)
+    {
+      ASSERT(switched.chords[i].chordId == rebuilt.chords[i].chordId);
+      ASSERT(switched.chords[i].chordNoteBegin == rebuilt.chords[i].chordNoteBegin);
+      ASSERT(switched.chords[i].chordNoteCount == rebuilt.chords[i].chordNoteCount);
+    }
+    ASSERT(switched.chordNoteSustain == rebuilt.chordNoteSustain);
+    ASSERT(switched.chordNotes.size() == rebuilt.chordNotes.size());
+    for (u64 i = 0; i < switched.chordNotes.size(); ++i)
+      ASSERT(switched.chordNotes[i].fret == rebuilt.chordNotes[i].fret);
+    ASSERT(switched.anchors.size() == rebuilt.anchors.size());
+    ASSERT(switched.handShape.size() == rebuilt.handShape.size());
+  };
+
+  const Song::TranscriptionTrack::Note* notes = levelTrack.transcriptionTrack.notes.data();
+  const Song::TranscriptionTrack::Chord* chords = levelTrack.transcriptionTrack.chords.data();
+  const i32 levelChordCount = i32(levelTrack.levels.level[0].chords.size());
+
+  Song::setLevel(levelTrack, 1, 1);
+  ASSERT(levelTrack.levels.activeLevel[1] == 1);
+  ASSERT(levelTrack.transcriptionTrack.notes.size() == 5);
+  for (i32 i = 0; i < 5; ++i)
+  {
+    const i32 levelIndex = i < levelTrack.levels.level[0].noteBegin[1] ? 0 : 1;
+    ASSERT(levelTrack.transcriptionTrack.notes[i].fret == levelTrack.levels.level[levelIndex].notes[i].fret);
+  }
+  assertRebuilt(levelTrack);
+
+  Song::setLevel(levelTrack, 0, 1); // moves the chord notes of the phrase iteration behind it
+  for (i32 i = 0; i < 5; ++i)
+    ASSERT(levelTrack.transcriptionTrack.notes[i].fret == track.transcriptionTrack.notes[min_(i, 3)].fret + 1);
+  ASSERT(levelTrack.transcriptionTrack.chords.size() == 2);
+  ASSERT(levelTrack.transcriptionTrack.chords[1].chordNoteBegin == 2);
+  ASSERT(levelTrack.transcriptionTrack.chordNotes[2].fret == 10);
+  assertRebuilt(levelTrack);
+
+  Song::setLevel(levelTrack, 0, 0);
+  Song::setLevel(levelTrack, 1, 0);
+  ASSERT(levelTrack.transcriptionTrack.notes.size() == 4);
+  ASSERT(i32(levelTrack.transcriptionTrack.chords.size()) == levelChordCount);
+  for (i32 i = 0; i < 4; ++i)
+  {
+    ASSERT(levelTrack.transcriptionTrack.noteTime[i] == track.transcriptionTrack.noteTime[i]);
+    ASSERT(levelTrack.transcriptionTrack.notes[i].fret == track.transcriptionTrack.notes[i].fret);
+  }
+  assertRebuilt(levelTrack);
+
+  // switching levels reuses the storage of the track
+  ASSERT(levelTrack.transcriptionTrack.notes.data() == notes);
+  ASSERT(levelTrack.transcriptionTrack.chords.data() == chords);
+}
+
+static void trackCacheTest(const std::vector<u8>& psarcData)
+{
+  const TestPsarcFile psarcFile("trackCacheTest.psarc", psarcData);
+  const std::string& filepath = psarcFile.filepath;
+
+  Global::settings.profilePreferedSongFormat = SongFormat::sng;
+
+  const Psarc::Info psarcInfo = Psarc::parseToc(filepath.c_str());
+  const std::string cachePath = Song::trackCachePath(psarcInfo, InstrumentFlags::BassGuitar);
+  std::filesystem::remove(cachePath);
+
+  Song::Track parsedTrack;
+  std::vector<Song::Vocal> parsedVocals;
+  Song::loadArrangement(psarcInfo, InstrumentFlags::BassGuitar, parsedTrack, parsedVocals);
+  assert(std::filesystem::exists(cachePath));
+
+  Song::Track cachedTrack;
+  std::vector<Song::Vocal> cachedVocals;
+  Song::loadArrangement(psarcInfo, InstrumentFlags::BassGuitar, cachedTrack, cachedVocals);
+  assert(cachedTrack.phrases.size() == parsedTrack.phrases.size());
+  assert(cachedTrack.phrases[1].name == parsedTrack.phrases[1].name);
+  assert(cachedTrack.ebeats.size() == parsedTrack.ebeats.size());
+  assert(cachedTrack.transcriptionTrack.notes.size() == parsedTrack.transcriptionTrack.notes.size());
+  for (i32 i = 0; i < i32(cachedTrack.transcriptionTrack.notes.size()); ++i)
+  {
+    assert(cachedTrack.transcriptionTrack.noteTime[i] == parsedTrack.transcriptionTrack.noteTime[i]);
+    assert(cachedTrack.transcriptionTrack.notes[i].technique == parsedTrack.transcriptionTrack.notes[i].technique);
+    assert(cachedTrack.transcriptionTrack.notes[i].fret == parsedTrack.transcriptionTrack.notes[i].fret);
+  }
+  assert(cachedTrack.levels.level.size() == parsedTrack.levels.level.size());
+  assert(cachedTrack.levels.level[0].noteTime == parsedTrack.levels.level[0].noteTime);
+  assert(cachedVocals.size() == parsedVocals.size());
+
+  // a damaged cache file is parsed again
+  const std::vector<u8> cacheData = File::load(cachePath.c_str(), "rb");
+  File::save(cachePath.c_str(), reinterpret_cast<const char*>(cacheData.data()), cacheData.size() / 2);
+  Song::loadArrangement(psarcInfo, InstrumentFlags::BassGuitar, cachedTrack, cachedVocals);
+  assert(cachedTrack.transcriptionTrack.notes.size() == parsedTrack.transcriptionTrack.notes.size());
+  assert(File::load(cachePath.c_str(), "rb") == cacheData);
+
+  { // an index out of range is parsed again. The active levels are followed by the vocals at the end of the file
+    u64 vocalsSize = sizeof(u32);
+    for (const Song::Vocal& vocal : parsedVocals)
+      vocalsSize += sizeof(vocal.time) + sizeof(vocal.note) + sizeof(vocal.length) + sizeof(u32) + vocal.lyric.size();
+    assert(!parsedTrack.levels.activeLevel.empty());
+
+    std::vector<u8> damagedData = cacheData;
+    const i32 activeLevel = 1000;
+    memcpy(&damagedData[damagedData.size() - vocalsSize - sizeof(i32)], &activeLevel, sizeof(activeLevel));
+    File::save(cachePath.c_str(), reinterpret_cast<const char*>(damagedData.data()), damagedData.size());
+    Song::loadArrangement(psarcInfo, InstrumentFlags::BassGuitar, cachedTrack, cachedVocals);
+    assert(cachedTrack.levels.activeLevel == parsedTrack.levels.activeLevel);
+    assert(File::load(cachePath.c_str(), "rb") == cacheData);
+  }
+
+  // the cache lives in its own directory and is removed with the psarc file
+  assert(std::filesystem::path(cachePath).parent_path() != std::filesystem::path(filepath).parent_path());
+  Song::removeTrackCaches(filepath);
+  assert(!std::filesystem::exists(cachePath));
+
+  { // a cancelled load writes no cache
+    const std::atomic<bool> cancel = true;
+    Song::loadArrangement(psarcInfo, InstrumentFlags::BassGuitar, cachedTrack, cachedVocals, &cancel);
+    assert(!std::filesystem::exists(cachePath));
+  }
+
+  // an unwritable location is no error
+  assert(!File::save((std::filesystem::temp_directory_path() / "missingDirectory" / "file").string().c_str(), "x", 1));
+}
+
 static void psarcTest() {
   static const std::vector<u8> psarcData = {
       0x50, 0x53, 0x41, 0x52, 0x00, 0x01, 0x00, 0x04, 0x7a, 0x6c, 0x69, 0x62,
@@ -25082,7 +25830,15 @@ static void psarcTest() {
   const Psarc::Info psarcInfo = Psarc::parse(psarcData);
 
   songInfoTest(psarcInfo);
+  sngViewTest(psarcInfo);
+  songTrackTest(psarcInfo);
   oggTest(psarcInfo);
+  psarcLookupTest(psarcInfo);
+  psarcLazyTest(psarcData, psarcInfo);
+  psarcVerifyTest(psarcData, psarcInfo);
+  psarcContentCacheTest(psarcData, psarcInfo);
+  psarcRepackTest(psarcData, psarcInfo);
+  trackCacheTest(psarcData);
 }
 
 #ifdef SUPPORT_BNK
@@ -25164,8 +25920,12 @@ void Test::run() {
   base64Test();
   mat4Test();
   endianesTest();
+  md5Test();
+  inflateTest();
   //installerTest();
   rijndaelTest();
+  stringPoolTest();
+  playerTest();
   settingsTest();
   psarcTest();
 }
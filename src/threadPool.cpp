@@ -0,0 +1,195 @@
+#include "threadPool.h"
+
+#include "helper.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#elif defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace {
+  struct Batch
+  {
+    const std::function<void(i32)>* func;
+    std::function<void(i32)> ownedFunc; // for batches nobody waits for
+    i32 count;
+    std::atomic<i32> next = 0;
+    std::atomic<i32> done = 0;
+  };
+
+  struct Pool
+  {
+    std::mutex mutex;
+    std::condition_variable batchAdded;
+    std::condition_variable batchDone;
+    std::deque<std::shared_ptr<Batch>> batches;
+  };
+
+  struct LowPriorityQueue
+  {
+    std::mutex mutex;
+    std::condition_variable taskAdded;
+    std::deque<std::function<void()>> tasks;
+  };
+}
+
+static Pool& pool()
+{
+  // never destroyed. The detached workers still wait on it while static destructors run at exit.
+  static Pool* pool = new Pool;
+  return *pool;
+}
+
+static LowPriorityQueue& lowPriorityQueue()
+{
+  static LowPriorityQueue* lowPriorityQueue = new LowPriorityQueue; // never destroyed, see pool()
+  return *lowPriorityQueue;
+}
+
+static void work(Batch& batch)
+{
+  for (i32 i = batch.next++; i < batch.count; i = batch.next++)
+  {
+    (*batch.func)(i);
+
+    if (++batch.done == batch.count)
+    {
+      const std::unique_lock lock(pool().mutex);
+      pool().batchDone.notify_all();
+    }
+  }
+}
+
+static void workerThread()
+{
+  for (;;)
+  {
+    std::shared_ptr<Batch> batch;
+    {
+      std::unique_lock lock(pool().mutex);
+      pool().batchAdded.wait(lock, [] { return !pool().batches.empty(); });
+      batch = pool().batches.front();
+      if (batch->next >= batch->count)
+      {
+        pool().batches.pop_front();
+        continue;
+      }
+    }
+
+    work(*batch);
+  }
+}
+
+static void lowPriorityWorkerThread()
+{
+#if defined(_WIN32)
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_LOWEST);
+#elif defined(__linux__)
+  setpriority(PRIO_PROCESS, 0, 19); // linux applies the nice value to the calling thread only
+#endif
+
+  for (;;)
+  {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(lowPriorityQueue().mutex);
+      lowPriorityQueue().taskAdded.wait(lock, [] { return !lowPriorityQueue().tasks.empty(); });
+      task = std::move(lowPriorityQueue().tasks.front());
+      lowPriorityQueue().tasks.pop_front();
+    }
+
+    task();
+  }
+}
+
+static i32 startWorkers()
+{
+#ifdef __EMSCRIPTEN__
+  return 0; // built without pthread support. Everything runs on the calling thread.
+#else // __EMSCRIPTEN__
+  const i32 count = max_(i32(std::thread::hardware_concurrency()) - 1, 1);
+  for (i32 i = 0; i < count; ++i)
+    std::thread(workerThread).detach();
+  return count;
+#endif // __EMSCRIPTEN__
+}
+
+i32 ThreadPool::workerCount()
+{
+  static const i32 count = startWorkers();
+  return count;
+}
+
+void ThreadPool::parallelFor(i32 count, const std::function<void(i32)>& func)
+{
+  if (count <= 1 || workerCount() == 0)
+  {
+    for (i32 i = 0; i < count; ++i)
+      func(i);
+    return;
+  }
+
+  const std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+  batch->func = &func;
+  batch->count = count;
+  {
+    const std::unique_lock lock(pool().mutex);
+    pool().batches.push_back(batch);
+  }
+  pool().batchAdded.notify_all();
+
+  work(*batch);
+
+  std::unique_lock lock(pool().mutex);
+  pool().batchDone.wait(lock, [&] { return batch->done == batch->count; });
+  std::erase(pool().batches, batch);
+}
+
+void ThreadPool::run(std::function<void()> task)
+{
+  if (workerCount() == 0)
+  {
+    task();
+    return;
+  }
+
+  const std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+  batch->ownedFunc = [task = std::move(task)](i32) { task(); };
+  batch->func = &batch->ownedFunc;
+  batch->count = 1;
+  {
+    const std::unique_lock lock(pool().mutex);
+    pool().batches.push_back(batch);
+  }
+  pool().batchAdded.notify_one();
+}
+
+void ThreadPool::runLowPriority(std::function<void()> task)
+{
+#ifdef __EMSCRIPTEN__
+  task();
+#else // __EMSCRIPTEN__
+  static const bool started = []
+  {
+    const i32 count = max_(i32(std::thread::hardware_concurrency()) / 2, 1);
+    for (i32 i = 0; i < count; ++i)
+      std::thread(lowPriorityWorkerThread).detach();
+    return true;
+  }();
+  UNUSED(started);
+
+  {
+    const std::unique_lock lock(lowPriorityQueue().mutex);
+    lowPriorityQueue().tasks.push_back(std::move(task));
+  }
+  lowPriorityQueue().taskAdded.notify_one();
+#endif // __EMSCRIPTEN__
+}
@@ -0,0 +1,24 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "typedefs.h"
+
+#include <functional>
+
+namespace ThreadPool
+{
+  i32 workerCount();
+
+  // Calls func(i) for every i in [0, count) on the worker threads.
+  // The calling thread works on the range too and returns when all calls are finished.
+  void parallelFor(i32 count, const std::function<void(i32)>& func);
+
+  // Queues task for the worker threads and returns at once.
+  void run(std::function<void()> task);
+
+  // Queues task for a separate set of workers that run with the lowest OS thread priority.
+  // For background work that must not compete with the game.
+  void runLowPriority(std::function<void()> task);
+}
+
+#endif // THREAD_POOL_H
@@ -12,6 +12,7 @@
 #include "profile.h"
 #include "shader.h"
 #include "sound.h"
+#include "threadPool.h"
 
 #define NK_INCLUDE_DEFAULT_ALLOCATOR
 #define NK_INCLUDE_DEFAULT_FONT
@@ -1849,7 +1850,7 @@ static void toneWindow()
       for (i32 i = 0; i < toneNames.size(); ++i)
       {
         const Manifest::Tone& tone = Global::songInfos[Global::songSelected].tones[i];
-        toneNames[i] = Global::songInfos[Global::songSelected].manifestInfos[0].songName + tone.nameSeparator + fixToneDescriptorName(tone.toneDescriptors[0]);
+        toneNames[i] = Global::songInfos[Global::songSelected].manifestInfos[0].songName.c_str() + tone.nameSeparator + fixToneDescriptorName(tone.toneDescriptors[0]);
         toneNamesData[i] = toneNames[i].c_str();
       }
 
@@ -2365,9 +2366,8 @@ static void songWindow()
       nk_layout_row_template_end(ctx);
       {
         {
-#ifdef COLLECTION_WORKER_THREAD
+          // also taken without the collection worker thread. The integrity verification writes to the songInfos.
           const std::unique_lock lock(Global::psarcInfosMutex);
-#endif // COLLECTION_WORKER_THREAD
 
           static i32 expandedIndex = -1;
           static i32 expandedHeight = 0;
@@ -2385,6 +2385,13 @@ static void songWindow()
 
             if (nk_group_begin(ctx, "top", NK_WINDOW_NO_SCROLLBAR | NK_WINDOW_BORDER)) {
 
+              // damaged psarc files are listed but never opened
+              const bool damaged = songInfo.integrity == Song::Integrity::damaged;
+
+              // songs listed from the collection index are opened once they become visible
+              if (!damaged)
+                Psarc::loadToc(Global::psarcInfos[i]);
+
               nk_layout_row_template_begin(ctx, 15);
               nk_layout_row_template_push_static(ctx, 130);
               nk_layout_row_template_push_static(ctx, 80);
@@ -2393,10 +2400,11 @@ static void songWindow()
               nk_layout_row_template_end(ctx);
 
               struct nk_image thumbnail;
-              if (songInfo.albumCover128_ogl == 0 && songInfo.albumCover128_tocIndex >= 1)
-                songInfo.albumCover128_ogl = OpenGl::loadDDSTexture(
-                  Global::psarcInfos[i].tocEntries[songInfo.albumCover128_tocIndex].content.data(),
-                  i32(Global::psarcInfos[i].tocEntries[songInfo.albumCover128_tocIndex].content.size()));
+              if (!damaged && songInfo.albumCover128_ogl == 0 && songInfo.albumCover128_tocIndex >= 1)
+              {
+                const Psarc::Content albumCover128 = Psarc::content(Global::psarcInfos[i], Global::psarcInfos[i].tocEntries[songInfo.albumCover128_tocIndex]);
+                songInfo.albumCover128_ogl = OpenGl::loadDDSTexture(albumCover128.data(), i32(albumCover128.size()));
+              }
 
               if (songInfo.albumCover128_ogl != 0)
                 thumbnail = nk_image_id((int)songInfo.albumCover128_ogl);
@@ -2414,7 +2422,11 @@ static void songWindow()
               nk_spacing(ctx, 1);
               nk_label(ctx, "Title:", NK_TEXT_LEFT);
               nk_label(ctx, songInfo.manifestInfos[manifestIndex].songName.c_str(), NK_TEXT_LEFT);
-              if (nk_button_label(ctx, "Preview"))
+              if (damaged)
+              {
+                nk_label(ctx, "Damaged", NK_TEXT_CENTERED);
+              }
+              else if (nk_button_label(ctx, "Preview"))
               {
                 Player::playPreview(Global::psarcInfos[i]);
               }
@@ -2422,7 +2434,7 @@ static void songWindow()
               nk_label(ctx, "Artist:", NK_TEXT_LEFT);
               nk_label(ctx, songInfo.manifestInfos[manifestIndex].artistName.c_str(), NK_TEXT_LEFT);
 
-              if (songInfo.manifestInfos.size() >= 1)
+              if (!damaged && songInfo.manifestInfos.size() >= 1)
               {
                 if (nk_button_label(ctx, instrumentName(songInfo.manifestInfos[manifestIndex].instrumentFlags)))
                 {
@@ -2438,7 +2450,11 @@ static void songWindow()
               nk_spacing(ctx, 1);
               nk_label(ctx, "Album:", NK_TEXT_LEFT);
               nk_label(ctx, songInfo.manifestInfos[manifestIndex].albumName.c_str(), NK_TEXT_LEFT);
-              if (nk_button_label(ctx, "Tones"))
+              if (damaged)
+              {
+                nk_spacing(ctx, 1);
+              }
+              else if (nk_button_label(ctx, "Tones"))
               {
                 Global::songSelected = i;
                 if (Global::songInfos[i].loadState != Song::LoadState::complete)
@@ -2484,7 +2500,11 @@ static void songWindow()
                   nk_label(ctx, "Tuning:", NK_TEXT_LEFT);
                   nk_label(ctx, Song::tuningName(songInfo.manifestInfos[manifestIndex].tuning), NK_TEXT_LEFT);
 
-                  if (nk_button_label(ctx, instrumentName(songInfo.manifestInfos[j].instrumentFlags)))
+                  if (damaged)
+                  {
+                    nk_spacing(ctx, 1);
+                  }
+                  else if (nk_button_label(ctx, instrumentName(songInfo.manifestInfos[j].instrumentFlags)))
                   {
                     Global::songSelected = i;
                     Global::manifestSelected = j;
@@ -2504,6 +2524,26 @@ static void songWindow()
   nk_end(ctx);
 }
 
+// Shown while the started song loads on the worker threads.
+static void loadingWindow()
+{
+  const Player::LoadProgress progress = Player::loadProgress();
+  if (!progress.loading)
+    return;
+
+  if (nk_begin(ctx, "Loading", nk_rect(520, 330, 240, 110), NK_WINDOW_BORDER | NK_WINDOW_TITLE | NK_WINDOW_NO_INPUT))
+  {
+    nk_layout_row_dynamic(ctx, 18, 2);
+    nk_label(ctx, "Song Info", NK_TEXT_LEFT);
+    nk_label(ctx, progress.songInfoLoaded ? "done" : "loading", NK_TEXT_RIGHT);
+    nk_label(ctx, "Arrangement", NK_TEXT_LEFT);
+    nk_label(ctx, progress.arrangementLoaded ? "done" : "loading", NK_TEXT_RIGHT);
+    nk_layout_row_dynamic(ctx, 18, 1);
+    nk_prog(ctx, nk_size(progress.audioDecoded * 100.0f), 100, NK_FIXED);
+  }
+  nk_end(ctx);
+}
+
 static void settingsWindow()
 {
   if (nk_begin(ctx, "Settings", nk_rect(30, 30, 250, 480), NK_WINDOW_BORDER | NK_WINDOW_MOVABLE | NK_WINDOW_SCALABLE | NK_WINDOW_MINIMIZABLE | NK_WINDOW_TITLE))
@@ -3026,6 +3066,24 @@ static void settingsWindow()
       }
       nk_tree_pop(ctx);
     }
+    if (nk_tree_push(ctx, NK_TREE_TAB, "Library", NK_MINIMIZED))
+    {
+      nk_layout_row_dynamic(ctx, 22, 1);
+      nk_property_int(ctx, "Content Cache MB:", 16, &Global::settings.libraryContentCacheSize, 4096, 16, 16);
+      nk_checkbox_label(ctx, "Verify Integrity", (nk_bool*)&Global::settings.libraryVerifyIntegrity);
+      if (nk_button_label(ctx, "Optimize Library"))
+      { // rewrites every psarc file into a fast-load container on low priority threads
+        std::vector<std::string> filepaths;
+        {
+          const std::unique_lock lock(Global::psarcInfosMutex);
+          for (const Psarc::Info& psarcInfo : Global::psarcInfos)
+            filepaths.push_back(psarcInfo.filepath);
+        }
+        for (std::string& filepath : filepaths)
+          ThreadPool::runLowPriority([filepath = std::move(filepath)]() { Psarc::repack(filepath.c_str()); });
+      }
+      nk_tree_pop(ctx);
+    }
 #ifdef SUPPORT_MIDI
     if (nk_tree_push(ctx, NK_TREE_TAB, "Midi", NK_MINIMIZED))
     {
@@ -3124,7 +3182,7 @@ static void settingsWindow()
 }
 
 static void installWindow() {
-  if (nk_begin(ctx, "Install", nk_rect(150, 200, 700, 290), NK_WINDOW_BORDER | NK_WINDOW_TITLE)) {
+  if (nk_begin(ctx, "Install", nk_rect(150, 200, 700, 312), NK_WINDOW_BORDER | NK_WINDOW_TITLE)) {
 
 
     nk_layout_row_dynamic(ctx, 22, 1);
@@ -3132,6 +3190,7 @@ static void installWindow() {
     nk_label(ctx, "Installing ReaperForge will create the following files in the current location:", NK_TEXT_LEFT);
     nk_label(ctx, " -settings.ini      <- Audio settings, Colors, etc.", NK_TEXT_LEFT);
     nk_label(ctx, " -profile_Anon.ini  <- for Highscores, Number of Plays and Tone assignments.", NK_TEXT_LEFT);
+    nk_label(ctx, " -collection.bin    <- Index of your psarc files for a faster start.", NK_TEXT_LEFT);
     nk_label(ctx, "In addition Reaperforge will create the following directories in the current location:", NK_TEXT_LEFT);
     nk_label(ctx, " -psarc             <- copy your _p.psarc files into this directory.", NK_TEXT_LEFT);
     nk_label(ctx, " -vst               <- copy your .dll files of your vst plugins into this directory.", NK_TEXT_LEFT);
@@ -3262,6 +3321,7 @@ void Ui::tick() {
   settingsWindow();
   mixerWindow();
   songWindow();
+  loadingWindow();
   if (Global::uiToneWindowOpen)
     toneWindow();
 #ifdef SUPPORT_PLUGIN
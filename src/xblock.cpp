@@ -110,12 +110,12 @@ static void readProperty(pugi::xml_node& property, XBlock::Info::Entry::Properti
 }
 #endif // XBLOCK_FULL
 
-XBlock::Info XBlock::readXBlock(const std::vector<u8>& xBlockData)
+XBlock::Info XBlock::readXBlock(std::span<const u8> xBlockData)
 {
   XBlock::Info xblockInfo;
 
   pugi::xml_document doc;
-  pugi::xml_parse_result result = doc.load_string(reinterpret_cast<const char*>(xBlockData.data()));
+  pugi::xml_parse_result result = doc.load_buffer(xBlockData.data(), xBlockData.size()); // the content is not zero terminated
 #ifndef XML_IGNORE_ERROR
   assert(result.status == pugi::status_ok);
 #endif // XML_IGNORE_ERROR
@@ -2,6 +2,7 @@
 #define XBLOCK_H
 
 #include "type.h"
+#include <span>
 #include <vector>
 
 namespace XBlock {
@@ -31,7 +32,7 @@ namespace XBlock {
     std::vector<Entry> entries;
   };
 
-  XBlock::Info readXBlock(const std::vector<u8>& xBlockData);
+  XBlock::Info readXBlock(std::span<const u8> xBlockData);
 }
 
 #endif // XBLOCK_H